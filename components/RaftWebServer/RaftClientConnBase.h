@@ -11,6 +11,7 @@
 #include <vector>
 #include "RaftWebConnDefs.h"
 #include "SpiramAwareAllocator.h"
+#include "RaftWebAdmission.h"
 
 enum RaftClientConnRslt
 {
@@ -26,6 +27,15 @@ public:
     // Virtual destructor
     virtual ~RaftClientConnBase()
     {
+        if (_pAdmission)
+            _pAdmission->release(_peerAddr);
+    }
+
+    // Set admission control which admitted the connection (released when the connection is deleted)
+    void setAdmission(RaftWebAdmission* pAdmission, uint32_t peerAddr)
+    {
+        _pAdmission = pAdmission;
+        _peerAddr = peerAddr;
     }
 
     // Connection is active
@@ -56,7 +66,18 @@ public:
     // Setup
     virtual void setup(bool blocking) = 0;
 
+    // Shutdown sending (half-close) - the peer sees the end of the response but data it has
+    // already sent can still be read (closing with unread data would reset the connection)
+    virtual void shutdownSend()
+    {
+    }
+
     // Data access
     virtual RaftClientConnRslt getDataStart(std::vector<uint8_t, SpiramAwareAllocator<uint8_t>>& dataBuf) = 0;
     virtual void getDataEnd() = 0;
+
+private:
+    // Admission control
+    RaftWebAdmission* _pAdmission = nullptr;
+    uint32_t _peerAddr = 0;
 };
@@ -51,6 +51,12 @@ public:
     // Setup
     virtual void setup(bool blocking) override final;
 
+    // Shutdown sending
+    virtual void shutdownSend() override final
+    {
+        netconn_shutdown(_client, 0, 1);
+    }
+
     // Data access
     virtual RaftClientConnRslt getDataStart(std::vector<uint8_t, SpiramAwareAllocator<uint8_t>>& dataBuf) override final;
     virtual void getDataEnd() override final;
@@ -101,6 +101,12 @@ void RaftClientConnSockets::setup(bool blocking)
 #endif
 }
 
+void RaftClientConnSockets::shutdownSend()
+{
+    if (_client >= 0)
+        shutdown(_client, SHUT_WR);
+}
+
 RaftWebConnSendRetVal RaftClientConnSockets::canSend()
 {
     // Check if socket is still valid
@@ -41,6 +41,9 @@ public:
     // Setup
     virtual void setup(bool blocking) override final;
 
+    // Shutdown sending
+    virtual void shutdownSend() override final;
+
     // Data access
     virtual RaftClientConnRslt getDataStart(std::vector<uint8_t, SpiramAwareAllocator<uint8_t>>& dataBuf) override final;
     virtual void getDataEnd() override final;
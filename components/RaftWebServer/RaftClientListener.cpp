@@ -218,8 +218,22 @@ void RaftClientListener::listenForClients(int port, uint32_t numConnSlots)
                 static const bool TRACE_CONN = false;
     #endif
 
+                // Admission control - rejected before anything is allocated for the connection
+                uint32_t peerAddr = 0;
+                if (clientInfo.ss_family == AF_INET)
+                    peerAddr = ((struct sockaddr_in *)&clientInfo)->sin_addr.s_addr;
+                else if (clientInfo.ss_family == AF_INET6)
+                    peerAddr = RaftWebAdmission::getAddrKeyIPv6(((struct sockaddr_in6 *)&clientInfo)->sin6_addr.s6_addr);
+                if (!_admission.admit(peerAddr))
+                {
+                    close(sockClient);
+                    continue;
+                }
+
                 // Construct an RaftClientConnSockets object
                 RaftClientConnBase* pClientConn = new RaftClientConnSockets(sockClient, TRACE_CONN);
+                if (_admission.isEnabled())
+                    pClientConn->setAdmission(&_admission, peerAddr);
 
                 // Hand off the connection to the connection manager via a callback
                 if (!(_handOffNewConnCB && _handOffNewConnCB(pClientConn)))
@@ -270,8 +284,30 @@ void RaftClientListener::listenForClients(int port, uint32_t numConnSlots)
             // Check new connection valid
             if ((errCode == ERR_OK) && pNewConnection)
             {
+                // Admission control - rejected before anything is allocated for the connection
+                uint32_t peerAddr = 0;
+                ip_addr_t peerIPAddr;
+                u16_t peerPort = 0;
+                if (netconn_peer(pNewConnection, &peerIPAddr, &peerPort) == ERR_OK)
+                {
+#if LWIP_IPV6
+                    if (IP_IS_V6(&peerIPAddr))
+                        peerAddr = RaftWebAdmission::getAddrKeyIPv6((const uint8_t*)ip_2_ip6(&peerIPAddr)->addr);
+                    else
+#endif
+                        peerAddr = ip4_addr_get_u32(ip_2_ip4(&peerIPAddr));
+                }
+                if (!_admission.admit(peerAddr))
+                {
+                    netconn_close(pNewConnection);
+                    netconn_delete(pNewConnection);
+                    continue;
+                }
+
                 // Construct an RaftClientConnNetconn object
                 RaftClientConnBase* pClientConn = new RaftClientConnNetconn(pNewConnection);
+                if (_admission.isEnabled())
+                    pClientConn->setAdmission(&_admission, peerAddr);
 
                 // Hand off the connection to the connection manager via a callback
                 if (!(_handOffNewConnCB && _handOffNewConnCB(pClientConn)))
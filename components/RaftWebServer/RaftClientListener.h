@@ -10,6 +10,7 @@
 
 #include <functional>
 #include "RaftClientConnBase.h"
+#include "RaftWebAdmission.h"
 
 // Callback for new connection
 typedef std::function<bool(RaftClientConnBase* pClientConn)> RaftWebNewConnCBType;
@@ -28,8 +29,17 @@ public:
     }
     void listenForClients(int port, uint32_t numConnSlots);
 
+    // Admission control (setup before listening)
+    RaftWebAdmission& getAdmission()
+    {
+        return _admission;
+    }
+
 private:
     static const uint32_t WEB_SERVER_SOCKET_RETRY_DELAY_MS = 1000;
     RaftWebNewConnCBType _handOffNewConnCB;
+
+    // Admission control
+    RaftWebAdmission _admission;
 };
 
@@ -0,0 +1,199 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "Logger.h"
+#include "RaftUtils.h"
+#include "ArduinoTime.h"
+#include "RaftWebAdmission.h"
+
+// Warn
+#define WARN_ON_ADMISSION_REJECT
+
+// Debug
+// #define DEBUG_ADMISSION
+
+#if defined(WARN_ON_ADMISSION_REJECT) || defined(DEBUG_ADMISSION)
+static const char* MODULE_PREFIX = "RaftWebAdmission";
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constructor / Destructor
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftWebAdmission::RaftWebAdmission()
+{
+    RaftMutex_init(_admitMutex);
+}
+
+RaftWebAdmission::~RaftWebAdmission()
+{
+    RaftMutex_destroy(_admitMutex);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Setup
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebAdmission::setup(uint32_t maxConnPerAddr, uint32_t connRatePerSec, uint32_t connRateBurst)
+{
+    _maxConnPerAddr = maxConnPerAddr;
+    _connRatePerSec = connRatePerSec;
+    _connRateBurst = connRateBurst > 0 ? connRateBurst : 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Get key for an IPv6 address
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebAdmission::getAddrKeyIPv6(const uint8_t* pAddr)
+{
+    // IPv4-mapped (::ffff:a.b.c.d) uses the IPv4 address in network order
+    static const uint8_t IPV4_MAPPED_PREFIX[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+    uint32_t addrKey = 0;
+    if (memcmp(pAddr, IPV4_MAPPED_PREFIX, sizeof(IPV4_MAPPED_PREFIX)) == 0)
+    {
+        memcpy(&addrKey, pAddr + sizeof(IPV4_MAPPED_PREFIX), sizeof(addrKey));
+        return addrKey;
+    }
+
+    // Hash (FNV-1a) of the full address so hosts which only share an interface ID are distinct
+    addrKey = 2166136261u;
+    for (uint32_t i = 0; i < 16; i++)
+        addrKey = (addrKey ^ pAddr[i]) * 16777619u;
+    return addrKey;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Admit a new connection
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebAdmission::admit(uint32_t peerAddr)
+{
+    if (!isEnabled() || !RaftMutex_lock(_admitMutex, RAFT_MUTEX_WAIT_FOREVER))
+        return true;
+
+    // Addresses which can't be tracked (table full of addresses with open connections) are admitted
+    AddrInfo* pAddr = findAddr(peerAddr, true);
+    if (!pAddr)
+    {
+        _untrackedCount++;
+        RaftMutex_unlock(_admitMutex);
+        return true;
+    }
+    uint32_t nowMs = millis();
+    pAddr->lastUsedMs = nowMs;
+
+    // Check concurrent connections
+    bool isAdmitted = true;
+    if ((_maxConnPerAddr > 0) && (pAddr->connCount >= _maxConnPerAddr))
+    {
+        _rejectConnLimitCount++;
+        isAdmitted = false;
+    }
+
+    // Refill token bucket and take a token
+    else if (_connRatePerSec > 0)
+    {
+        uint32_t maxMilliTokens = _connRateBurst * 1000;
+        uint32_t elapsedMs = Raft::timeElapsed(nowMs, pAddr->lastRefillMs);
+        pAddr->lastRefillMs = nowMs;
+        uint64_t milliTokens = pAddr->milliTokens + (uint64_t)elapsedMs * _connRatePerSec;
+        pAddr->milliTokens = milliTokens > maxMilliTokens ? maxMilliTokens : (uint32_t)milliTokens;
+        if (pAddr->milliTokens < 1000)
+        {
+            _rejectRateCount++;
+            isAdmitted = false;
+        }
+        else
+        {
+            pAddr->milliTokens -= 1000;
+        }
+    }
+
+    if (isAdmitted)
+    {
+        pAddr->connCount++;
+        _admitCount++;
+    }
+    uint32_t connCount = pAddr->connCount;
+    RaftMutex_unlock(_admitMutex);
+
+#ifdef WARN_ON_ADMISSION_REJECT
+    if (!isAdmitted)
+        LOG_W(MODULE_PREFIX, "admit REJECTED addr %08x connCount %d", peerAddr, connCount);
+#endif
+#ifdef DEBUG_ADMISSION
+    if (isAdmitted)
+        LOG_I(MODULE_PREFIX, "admit addr %08x connCount %d", peerAddr, connCount);
+#endif
+    return isAdmitted;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Release a connection
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebAdmission::release(uint32_t peerAddr)
+{
+    if (!RaftMutex_lock(_admitMutex, RAFT_MUTEX_WAIT_FOREVER))
+        return;
+    AddrInfo* pAddr = findAddr(peerAddr, false);
+    if (pAddr && (pAddr->connCount > 0))
+        pAddr->connCount--;
+    RaftMutex_unlock(_admitMutex);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stats
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+String RaftWebAdmission::getStatsJSON()
+{
+    uint32_t numAddrs = 0;
+    if (RaftMutex_lock(_admitMutex, RAFT_MUTEX_WAIT_FOREVER))
+    {
+        for (const AddrInfo& addr : _addrs)
+            numAddrs += addr.inUse ? 1 : 0;
+        RaftMutex_unlock(_admitMutex);
+    }
+    return "{\"admitted\":" + String(_admitCount) +
+            ",\"rejConnLimit\":" + String(_rejectConnLimitCount) +
+            ",\"rejRate\":" + String(_rejectRateCount) +
+            ",\"untracked\":" + String(_untrackedCount) +
+            ",\"addrs\":" + String(numAddrs) + "}";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Find address info (mutex must be held)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftWebAdmission::AddrInfo* RaftWebAdmission::findAddr(uint32_t peerAddr, bool addIfMissing)
+{
+    AddrInfo* pReuse = nullptr;
+    for (AddrInfo& addr : _addrs)
+    {
+        if (addr.inUse && (addr.peerAddr == peerAddr))
+            return &addr;
+        if (!addIfMissing || (addr.inUse && (addr.connCount > 0)))
+            continue;
+        if (!pReuse || !addr.inUse ||
+                (pReuse->inUse && (Raft::timeElapsed(millis(), addr.lastUsedMs) > Raft::timeElapsed(millis(), pReuse->lastUsedMs))))
+            pReuse = &addr;
+    }
+    if (!pReuse)
+        return nullptr;
+
+    // New address starts with a full token bucket
+    *pReuse = AddrInfo();
+    pReuse->inUse = true;
+    pReuse->peerAddr = peerAddr;
+    pReuse->milliTokens = _connRateBurst * 1000;
+    pReuse->lastRefillMs = millis();
+    return pReuse;
+}
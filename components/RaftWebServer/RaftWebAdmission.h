@@ -0,0 +1,80 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RaftArduino.h"
+#include "RaftThreading.h"
+
+// Admission control for new connections keyed on the peer address
+// Limits the number of concurrent connections from each address and the rate at which each address
+// can open connections (token bucket) so a single client can't take all the connection slots.
+// Checked by the listener as soon as a connection is accepted (before anything is allocated for it).
+class RaftWebAdmission
+{
+public:
+    RaftWebAdmission();
+    ~RaftWebAdmission();
+
+    // Setup
+    // @param maxConnPerAddr max concurrent connections from one address (0 for no limit)
+    // @param connRatePerSec connections per second each address can open (0 for no limit)
+    // @param connRateBurst connections which can be opened in a burst
+    void setup(uint32_t maxConnPerAddr, uint32_t connRatePerSec, uint32_t connRateBurst);
+
+    // Check if enabled
+    bool isEnabled() const
+    {
+        return (_maxConnPerAddr > 0) || (_connRatePerSec > 0);
+    }
+
+    // Get the key used for an IPv6 address (16 bytes in network order) - IPv4-mapped addresses use the
+    // IPv4 address (as for IPv4 peers) and others a hash of the full address
+    static uint32_t getAddrKeyIPv6(const uint8_t* pAddr);
+
+    // Admit a new connection - returns false if it should be rejected
+    // If admitted release() must be called with the same address when the connection closes
+    bool admit(uint32_t peerAddr);
+
+    // Release a connection
+    void release(uint32_t peerAddr);
+
+    // Stats
+    String getStatsJSON();
+
+private:
+    // Limits
+    uint32_t _maxConnPerAddr = 0;
+    uint32_t _connRatePerSec = 0;
+    uint32_t _connRateBurst = 0;
+
+    // Addresses tracked (entries without connections are reused least recently used first)
+    static const uint32_t MAX_TRACKED_ADDRS = 16;
+    class AddrInfo
+    {
+    public:
+        uint32_t peerAddr = 0;
+        uint32_t connCount = 0;
+        // Tokens are held in thousandths so refill at the configured rate per ms is exact
+        uint32_t milliTokens = 0;
+        uint32_t lastRefillMs = 0;
+        uint32_t lastUsedMs = 0;
+        bool inUse = false;
+    };
+    AddrInfo _addrs[MAX_TRACKED_ADDRS];
+    RaftMutex _admitMutex;
+
+    // Stats
+    uint32_t _admitCount = 0;
+    uint32_t _rejectConnLimitCount = 0;
+    uint32_t _rejectRateCount = 0;
+    uint32_t _untrackedCount = 0;
+
+    // Helpers
+    AddrInfo* findAddr(uint32_t peerAddr, bool addIfMissing);
+};
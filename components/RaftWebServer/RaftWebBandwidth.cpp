@@ -0,0 +1,132 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Logger.h"
+#include "RaftUtils.h"
+#include "RaftJson.h"
+#include "ArduinoTime.h"
+#include "RaftWebBandwidth.h"
+
+// Debug
+// #define DEBUG_BANDWIDTH_CAPS
+
+#if defined(DEBUG_BANDWIDTH_CAPS)
+static const char* MODULE_PREFIX = "RaftWebBandwidth";
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Token bucket
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebTokenBucket::setup(uint32_t bytesPerSec, uint32_t burstBytes)
+{
+    _bytesPerSec = bytesPerSec;
+    _burstBytes = burstBytes > 0 ? burstBytes : (bytesPerSec > 0 ? bytesPerSec : 1);
+    _milliBytes = (uint64_t)_burstBytes * 1000;
+    _lastRefillMs = millis();
+}
+
+uint32_t RaftWebTokenBucket::getAvailable()
+{
+    if (!isEnabled())
+        return UINT32_MAX;
+    uint32_t nowMs = millis();
+    uint32_t elapsedMs = Raft::timeElapsed(nowMs, _lastRefillMs);
+    _lastRefillMs = nowMs;
+    uint64_t maxMilliBytes = (uint64_t)_burstBytes * 1000;
+    _milliBytes += (uint64_t)elapsedMs * _bytesPerSec;
+    if (_milliBytes > maxMilliBytes)
+        _milliBytes = maxMilliBytes;
+    return (uint32_t)(_milliBytes / 1000);
+}
+
+void RaftWebTokenBucket::consume(uint32_t numBytes)
+{
+    uint64_t milliBytes = (uint64_t)numBytes * 1000;
+    _milliBytes = milliBytes < _milliBytes ? _milliBytes - milliBytes : 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Setup
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebBandwidthCaps::setup(const std::vector<String>& capConfigs)
+{
+    _caps.clear();
+    for (const String& capConfig : capConfigs)
+    {
+        RaftJson capJson(capConfig);
+        Cap cap;
+        cap.name = capJson.getString("type", "");
+        if (cap.name.length() == 0)
+        {
+            cap.name = capJson.getString("handler", "");
+            cap.isHandler = true;
+        }
+        cap.bytesPerSec = capJson.getLong("bytesPerSec", 0);
+        cap.burstBytes = capJson.getLong("burst", 0);
+        cap.isPerConn = capJson.getBool("perConn", false);
+        if ((cap.name.length() == 0) || (cap.bytesPerSec == 0))
+            continue;
+        cap.bucket.setup(cap.bytesPerSec, cap.burstBytes);
+        _caps.push_back(cap);
+
+#ifdef DEBUG_BANDWIDTH_CAPS
+        LOG_I(MODULE_PREFIX, "setup %s %s bytesPerSec %d burst %d perConn %d", cap.isHandler ? "handler" : "type",
+                    cap.name.c_str(), cap.bytesPerSec, cap.burstBytes, cap.isPerConn);
+#endif
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Get caps for a connection
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebBandwidthCaps::getCaps(const char* pHandlerName, const char* pResponderType,
+                RaftWebTokenBucket* pSharedBuckets[MAX_CAPS_PER_CONN], RaftWebTokenBucket& connBucket)
+{
+    uint32_t numShared = 0;
+    uint32_t connBytesPerSec = 0;
+    uint32_t connBurstBytes = 0;
+    for (Cap& cap : _caps)
+    {
+        if (!cap.name.equals(cap.isHandler ? pHandlerName : pResponderType))
+            continue;
+        if (cap.isPerConn)
+        {
+            if ((connBytesPerSec == 0) || (cap.bytesPerSec < connBytesPerSec))
+            {
+                connBytesPerSec = cap.bytesPerSec;
+                connBurstBytes = cap.burstBytes;
+            }
+        }
+        else if (numShared < MAX_CAPS_PER_CONN)
+        {
+            pSharedBuckets[numShared++] = &cap.bucket;
+        }
+    }
+    connBucket.setup(connBytesPerSec, connBurstBytes);
+    return numShared;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stats
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+String RaftWebBandwidthCaps::getStatsJSON() const
+{
+    String capsStr;
+    for (const Cap& cap : _caps)
+    {
+        capsStr += String(capsStr.length() == 0 ? "" : ",") + 
+                "{\"" + (cap.isHandler ? "handler" : "type") + "\":\"" + cap.name + "\"" +
+                ",\"bytesPerSec\":" + String(cap.bytesPerSec) +
+                ",\"perConn\":" + String(cap.isPerConn ? 1 : 0) + "}";
+    }
+    return "{\"paced\":" + String(_pacedCount) + ",\"caps\":[" + capsStr + "]}";
+}
@@ -0,0 +1,88 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <list>
+#include <vector>
+#include "RaftArduino.h"
+
+// Token bucket limiting bytes per second (with a burst allowance)
+// Tokens are held in thousandths of a byte so refilling at the rate per ms is exact
+class RaftWebTokenBucket
+{
+public:
+    void setup(uint32_t bytesPerSec, uint32_t burstBytes);
+    bool isEnabled() const
+    {
+        return _bytesPerSec > 0;
+    }
+    uint32_t getBurstBytes() const
+    {
+        return _burstBytes;
+    }
+
+    // Get bytes available now
+    uint32_t getAvailable();
+
+    // Consume bytes sent
+    void consume(uint32_t numBytes);
+
+private:
+    uint32_t _bytesPerSec = 0;
+    uint32_t _burstBytes = 0;
+    uint64_t _milliBytes = 0;
+    uint32_t _lastRefillMs = 0;
+};
+
+// Bandwidth caps for responses - each cap matches responders of a type (e.g. "FILE") or created by a
+// handler (e.g. "HandlerStaticFiles") and either limits all of the matching connections together or
+// each matching connection on its own (perConn)
+// Used only on the connection service task
+class RaftWebBandwidthCaps
+{
+public:
+    // Setup - each config is JSON {"type":"<responderType>"|"handler":"<handlerName>",
+    //                              "bytesPerSec":N,"burst":N,"perConn":0|1}
+    void setup(const std::vector<String>& capConfigs);
+
+    // Check if enabled
+    bool isEnabled() const
+    {
+        return !_caps.empty();
+    }
+
+    // Get caps applying to a connection - returns the number of shared caps (up to MAX_CAPS_PER_CONN)
+    // and sets up connBucket with the lowest matching per connection cap (if any)
+    static const uint32_t MAX_CAPS_PER_CONN = 2;
+    uint32_t getCaps(const char* pHandlerName, const char* pResponderType,
+                RaftWebTokenBucket* pSharedBuckets[MAX_CAPS_PER_CONN], RaftWebTokenBucket& connBucket);
+
+    // Record a response chunk being held back by a cap
+    void recordPaced()
+    {
+        _pacedCount++;
+    }
+
+    // Stats
+    String getStatsJSON() const;
+
+private:
+    class Cap
+    {
+    public:
+        String name;
+        bool isHandler = false;
+        bool isPerConn = false;
+        uint32_t bytesPerSec = 0;
+        uint32_t burstBytes = 0;
+        RaftWebTokenBucket bucket;
+    };
+    std::list<Cap> _caps;
+    uint32_t _pacedCount = 0;
+};
@@ -0,0 +1,445 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "Logger.h"
+#include "RaftWebBodyDecoder.h"
+#include "SpiramAwareAllocator.h"
+
+// Warn
+#define WARN_ON_BODY_DECODE_ERROR
+
+// Debug
+// #define DEBUG_BODY_DECODE_SETUP
+// #define DEBUG_BODY_DECODE_DATA
+
+static const char* MODULE_PREFIX = "RaftWebBodyDecode";
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constructor / Destructor
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftWebBodyDecoder::RaftWebBodyDecoder()
+{
+}
+
+RaftWebBodyDecoder::~RaftWebBodyDecoder()
+{
+    clear();
+}
+
+void RaftWebBodyDecoder::clear()
+{
+    SpiramAwareAllocator<uint8_t> allocator;
+#ifdef RAFT_WEB_BODY_DECODE_SUPPORTED
+    if (_pInflator)
+        allocator.deallocate((uint8_t*)_pInflator, sizeof(tinfl_decompressor));
+    _pInflator = nullptr;
+#endif
+    if (_pWindow)
+        allocator.deallocate(_pWindow, _windowBytes);
+    _pWindow = nullptr;
+    _windowBytes = 0;
+    _heldInput.clear();
+    _heldInput.shrink_to_fit();
+    _inflateOutputPending = false;
+    _undeliveredLen = 0;
+    _state = STATE_ERROR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Check if content encoding requires decoding
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebBodyDecoder::isEncoded(const String& contentEncoding)
+{
+    return (contentEncoding.length() > 0) && !contentEncoding.equalsIgnoreCase("identity");
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Setup
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebBodyDecoder::setup(const String& contentEncoding, uint32_t maxWindowBytes)
+{
+    clear();
+    _decodedLen = 0;
+    _crc32 = 0;
+    _hdrPos = 0;
+    _skipLen = 0;
+    _windowPos = 0;
+    _inflateFlags = 0;
+    _isFinalInput = false;
+    _pErrorStr = "";
+
+    // Check encoding
+    if (contentEncoding.equalsIgnoreCase("gzip") || contentEncoding.equalsIgnoreCase("x-gzip"))
+        _isGzip = true;
+    else if (contentEncoding.equalsIgnoreCase("deflate"))
+        _isGzip = false;
+    else
+    {
+        setError("unsupportedEncoding");
+        return false;
+    }
+
+#ifdef RAFT_WEB_BODY_DECODE_SUPPORTED
+    // Window must be a power of 2
+    _windowBytes = MIN_WINDOW_BYTES;
+    while ((_windowBytes < MAX_WINDOW_BYTES) && (_windowBytes * 2 <= maxWindowBytes))
+        _windowBytes *= 2;
+
+    // Allocate
+    SpiramAwareAllocator<uint8_t> allocator;
+    _pInflator = (tinfl_decompressor*)allocator.allocate(sizeof(tinfl_decompressor));
+    _pWindow = allocator.allocate(_windowBytes);
+    if (!_pInflator || !_pWindow)
+    {
+        clear();
+        setError("insufficientMemory");
+        return false;
+    }
+    tinfl_init(_pInflator);
+    _state = _isGzip ? STATE_GZIP_HEADER : STATE_DEFLATE_DETECT;
+
+#ifdef DEBUG_BODY_DECODE_SETUP
+    LOG_I(MODULE_PREFIX, "setup encoding %s windowBytes %d", contentEncoding.c_str(), _windowBytes);
+#endif
+    return true;
+#else
+    setError("unsupportedEncoding");
+    return false;
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Decode
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftRetCode RaftWebBodyDecoder::decode(const uint8_t* pBuf, uint32_t bufLen, bool isFinal, const RaftWebBodyDecodeCB& decodeCB)
+{
+    if (_state == STATE_ERROR)
+        return RAFT_INVALID_OPERATION;
+
+    // The gzip trailer is the last 8 bytes of the body - keep a copy of the most recent bytes
+    // as the inflater may read ahead into the trailer
+    if (_isGzip)
+    {
+        if (bufLen >= GZIP_TRAILER_LEN)
+        {
+            memcpy(_tailBuf, pBuf + bufLen - GZIP_TRAILER_LEN, GZIP_TRAILER_LEN);
+        }
+        else
+        {
+            memmove(_tailBuf, _tailBuf + bufLen, GZIP_TRAILER_LEN - bufLen);
+            memcpy(_tailBuf + GZIP_TRAILER_LEN - bufLen, pBuf, bufLen);
+        }
+    }
+    if (isFinal)
+        _isFinalInput = true;
+
+    // Data must be decoded in order so if data is held (paused) this is held too
+    if (isPaused())
+    {
+        _heldInput.insert(_heldInput.end(), pBuf, pBuf + bufLen);
+        return resume(decodeCB);
+    }
+
+    // Process and hold anything not consumed
+    uint32_t pos = 0;
+    RaftRetCode retc = processInput(pBuf, bufLen, pos, decodeCB);
+    if (retc == RAFT_BUSY)
+        _heldInput.assign(pBuf + pos, pBuf + bufLen);
+    if ((retc != RAFT_OK) && (retc != RAFT_BUSY))
+        return retc;
+    return isPaused() ? RAFT_BUSY : checkEnd();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Resume decoding held data
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftRetCode RaftWebBodyDecoder::resume(const RaftWebBodyDecodeCB& decodeCB)
+{
+    if (_state == STATE_ERROR)
+        return RAFT_INVALID_OPERATION;
+    uint32_t pos = 0;
+    RaftRetCode retc = processInput(_heldInput.data(), _heldInput.size(), pos, decodeCB);
+    _heldInput.erase(_heldInput.begin(), _heldInput.begin() + pos);
+    if ((retc != RAFT_OK) && (retc != RAFT_BUSY))
+        return retc;
+    return isPaused() ? RAFT_BUSY : checkEnd();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Process encoded data - pos is the position reached (RAFT_BUSY if paused before the end)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftRetCode RaftWebBodyDecoder::processInput(const uint8_t* pBuf, uint32_t bufLen, uint32_t& pos,
+            const RaftWebBodyDecodeCB& decodeCB)
+{
+    // Pass on decoded data held back when paused
+    if ((_undeliveredLen > 0) && !deliverDecoded(decodeCB))
+        return RAFT_BUSY;
+
+    // Process
+    while (((pos < bufLen) || _inflateOutputPending) && (_state != STATE_DONE))
+    {
+        switch (_state)
+        {
+            case STATE_GZIP_HEADER:
+            {
+                _hdrBuf[_hdrPos++] = pBuf[pos++];
+                if (_hdrPos < GZIP_HEADER_LEN)
+                    break;
+                if ((_hdrBuf[0] != 0x1f) || (_hdrBuf[1] != 0x8b) || (_hdrBuf[2] != 8))
+                    return setError("invalidGzipHeader");
+                _gzipFlags = _hdrBuf[3];
+                advanceGzipHeader();
+                break;
+            }
+            case STATE_GZIP_EXTRA_LEN:
+            {
+                _hdrBuf[_hdrPos++] = pBuf[pos++];
+                if (_hdrPos < 2)
+                    break;
+                _skipLen = _hdrBuf[0] | (_hdrBuf[1] << 8);
+                _state = STATE_GZIP_SKIP;
+                [[fallthrough]];
+            }
+            case STATE_GZIP_SKIP:
+            {
+                uint32_t toSkip = bufLen - pos < _skipLen ? bufLen - pos : _skipLen;
+                pos += toSkip;
+                _skipLen -= toSkip;
+                if (_skipLen == 0)
+                    advanceGzipHeader();
+                break;
+            }
+            case STATE_GZIP_STRING:
+            {
+                const uint8_t* pTerm = (const uint8_t*)memchr(pBuf + pos, 0, bufLen - pos);
+                if (!pTerm)
+                {
+                    pos = bufLen;
+                    break;
+                }
+                pos = pTerm - pBuf + 1;
+                advanceGzipHeader();
+                break;
+            }
+            case STATE_DEFLATE_DETECT:
+            {
+                // Distinguish zlib wrapped (as specified for HTTP deflate) from raw deflate
+                _hdrBuf[_hdrPos++] = pBuf[pos++];
+                if (_hdrPos < 2)
+                    break;
+                _state = STATE_INFLATE;
+                if (((_hdrBuf[0] & 0x0f) == 8) && ((((uint32_t)_hdrBuf[0] << 8) | _hdrBuf[1]) % 31 == 0))
+                {
+                    uint32_t streamWindowBytes = 1 << ((_hdrBuf[0] >> 4) + 8);
+                    if (streamWindowBytes > _windowBytes)
+                        return setError("windowTooLarge");
+#ifdef RAFT_WEB_BODY_DECODE_SUPPORTED
+                    _inflateFlags = TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_COMPUTE_ADLER32;
+#endif
+                }
+
+                // These two bytes produce at most a few bytes of output so aren't paused
+                uint32_t consumed = 0;
+                RaftRetCode retc = inflateData(_hdrBuf, 2, consumed, false,
+                        [&decodeCB](const uint8_t* pDecoded, uint32_t decodedLen) {
+                            decodeCB(pDecoded, decodedLen);
+                            return true;
+                        });
+                if (retc != RAFT_OK)
+                    return retc;
+                break;
+            }
+            case STATE_INFLATE:
+            {
+                uint32_t consumed = 0;
+                RaftRetCode retc = inflateData(pBuf + pos, bufLen - pos, consumed, _isFinalInput, decodeCB);
+                pos += consumed;
+                if (retc != RAFT_OK)
+                    return retc;
+                break;
+            }
+            default:
+                return setError("invalidState");
+        }
+    }
+    return RAFT_OK;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Check end of body (once all the final data is decoded)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftRetCode RaftWebBodyDecoder::checkEnd()
+{
+    if (!_isFinalInput)
+        return RAFT_OK;
+    if (_state != STATE_DONE)
+        return setError("truncated");
+    if (_isGzip)
+    {
+        uint32_t trailerCRC = _tailBuf[0] | (_tailBuf[1] << 8) | (_tailBuf[2] << 16) | ((uint32_t)_tailBuf[3] << 24);
+        uint32_t trailerLen = _tailBuf[4] | (_tailBuf[5] << 8) | (_tailBuf[6] << 16) | ((uint32_t)_tailBuf[7] << 24);
+        if ((trailerCRC != _crc32) || (trailerLen != _decodedLen))
+            return setError("crcMismatch");
+    }
+
+#ifdef DEBUG_BODY_DECODE_DATA
+    LOG_I(MODULE_PREFIX, "decode complete decodedLen %d", _decodedLen);
+#endif
+    return RAFT_OK;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Move to the next part of the gzip header (optional fields are in the order extra, name, comment, hcrc)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebBodyDecoder::advanceGzipHeader()
+{
+    _hdrPos = 0;
+    if (_gzipFlags & GZIP_FLAG_EXTRA)
+    {
+        _gzipFlags &= ~GZIP_FLAG_EXTRA;
+        _state = STATE_GZIP_EXTRA_LEN;
+    }
+    else if (_gzipFlags & GZIP_FLAG_NAME)
+    {
+        _gzipFlags &= ~GZIP_FLAG_NAME;
+        _state = STATE_GZIP_STRING;
+    }
+    else if (_gzipFlags & GZIP_FLAG_COMMENT)
+    {
+        _gzipFlags &= ~GZIP_FLAG_COMMENT;
+        _state = STATE_GZIP_STRING;
+    }
+    else if (_gzipFlags & GZIP_FLAG_HCRC)
+    {
+        _gzipFlags &= ~GZIP_FLAG_HCRC;
+        _skipLen = 2;
+        _state = STATE_GZIP_SKIP;
+    }
+    else
+    {
+        _state = STATE_INFLATE;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Inflate data through the circular window
+// Returns RAFT_BUSY (consumed is the data used) if decodeCB can't accept more and data remains
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftRetCode RaftWebBodyDecoder::inflateData(const uint8_t* pBuf, uint32_t bufLen, uint32_t& consumed, bool isFinal,
+            const RaftWebBodyDecodeCB& decodeCB)
+{
+    consumed = 0;
+#ifdef RAFT_WEB_BODY_DECODE_SUPPORTED
+    while (true)
+    {
+        size_t inBytes = bufLen - consumed;
+        size_t outBytes = _windowBytes - _windowPos;
+        uint32_t flags = _inflateFlags | (isFinal ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+        tinfl_status status = tinfl_decompress(_pInflator, pBuf + consumed, &inBytes,
+                    _pWindow, _pWindow + _windowPos, &outBytes, flags);
+        consumed += inBytes;
+
+        // Pass on decoded data (the window isn't written again until all of it has been passed on)
+        if (outBytes > 0)
+        {
+            if (_isGzip)
+                _crc32 = crc32Update(_crc32, _pWindow + _windowPos, outBytes);
+            _decodedLen += outBytes;
+            _undeliveredPos = _windowPos;
+            _undeliveredLen = outBytes;
+            _windowPos = (_windowPos + outBytes) & (_windowBytes - 1);
+        }
+        bool canAcceptMore = deliverDecoded(decodeCB);
+
+        // Check status
+        _inflateOutputPending = false;
+        if (status == TINFL_STATUS_DONE)
+        {
+            _state = STATE_DONE;
+            consumed = bufLen;
+            return _undeliveredLen > 0 ? RAFT_BUSY : RAFT_OK;
+        }
+        if (status == TINFL_STATUS_NEEDS_MORE_INPUT)
+            return _undeliveredLen > 0 ? RAFT_BUSY : RAFT_OK;
+        if (status != TINFL_STATUS_HAS_MORE_OUTPUT)
+            return setError(status == TINFL_STATUS_ADLER32_MISMATCH ? "adler32Mismatch" : "inflateFailed");
+
+        // Window full - pause if decoded data can't be accepted (the inflater keeps its state so
+        // the pending output is produced on resume)
+        if (!canAcceptMore)
+        {
+            _inflateOutputPending = true;
+            return RAFT_BUSY;
+        }
+    }
+#else
+    return setError("unsupportedEncoding");
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pass decoded data on in blocks - returns false if decodeCB can't accept more
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebBodyDecoder::deliverDecoded(const RaftWebBodyDecodeCB& decodeCB)
+{
+    while (_undeliveredLen > 0)
+    {
+        uint32_t blockLen = _undeliveredLen < DECODE_BLOCK_MAX_BYTES ? _undeliveredLen : DECODE_BLOCK_MAX_BYTES;
+        bool canAcceptMore = !decodeCB || decodeCB(_pWindow + _undeliveredPos, blockLen);
+        _undeliveredPos += blockLen;
+        _undeliveredLen -= blockLen;
+        if (!canAcceptMore)
+            return false;
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Error
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftRetCode RaftWebBodyDecoder::setError(const char* pErrorStr)
+{
+    _state = STATE_ERROR;
+    _pErrorStr = pErrorStr;
+#ifdef WARN_ON_BODY_DECODE_ERROR
+    LOG_W(MODULE_PREFIX, "decode error %s decodedLen %d", pErrorStr, _decodedLen);
+#endif
+    return RAFT_INVALID_DATA;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CRC32 (as used by gzip) - nibble table to keep the table small
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebBodyDecoder::crc32Update(uint32_t crc, const uint8_t* pBuf, uint32_t bufLen)
+{
+    static const uint32_t CRC32_NIBBLE_TABLE[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+    };
+    crc = ~crc;
+    for (uint32_t i = 0; i < bufLen; i++)
+    {
+        crc ^= pBuf[i];
+        crc = (crc >> 4) ^ CRC32_NIBBLE_TABLE[crc & 0x0f];
+        crc = (crc >> 4) ^ CRC32_NIBBLE_TABLE[crc & 0x0f];
+    }
+    return ~crc;
+}
@@ -0,0 +1,151 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+#include "RaftArduino.h"
+#include "RaftRetCode.h"
+#include "SpiramAwareAllocator.h"
+
+// Inflate is provided by miniz (in ROM on ESP32 devices)
+#if __has_include("miniz.h")
+#include "miniz.h"
+#define RAFT_WEB_BODY_DECODE_SUPPORTED
+#elif __has_include("rom/miniz.h")
+#include "rom/miniz.h"
+#define RAFT_WEB_BODY_DECODE_SUPPORTED
+#endif
+
+// Callback for decoded data - returns false if no more decoded data can be accepted for now
+typedef std::function<bool(const uint8_t* pBuf, uint32_t bufLen)> RaftWebBodyDecodeCB;
+
+// Streaming decoder for request bodies with Content-Encoding gzip or deflate
+// Decoded data is produced through a circular window (power of 2 up to 32KB) which bounds RAM use.
+// Data compressed with a larger window than this can't be decoded - this is detected from the
+// header for zlib (deflate) streams and by the CRC32 check in the trailer for gzip streams.
+// Compressed data can expand many times over so decoding pauses when the decode callback can't
+// accept more - the encoded data not yet consumed is held and decoding continues in resume().
+class RaftWebBodyDecoder
+{
+public:
+    RaftWebBodyDecoder();
+    ~RaftWebBodyDecoder();
+
+    // Check if a content encoding requires decoding (false for identity or no encoding)
+    static bool isEncoded(const String& contentEncoding);
+
+    // Setup - returns false if the encoding isn't supported or memory isn't available
+    bool setup(const String& contentEncoding, uint32_t maxWindowBytes);
+
+    // Decode data - decodeCB is called with decoded data as it becomes available
+    // isFinal must be set on the last block of the body
+    // Returns RAFT_BUSY if decoding paused (see resume()), RAFT_OK once all data so far is decoded
+    RaftRetCode decode(const uint8_t* pBuf, uint32_t bufLen, bool isFinal, const RaftWebBodyDecodeCB& decodeCB);
+
+    // Resume decoding of held data after a pause - return values as for decode()
+    RaftRetCode resume(const RaftWebBodyDecodeCB& decodeCB);
+
+    // Check if decoding is paused with data still to decode
+    bool isPaused() const
+    {
+        return (_state != STATE_ERROR) && (!_heldInput.empty() || _inflateOutputPending || (_undeliveredLen > 0));
+    }
+
+    // Decoded length so far
+    uint32_t getDecodedLen() const
+    {
+        return _decodedLen;
+    }
+
+    // Check done
+    bool isDone() const
+    {
+        return _state == STATE_DONE;
+    }
+
+    // Error string (empty if no error)
+    const char* getErrorStr() const
+    {
+        return _pErrorStr;
+    }
+
+    // Window limits
+    static const uint32_t MIN_WINDOW_BYTES = 1024;
+    static const uint32_t MAX_WINDOW_BYTES = 32768;
+
+    // CRC32 (as used by gzip)
+    static uint32_t crc32Update(uint32_t crc, const uint8_t* pBuf, uint32_t bufLen);
+
+private:
+    enum DecodeState
+    {
+        STATE_GZIP_HEADER,
+        STATE_GZIP_EXTRA_LEN,
+        STATE_GZIP_SKIP,
+        STATE_GZIP_STRING,
+        STATE_DEFLATE_DETECT,
+        STATE_INFLATE,
+        STATE_DONE,
+        STATE_ERROR
+    };
+    DecodeState _state = STATE_ERROR;
+    bool _isGzip = false;
+
+    // Header/trailer bytes
+    static const uint32_t GZIP_HEADER_LEN = 10;
+    static const uint32_t GZIP_TRAILER_LEN = 8;
+    static const uint8_t GZIP_FLAG_HCRC = 0x02;
+    static const uint8_t GZIP_FLAG_EXTRA = 0x04;
+    static const uint8_t GZIP_FLAG_NAME = 0x08;
+    static const uint8_t GZIP_FLAG_COMMENT = 0x10;
+    uint8_t _hdrBuf[GZIP_HEADER_LEN];
+    uint8_t _tailBuf[GZIP_TRAILER_LEN] = {};
+    uint32_t _hdrPos = 0;
+    uint32_t _skipLen = 0;
+    uint8_t _gzipFlags = 0;
+
+    // Inflate state and circular output window
+#ifdef RAFT_WEB_BODY_DECODE_SUPPORTED
+    tinfl_decompressor* _pInflator = nullptr;
+#endif
+    uint8_t* _pWindow = nullptr;
+    uint32_t _windowBytes = 0;
+    uint32_t _windowPos = 0;
+    uint32_t _inflateFlags = 0;
+
+    // Decoded data is passed on in blocks of up to this size (so a pause holds back at most this
+    // much more than the consumer can take) - data in the window not yet passed on is tracked
+    static const uint32_t DECODE_BLOCK_MAX_BYTES = 1024;
+    uint32_t _undeliveredPos = 0;
+    uint32_t _undeliveredLen = 0;
+
+    // Encoded data held while paused and whether the inflater has output pending
+    std::vector<uint8_t, SpiramAwareAllocator<uint8_t>> _heldInput;
+    bool _inflateOutputPending = false;
+    bool _isFinalInput = false;
+
+    // Decoded length and CRC (gzip)
+    uint32_t _decodedLen = 0;
+    uint32_t _crc32 = 0;
+
+    // Error
+    const char* _pErrorStr = "";
+
+    // Helpers
+    void clear();
+    RaftRetCode setError(const char* pErrorStr);
+    void advanceGzipHeader();
+    RaftRetCode processInput(const uint8_t* pBuf, uint32_t bufLen, uint32_t& pos, const RaftWebBodyDecodeCB& decodeCB);
+    RaftRetCode checkEnd();
+    bool deliverDecoded(const RaftWebBodyDecodeCB& decodeCB);
+    RaftRetCode inflateData(const uint8_t* pBuf, uint32_t bufLen, uint32_t& consumed, bool isFinal,
+                const RaftWebBodyDecodeCB& decodeCB);
+};
@@ -38,9 +38,45 @@ public:
     }
 };
 
+// Class of service of a connection (determined when the request header has been received)
+enum RaftWebConnClass
+{
+    WEB_CONN_CLASS_NONE = -1,
+    WEB_CONN_CLASS_WS,
+    WEB_CONN_CLASS_SSE,
+    WEB_CONN_CLASS_REST,
+    WEB_CONN_CLASS_STATIC,
+    WEB_CONN_CLASS_MAX
+};
+class RaftWebConnClassDefs
+{
+public:
+    static const char* getConnClassStr(RaftWebConnClass connClass)
+    {
+        switch(connClass)
+        {
+            case WEB_CONN_CLASS_WS: return "ws";
+            case WEB_CONN_CLASS_SSE: return "sse";
+            case WEB_CONN_CLASS_REST: return "rest";
+            case WEB_CONN_CLASS_STATIC: return "static";
+            default: return "none";
+        }
+    }
+};
+
 // Function to test if connection is ready to send
 typedef std::function<RaftWebConnSendRetVal()> RaftWebConnReadyToSendFn;
 
 // Function to send on a connection
 typedef std::function<RaftWebConnSendRetVal(const uint8_t* pBuf, uint32_t bufLen, uint32_t maxSendRetryMs)> RaftWebConnSendFn;
 
+// Timers a responder can run on its connection (the responder's onTimer() is called on expiry)
+enum RaftWebConnRespTimer
+{
+    WEB_CONN_RESP_TIMER_PING,
+    WEB_CONN_RESP_TIMER_NO_PONG
+};
+
+// Function to start (or restart) a responder timer on a connection - durationMs == 0 cancels
+typedef std::function<void(RaftWebConnRespTimer respTimer, uint32_t durationMs)> RaftWebConnTimerFn;
+
@@ -13,7 +13,13 @@
 #include "RaftWebConnection.h"
 #include "RaftWebHandler.h"
 #include "RaftWebHandlerWS.h"
+#include "RaftWebHandlerSSEvents.h"
 #include "RaftWebResponder.h"
+#include "RaftWebFramePool.h"
+#include "RaftWebUploadPipeline.h"
+#include "RaftWebWorkerPool.h"
+#include "RaftWebRespCache.h"
+#include "RaftWebSingleFlight.h"
 #include "RaftUtils.h"
 #include "esp_heap_caps.h"
 
@@ -31,6 +37,7 @@ const static char* MODULE_PREFIX = "WebConnMgr";
 
 // Warn
 #define WARN_ON_NO_EMPTY_SLOTS_FOR_CONNECTION
+#define WARN_ON_PUBLISH_NO_FRAME
 
 // Debug
 // #define DEBUG_WEB_CONN_MANAGER
@@ -38,6 +45,7 @@ const static char* MODULE_PREFIX = "WebConnMgr";
 // #define DEBUG_WEBSOCKETS
 // #define DEBUG_WEBSOCKETS_SEND
 // #define DEBUG_WEBSOCKETS_SEND_DETAIL
+// #define DEBUG_WEB_CONN_PUBLISH
 // #define DEBUG_NEW_RESPONDER
 // #define DEBUG_WEBCONN_SERVICE_TIMING
 // #define DEBUG_CAN_SEND_TIMING
@@ -60,6 +68,10 @@ RaftWebConnManager::~RaftWebConnManager()
     {
         delete pHandler;
     }
+
+    // Delete rejected connections
+    for (RejectedConn& rejectedConn : _rejectedConns)
+        delete rejectedConn.pClientConn;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -74,6 +86,63 @@ void RaftWebConnManager::setup(const RaftWebServerSettings &settings)
     // Create slots
     _webConnections.resize(_webServerSettings.numConnSlots);
 
+    // Timers for each connection are held on a timer wheel
+    _timerWheel.setup(_webConnections.size() * RaftWebConnection::CONN_TIMER_MAX, millis());
+    for (uint32_t i = 0; i < _webConnections.size(); i++)
+        _webConnections[i].setTimerWheel(&_timerWheel, i);
+
+    // Setup pool of websocket frame buffers
+    RaftWebFramePool::setup(_webServerSettings.framePoolBlocks, _webServerSettings.framePoolBlockBytes);
+
+    // Setup upload pipeline (if enabled)
+    RaftWebUploadPipeline::setup(_webServerSettings.uploadPipelineBuffers, _webServerSettings.uploadPipelineBufferBytes);
+
+    // Setup REST API worker pool (if enabled)
+    RaftWebWorkerPool::setup(_webServerSettings.restWorkers, _webServerSettings.restWorkerQueueDepth,
+            _webServerSettings.restWorkerCore, _webServerSettings.restWorkerPriority, 
+            _webServerSettings.restWorkerStackBytes);
+
+    // Setup REST API response cache (if enabled)
+    RaftWebRespCache::setup(_webServerSettings.respCacheMaxBytes);
+
+    // Setup coalescing of identical REST API requests (if enabled)
+    RaftWebSingleFlight::setup(_webServerSettings.restCoalesceGets);
+
+    // Setup admission control for new connections (if enabled)
+    _connClientListener.getAdmission().setup(_webServerSettings.connMaxPerAddr,
+            _webServerSettings.connRatePerSec, _webServerSettings.connRateBurst);
+
+    // Setup slot pools for each class of service (if enabled)
+    uint32_t minSlots[WEB_CONN_CLASS_MAX] = {};
+    minSlots[WEB_CONN_CLASS_WS] = _webServerSettings.minSlotsWS;
+    minSlots[WEB_CONN_CLASS_SSE] = _webServerSettings.minSlotsSSE;
+    minSlots[WEB_CONN_CLASS_REST] = _webServerSettings.minSlotsREST;
+    minSlots[WEB_CONN_CLASS_STATIC] = _webServerSettings.minSlotsStatic;
+    _slotPools.setup(_webServerSettings.numConnSlots, minSlots);
+
+    // Setup bandwidth caps (if any)
+    _bandwidthCaps.setup(_webServerSettings.bandwidthCaps);
+
+    // Precompute overload response so rejecting a connection doesn't need a slot or responder
+    _overloadResp = "";
+    if (_webServerSettings.overloadRetryAfterSecs > 0)
+        _overloadResp = "HTTP/1.1 503 Service Unavailable\r\nRetry-After: " + 
+                String(_webServerSettings.overloadRetryAfterSecs) +
+                "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+    // Paths allowed to use reserved slots
+    _reservedSlotPaths.clear();
+    String reservedSlotPaths = _webServerSettings.reservedSlotPaths;
+    while (reservedSlotPaths.length() > 0)
+    {
+        int sepPos = reservedSlotPaths.indexOf(',');
+        String path = sepPos < 0 ? reservedSlotPaths : reservedSlotPaths.substring(0, sepPos);
+        reservedSlotPaths = sepPos < 0 ? "" : reservedSlotPaths.substring(sepPos + 1);
+        path.trim();
+        if (path.length() > 0)
+            _reservedSlotPaths.push_back(path);
+    }
+
 #ifdef USE_THREAD_FOR_CLIENT_CONN_SERVICING
     // Start task to service connections
     RaftThread_start(_clientConnHandlerTaskHandle, &clientConnHandlerTask, this, 
@@ -133,10 +202,35 @@ void RaftWebConnManager::clientConnHandlerTask(void *pvParameters)
     while (1)
     {
         pConnMgr->serviceConnections();
+        uint32_t sleepMs = pConnMgr->getServiceSleepMs();
+        if (sleepMs > 0)
+            RaftThread_sleep(sleepMs);
     }
 #endif
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Get time the service task can sleep - zero while any request is in progress otherwise until the
+// next connection timer is due (capped at the poll interval)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebConnManager::getServiceSleepMs()
+{
+#ifdef USE_THREAD_FOR_CLIENT_CONN_SERVICING
+    if (!_rejectedConns.empty())
+        return 0;
+    for (RaftWebConnection &webConn : _webConnections)
+    {
+        if (webConn.isBusy())
+            return 0;
+    }
+    uint32_t msToNextTimer = _timerWheel.getMsToNextExpiry(millis());
+    return msToNextTimer < CLIENT_CONN_SERVICE_POLL_MS ? msToNextTimer : CLIENT_CONN_SERVICE_POLL_MS;
+#else
+    return 0;
+#endif
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Service Connections
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -157,11 +251,40 @@ void RaftWebConnManager::serviceConnections()
     _debugTimerExistingConns.started();
 #endif
 
+    // Detect a service-loop stall: if a long time has elapsed since connections were last
+    // serviced then the whole system was blocked (e.g. a flash erase during OTA or a file
+    // upload disables the flash cache and starves all tasks) so idle timeouts are forgiven
+    uint32_t nowMs = millis();
+    if (_lastServiceMs != 0)
+    {
+        uint32_t sinceLastServiceMs = Raft::timeElapsed(nowMs, _lastServiceMs);
+        if (sinceLastServiceMs > CONN_SERVICE_STALL_THRESHOLD_MS)
+        {
+            LOG_W(MODULE_PREFIX, "serviceConnections stall %dms - forgiving idle timeouts", (int)sinceLastServiceMs);
+            for (RaftWebConnection &webConn : _webConnections)
+                webConn.forgiveStall(nowMs);
+        }
+    }
+    _lastServiceMs = nowMs;
+
+    // Handle connection timers which have expired
+    _timerWheel.advance(nowMs, [this](uint32_t timerIdx, uint32_t expiredMs) {
+        _webConnections[timerIdx / RaftWebConnection::CONN_TIMER_MAX].onTimer(
+                    (RaftWebConnection::ConnTimer)(timerIdx % RaftWebConnection::CONN_TIMER_MAX), expiredMs);
+    });
+
     // Service existing connections or close them if inactive
-    for (RaftWebConnection &webConn : _webConnections)
+    if (_webServerSettings.txQuantumBytes == 0)
     {
-        // Service connection
-        webConn.loop();
+        for (RaftWebConnection &webConn : _webConnections)
+        {
+            // Service connection
+            webConn.loop();
+        }
+    }
+    else
+    {
+        serviceConnectionsScheduled();
     }
 
     // Check heap after servicing all connections
@@ -193,8 +316,8 @@ void RaftWebConnManager::serviceConnections()
             // Debug
             LOG_W(MODULE_PREFIX, "serviceConn can't handle connClient %d", pClientConn->getClientId());
 
-            // Delete client (which closes any connection)
-            delete pClientConn;
+            // Send overload response and close once the request has been read
+            rejectConnection(pClientConn);
         }
 
         // Check heap after accommodating new connection
@@ -206,11 +329,61 @@ void RaftWebConnManager::serviceConnections()
 #endif
     }
 
+    // Read and discard requests on rejected connections
+    serviceRejectedConns();
+
 #ifdef DEBUG_WEBCONN_SERVICE_TIMING
     _debugTimerNewConns.ended();
 #endif
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Service connections with transmit scheduling
+// Websocket and server-side event connections are serviced first and aren't limited. If other connections
+// contend for the link (more than one has response data waiting or websocket/event sessions are open)
+// each gets a quantum of bytes per round weighted by class (deficit round robin)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebConnManager::serviceConnectionsScheduled()
+{
+    // Check contention
+    uint32_t numBulkPending = 0;
+    bool isPrioritySession = false;
+    for (RaftWebConnection &webConn : _webConnections)
+    {
+        RaftWebConnClass connClass = webConn.getConnClass();
+        if ((connClass == WEB_CONN_CLASS_WS) || (connClass == WEB_CONN_CLASS_SSE))
+            isPrioritySession = true;
+        else if (webConn.isTxPending())
+            numBulkPending++;
+    }
+    bool isContended = (numBulkPending > 1) || ((numBulkPending > 0) && isPrioritySession);
+    if (isContended)
+        _txContendedRounds++;
+
+    // Service priority connections
+    for (RaftWebConnection &webConn : _webConnections)
+    {
+        RaftWebConnClass connClass = webConn.getConnClass();
+        if ((connClass == WEB_CONN_CLASS_WS) || (connClass == WEB_CONN_CLASS_SSE))
+            webConn.loop();
+    }
+
+    // Service other connections - connections with nothing to send lose any deficit
+    for (RaftWebConnection &webConn : _webConnections)
+    {
+        RaftWebConnClass connClass = webConn.getConnClass();
+        if ((connClass == WEB_CONN_CLASS_WS) || (connClass == WEB_CONN_CLASS_SSE))
+            continue;
+        uint32_t weight = connClass == WEB_CONN_CLASS_STATIC ? _webServerSettings.txWeightStatic : _webServerSettings.txWeightREST;
+        if (!isContended || !webConn.isTxPending())
+            webConn.addTxQuantum(0);
+        else
+            webConn.addTxQuantum(_webServerSettings.txQuantumBytes * (weight > 0 ? weight : 1));
+        webConn.loop();
+    }
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Accommodate new connections if possible
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -219,7 +392,8 @@ bool RaftWebConnManager::accommodateConnection(RaftClientConnBase* pClientConn)
 {
     // Handle the new connection if we can
     uint32_t slotIdx = 0;
-    if (!findEmptySlot(slotIdx))
+    uint32_t numFreeSlots = 0;
+    if (!findEmptySlot(slotIdx, numFreeSlots) && !evictIdleConnection(slotIdx))
     {
 #ifdef WARN_ON_NO_EMPTY_SLOTS_FOR_CONNECTION
         LOG_W(MODULE_PREFIX, "accommodateConnection no empty slot for connClient %d", pClientConn->getClientId());
@@ -232,9 +406,12 @@ bool RaftWebConnManager::accommodateConnection(RaftClientConnBase* pClientConn)
     LOG_I(MODULE_PREFIX, "accommodateConnection connClient %d", pClientConn->getClientId());
 #endif
 
+    // The last free slots are reserved (the request is checked when its header has been received)
+    bool isReservedSlot = numFreeSlots <= _webServerSettings.reservedConnSlots;
+
     // Place new connection in slot - after this point the WebConnection is responsible for deleting
     if (!_webConnections[slotIdx].setNewConn(pClientConn, this, _webServerSettings.sendBufferMaxLen,
-                    _webServerSettings.clearPendingDurationMs))
+                    _webServerSettings.clearPendingDurationMs, isReservedSlot))
         return false;
     return true;
 }
@@ -243,19 +420,132 @@ bool RaftWebConnManager::accommodateConnection(RaftClientConnBase* pClientConn)
 // Find an empty slot
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool RaftWebConnManager::findEmptySlot(uint32_t &slotIdx)
+bool RaftWebConnManager::findEmptySlot(uint32_t &slotIdx, uint32_t& numFreeSlots)
 {
     // Check for inactive slots
+    numFreeSlots = 0;
     for (uint32_t i = 0; i < _webConnections.size(); i++)
     {
         // Check
         if (_webConnections[i].isActive())
             continue;
 
-        // Return inactive
-        slotIdx = i;
+        // Use first inactive
+        if (numFreeSlots == 0)
+            slotIdx = i;
+        numFreeSlots++;
+    }
+    return numFreeSlots > 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Evict the least recently active idle connection to free a slot
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebConnManager::evictIdleConnection(uint32_t& slotIdx)
+{
+    if (_webServerSettings.connEvictMinIdleMs == 0)
+        return false;
+
+    // Find the evictable connection which has been idle longest
+    bool found = false;
+    uint32_t maxIdleMs = 0;
+    for (uint32_t i = 0; i < _webConnections.size(); i++)
+    {
+        uint32_t idleMs = 0;
+        if (!_webConnections[i].isEvictable(_webServerSettings.connEvictMinIdleMs, idleMs))
+            continue;
+        if (!found || (idleMs > maxIdleMs))
+        {
+            slotIdx = i;
+            maxIdleMs = idleMs;
+            found = true;
+        }
+    }
+    if (!found)
+    {
+        _evictNoneCount++;
+        return false;
+    }
+
+#ifdef DEBUG_WEB_CONN_MANAGER
+    LOG_I(MODULE_PREFIX, "evictIdleConnection slot %d idleMs %d", slotIdx, maxIdleMs);
+#endif
+
+    // Clear (closes the connection)
+    _webConnections[slotIdx].clear();
+    _evictCount++;
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reject a connection - sends the precomputed overload response (if enabled) and deletes the connection
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebConnManager::rejectConnection(RaftClientConnBase* pClientConn)
+{
+    _overloadRejectCount++;
+    if (_overloadResp.length() == 0)
+    {
+        delete pClientConn;
+        return;
+    }
+
+    // Send the response and half-close
+    pClientConn->setup(false);
+    uint32_t bytesWritten = 0;
+    pClientConn->sendDataBuffer((const uint8_t*)_overloadResp.c_str(), _overloadResp.length(),
+                OVERLOAD_RESP_MAX_SEND_MS, bytesWritten);
+    pClientConn->shutdownSend();
+
+    // Hold the connection while the request is drained (the oldest is closed if too many are held)
+    if (_rejectedConns.size() >= REJECTED_CONN_MAX)
+    {
+        delete _rejectedConns.front().pClientConn;
+        _rejectedConns.pop_front();
+    }
+    RejectedConn rejectedConn;
+    rejectedConn.pClientConn = pClientConn;
+    rejectedConn.startMs = millis();
+    _rejectedConns.push_back(rejectedConn);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Drain rejected connections - closed when the client closes or after a time/byte limit
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebConnManager::serviceRejectedConns()
+{
+    for (auto it = _rejectedConns.begin(); it != _rejectedConns.end();)
+    {
+        RaftClientConnRslt connRslt = it->pClientConn->getDataStart(_rejectedRxBuf);
+        it->bytesDrained += _rejectedRxBuf.size();
+        it->pClientConn->getDataEnd();
+        if ((connRslt != CLIENT_CONN_RSLT_OK) || (it->bytesDrained > REJECTED_CONN_DRAIN_MAX_BYTES) ||
+                    Raft::isTimeout(millis(), it->startMs, REJECTED_CONN_DRAIN_MAX_MS))
+        {
+            delete it->pClientConn;
+            it = _rejectedConns.erase(it);
+            continue;
+        }
+        ++it;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Check if a request can use a reserved slot
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebConnManager::isReservedSlotAllowed(const RaftWebRequestHeader& header)
+{
+    if (header.reqConnType == REQ_CONN_TYPE_WEBSOCKET)
         return true;
+    for (const String& path : _reservedSlotPaths)
+    {
+        if (header.URL.startsWith(path))
+            return true;
     }
+    _reservedRejectCount++;
     return false;
 }
 
@@ -339,7 +629,8 @@ bool RaftWebConnManager::addHandler(RaftWebHandler *pHandler, bool highPriority)
 
 RaftWebResponder *RaftWebConnManager::getNewResponder(const RaftWebRequestHeader &header,
                                                   const RaftWebRequestParams &params, 
-                                                  RaftHttpStatusCode &statusCode)
+                                                  RaftHttpStatusCode &statusCode,
+                                                  RaftWebHandler** ppHandler)
 {
     // Iterate handlers to find one that gives a responder
     statusCode = HTTP_STATUS_NOTFOUND;
@@ -365,7 +656,11 @@ RaftWebResponder *RaftWebConnManager::getNewResponder(const RaftWebRequestHeader
 
             // Return responder if there is one
             if (pResponder)
+            {
+                if (ppHandler)
+                    *ppHandler = pHandler;
                 return pResponder;
+            }
 
             // Check status and return status code if something matched but there was
             // another error
@@ -509,15 +804,159 @@ bool RaftWebConnManager::sendBufOnChannel(const uint8_t* pBuf, uint32_t bufLen,
 
 void RaftWebConnManager::serverSideEventsSendMsg(const char *eventContent, const char *eventGroup)
 {
-    for (uint32_t i = 0; i < _webConnections.size(); i++)
+    // Events are added to the handler's event ring and sent by each subscriber's responder
+    for (RaftWebHandler* pHandler : _webHandlers)
     {
-        // Check active
-        if (!_webConnections[i].isActive())
+        if (pHandler->isSSEventsHandler())
+            static_cast<RaftWebHandlerSSEvents*>(pHandler)->sendEvent(eventContent, eventGroup);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Link quality stats
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebConnManager::getChannelLinkStats(uint32_t channelID, RaftWebLinkStats& linkStats)
+{
+    for (RaftWebConnection& webConn : _webConnections)
+    {
+        if (!webConn.isActive())
+            continue;
+        RaftWebResponder* pResponder = webConn.getResponder();
+        uint32_t usedChannelID = 0;
+        if (!pResponder || !pResponder->getChannelID(usedChannelID) || (usedChannelID != channelID))
             continue;
+        return pResponder->getLinkStats(linkStats);
+    }
+    return false;
+}
 
-        if (_webConnections[i].getHeader().reqConnType == REQ_CONN_TYPE_EVENT)
-            _webConnections[i].sendOnSSEvents(eventContent, eventGroup);
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Get stats as JSON
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+String RaftWebConnManager::getStatsJSON()
+{
+    // Websocket link quality
+    String wsStr;
+    for (RaftWebConnection& webConn : _webConnections)
+    {
+        if (!webConn.isActive())
+            continue;
+        RaftWebResponder* pResponder = webConn.getResponder();
+        uint32_t channelID = 0;
+        RaftWebLinkStats linkStats;
+        if (!pResponder || !pResponder->getChannelID(channelID) || !pResponder->getLinkStats(linkStats))
+            continue;
+        wsStr += String(wsStr.length() == 0 ? "" : ",") + 
+                "{\"ch\":" + String(channelID) + ",\"rtt\":" + linkStats.getJSON() + 
+                ",\"rxThrottle\":" + linkStats.getRxThrottleJSON() + "}";
+    }
+
+    // Frame pool
+    String poolStr = "{\"free\":" + String(RaftWebFramePool::getNumFree()) +
+                ",\"total\":" + String(RaftWebFramePool::getNumBlocks()) +
+                ",\"allocFail\":" + String(RaftWebFramePool::getAllocFailCount()) +
+                ",\"heapAlloc\":" + String(RaftWebFramePool::getHeapAllocCount()) + "}";
+
+    // Pub/sub topics
+    String topicsStr;
+    for (RaftWebHandler* pHandler : _webHandlers)
+    {
+        if (!pHandler->isWebSocketHandler())
+            continue;
+        RaftWebHandlerWS* pHandlerWS = static_cast<RaftWebHandlerWS*>(pHandler);
+        if (!pHandlerWS->getPubSub().isEnabled())
+            continue;
+        topicsStr += String(topicsStr.length() == 0 ? "" : ",") + pHandlerWS->getPubSub().getStatsJSON();
+    }
+
+    // Server-side event rings
+    String sseStr;
+    for (RaftWebHandler* pHandler : _webHandlers)
+    {
+        if (pHandler->isSSEventsHandler())
+            sseStr += String(sseStr.length() == 0 ? "" : ",") + 
+                    static_cast<RaftWebHandlerSSEvents*>(pHandler)->getStatsJSON();
+    }
+
+    return "\"ws\":[" + wsStr + "],\"framePool\":" + poolStr + ",\"topics\":[" + topicsStr + "]" +
+                ",\"upload\":" + RaftWebUploadPipeline::getStatsJSON() +
+                ",\"restWorkers\":" + RaftWebWorkerPool::getStatsJSON() +
+                ",\"respCache\":" + RaftWebRespCache::getStatsJSON() +
+                ",\"coalesce\":" + RaftWebSingleFlight::getStatsJSON() +
+                ",\"sse\":[" + sseStr + "]" +
+                ",\"admission\":" + _connClientListener.getAdmission().getStatsJSON() +
+                ",\"overload\":{\"rej503\":" + String(_overloadRejectCount) + 
+                ",\"rejReserved\":" + String(_reservedRejectCount) + 
+                ",\"draining\":" + String(_rejectedConns.size()) + 
+                ",\"evicted\":" + String(_evictCount) +
+                ",\"noEvictable\":" + String(_evictNoneCount) + "}" +
+                ",\"slotPools\":" + _slotPools.getStatsJSON() +
+                ",\"txSched\":{\"quantum\":" + String(_webServerSettings.txQuantumBytes) +
+                ",\"contendedRounds\":" + String(_txContendedRounds) + "}" +
+                ",\"bandwidth\":" + _bandwidthCaps.getStatsJSON() +
+                ",\"timers\":{\"running\":" + String(_timerWheel.getNumRunning()) +
+                ",\"expired\":" + String(_timerWheel.getNumExpired()) + "}";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Publish to topic
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebConnManager::publishToTopic(const char* topic, const uint8_t* pBuf, uint32_t bufLen)
+{
+    uint32_t numSent = 0;
+    std::vector<uint32_t> subChannelIDs;
+    for (RaftWebHandler* pHandler : _webHandlers)
+    {
+        // Only websocket handlers with pub/sub enabled
+        if (!pHandler->isWebSocketHandler())
+            continue;
+        RaftWebHandlerWS* pHandlerWS = static_cast<RaftWebHandlerWS*>(pHandler);
+        if (!pHandlerWS->getPubSub().isEnabled())
+            continue;
+
+        // Get subscribers (also applies the topic rate cap)
+        if (!pHandlerWS->getPubSub().getSubscribersForPublish(topic, subChannelIDs))
+            continue;
+
+        // Encode once into a shared frame
+        bool isBinary = pHandlerWS->isBinary();
+        RaftWebDataFrame frame(UINT32_MAX, nullptr, RaftWebPubSub::getWrappedLen(topic, bufLen, isBinary), millis());
+        if (!frame.isValid())
+        {
+#ifdef WARN_ON_PUBLISH_NO_FRAME
+            LOG_W(MODULE_PREFIX, "publishToTopic %s no frame available len %d", topic, bufLen);
+#endif
+            continue;
+        }
+        RaftWebPubSub::wrapMsg(frame.getPayloadWritable(), topic, pBuf, bufLen, isBinary);
+
+        // Fan out to subscribers
+        for (RaftWebConnection& webConn : _webConnections)
+        {
+            if (!webConn.isActive())
+                continue;
+            RaftWebResponder* pResponder = webConn.getResponder();
+            uint32_t channelID = 0;
+            if (!pResponder || !pResponder->getChannelID(channelID))
+                continue;
+            for (uint32_t subChannelID : subChannelIDs)
+            {
+                if (subChannelID != channelID)
+                    continue;
+                if (pResponder->encodeAndSendFrame(frame))
+                    numSent++;
+                break;
+            }
+        }
+#ifdef DEBUG_WEB_CONN_PUBLISH
+        LOG_I(MODULE_PREFIX, "publishToTopic %s len %d subscribers %d sent %d",
+                    topic, bufLen, (int)subChannelIDs.size(), numSent);
+#endif
     }
+    return numSent;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
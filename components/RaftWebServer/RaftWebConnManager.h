@@ -13,7 +13,11 @@
 #include "CommsChannelMsg.h"
 #include "RaftWebConnection.h"
 #include "RaftWebSocketDefs.h"
+#include "RaftWebLinkStats.h"
 #include "RaftClientListener.h"
+#include "RaftWebSlotPools.h"
+#include "RaftWebBandwidth.h"
+#include "RaftWebTimerWheel.h"
 #include "ExecTimer.h"
 #include "RaftThreading.h"
 #include "ThreadSafeQueue.h"
@@ -53,8 +57,10 @@ public:
     // Get new responder
     // NOTE: this returns a new object or NULL
     // NOTE: if a new object is returned the caller is responsible for deleting it when appropriate
+    // NOTE: if ppHandler is not null it is set to the handler which created the responder
     RaftWebResponder* getNewResponder(const RaftWebRequestHeader& header, 
-                const RaftWebRequestParams& params, RaftHttpStatusCode& statusCode);
+                const RaftWebRequestParams& params, RaftHttpStatusCode& statusCode,
+                RaftWebHandler** ppHandler = nullptr);
 
     // Get server settings
     const RaftWebServerSettings& getServerSettings() const
@@ -71,12 +77,37 @@ public:
     // Send to all server-side events
     void serverSideEventsSendMsg(const char* eventContent, const char* eventGroup);
 
+    // Get link quality stats for a channel (returns false if channel not found or not supported)
+    bool getChannelLinkStats(uint32_t channelID, RaftWebLinkStats& linkStats);
+
+    // Get stats as JSON (without enclosing braces)
+    String getStatsJSON();
+
+    // Publish to a topic - the message is encoded once and sent to all websocket subscribers
+    // Returns number of subscribers the message was sent to
+    uint32_t publishToTopic(const char* topic, const uint8_t* pBuf, uint32_t bufLen);
+
     // Get web server settings
     const RaftWebServerSettings& getWebServerSettings() const
     {
         return _webServerSettings;
     }
 
+    // Check if a request can use a reserved slot (websocket upgrade or allow-listed path)
+    bool isReservedSlotAllowed(const RaftWebRequestHeader& header);
+
+    // Slot pools for each class of service
+    RaftWebSlotPools& getSlotPools()
+    {
+        return _slotPools;
+    }
+
+    // Bandwidth caps for responses
+    RaftWebBandwidthCaps& getBandwidthCaps()
+    {
+        return _bandwidthCaps;
+    }
+
 private:
     // New connection queue
     ThreadSafeQueue<RaftClientConnBase*> _newConnQueue;
@@ -94,10 +125,60 @@ private:
     // Client Connection Listener
     RaftClientListener _connClientListener;
 
+    // Overload response (precomputed) and paths which can use reserved slots
+    String _overloadResp;
+    std::vector<String> _reservedSlotPaths;
+    static const uint32_t OVERLOAD_RESP_MAX_SEND_MS = 5;
+    uint32_t _overloadRejectCount = 0;
+
+    // Rejected connections are half-closed after the overload response and the request is read (and
+    // discarded) until the client closes or a limit is reached so the close doesn't reset the connection
+    // before the client has read the response
+    class RejectedConn
+    {
+    public:
+        RaftClientConnBase* pClientConn = nullptr;
+        uint32_t startMs = 0;
+        uint32_t bytesDrained = 0;
+    };
+    std::list<RejectedConn> _rejectedConns;
+    std::vector<uint8_t, SpiramAwareAllocator<uint8_t>> _rejectedRxBuf;
+    static const uint32_t REJECTED_CONN_MAX = 4;
+    static const uint32_t REJECTED_CONN_DRAIN_MAX_MS = 500;
+    static const uint32_t REJECTED_CONN_DRAIN_MAX_BYTES = 8192;
+    uint32_t _reservedRejectCount = 0;
+
+    // Eviction of idle connections when all slots are in use
+    uint32_t _evictCount = 0;
+    uint32_t _evictNoneCount = 0;
+
+    // Slot pools for each class of service
+    RaftWebSlotPools _slotPools;
+
+    // Transmit scheduling
+    uint32_t _txContendedRounds = 0;
+
+    // Bandwidth caps
+    RaftWebBandwidthCaps _bandwidthCaps;
+
+    // Connection timers
+    RaftWebTimerWheel _timerWheel;
+
+    // A gap between service-loop iterations longer than this means the whole system
+    // was blocked (e.g. a flash erase during OTA disables the cache and starves all
+    // tasks). When this happens the inactivity (idle) timeout must not be applied as
+    // the stall is the server's fault, not an idle client.
+    static const uint32_t CONN_SERVICE_STALL_THRESHOLD_MS = 1000;
+    uint32_t _lastServiceMs = 0;
+
     // Thread handles
     RaftThreadHandle _socketListenerTaskHandle = RAFT_THREAD_HANDLE_INVALID;
 #ifdef USE_THREAD_FOR_CLIENT_CONN_SERVICING
     RaftThreadHandle _clientConnHandlerTaskHandle = RAFT_THREAD_HANDLE_INVALID;
+
+    // When no request is in progress the service task sleeps until the next connection timer is due
+    // but no longer than this (connections are polled for new data and new connections are queued)
+    static const uint32_t CLIENT_CONN_SERVICE_POLL_MS = 5;
 #endif
 
     // Client connection handler task
@@ -106,8 +187,13 @@ private:
     // Helpers
     static void socketListenerTask(void* pvParameters);
     bool accommodateConnection(RaftClientConnBase* pClientConn);
-    bool findEmptySlot(uint32_t& slotIx);
+    bool findEmptySlot(uint32_t& slotIx, uint32_t& numFreeSlots);
+    void rejectConnection(RaftClientConnBase* pClientConn);
+    void serviceRejectedConns();
+    bool evictIdleConnection(uint32_t& slotIdx);
     void serviceConnections();
+    void serviceConnectionsScheduled();
+    uint32_t getServiceSleepMs();
     bool allocateWebSocketChannelID(uint32_t& channelID);
     // Handle an incoming connection
     bool handleNewConnection(RaftClientConnBase* pClientConn);
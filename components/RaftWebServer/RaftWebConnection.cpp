@@ -54,7 +54,6 @@ static const char *MODULE_PREFIX = "RaftWebConn";
 // #define DEBUG_RESPONDER_CONTENT_DETAIL
 // #define DEBUG_RESPONDER_CREATE_DELETE
 // #define DEBUG_WEB_SOCKET_SEND
-// #define DEBUG_WEB_SSEVENT_SEND
 // #define DEBUG_WEB_CONNECTION_DATA_PACKETS
 // #define DEBUG_WEB_CONNECTION_DATA_PACKETS_CONTENTS
 // #define DEBUG_WEB_CONN_OPEN_CLOSE
@@ -123,7 +122,7 @@ RaftWebConnection::~RaftWebConnection()
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 bool RaftWebConnection::setNewConn(RaftClientConnBase* pClientConn, RaftWebConnManager* pConnManager,
-                uint32_t maxSendBufferBytes, uint32_t clearPendingDurationMs)
+                uint32_t maxSendBufferBytes, uint32_t clearPendingDurationMs, bool isReservedSlot)
 {
     // Error check - there should not be a current client otherwise there's been a mistake!
     if (_pClientConn != nullptr)
@@ -140,21 +139,27 @@ bool RaftWebConnection::setNewConn(RaftClientConnBase* pClientConn, RaftWebConnM
     _pClientConn = pClientConn;
     _pConnManager = pConnManager;
     _timeoutStartMs = millis();
-    _timeoutLastActivityMs = millis();
-    _lastLoopServiceMs = millis();
+    _timeoutLastActivityMs = _timeoutStartMs;
     _timeoutActive = true;
     _timeoutDurationMs = MAX_STD_CONN_DURATION_MS;
     _timeoutOnIdleDurationMs = MAX_CONN_IDLE_DURATION_MS;
     _maxSendBufferBytes = maxSendBufferBytes;
     _clearPendingDurationMs = clearPendingDurationMs;
+    _isReservedSlot = isReservedSlot;
+
+    // Start timers
+    startTimer(CONN_TIMER_DURATION, _timeoutStartMs, _timeoutDurationMs);
+    startTimer(CONN_TIMER_IDLE, _timeoutStartMs, _timeoutOnIdleDurationMs);
+    if (_pConnManager->getServerSettings().headerTimeoutMs > 0)
+        startTimer(CONN_TIMER_HEADER, _timeoutStartMs, _pConnManager->getServerSettings().headerTimeoutMs);
 
     // Set non-blocking connection
     _pClientConn->setup(USE_BLOCKING_WEB_CONNECTIONS);
 
     // Debug
 #ifdef DEBUG_WEB_CONN_OPEN_CLOSE
-    LOG_I(MODULE_PREFIX, "setNewConn connId %d maxSendBytes %d clearPendingMs %d", 
-            _pClientConn->getClientId(), maxSendBufferBytes, clearPendingDurationMs);
+    LOG_I(MODULE_PREFIX, "setNewConn connId %d maxSendBytes %d clearPendingMs %d reserved %d", 
+            _pClientConn->getClientId(), maxSendBufferBytes, clearPendingDurationMs, isReservedSlot);
 #endif
 
     // Connection set
@@ -191,14 +196,28 @@ void RaftWebConnection::clear()
     _pClientConn = nullptr;
     HEAP_CHECK("clear post-del-client");
 
+    // Release slot in class of service
+    if ((_connClass != WEB_CONN_CLASS_NONE) && _pConnManager)
+        _pConnManager->getSlotPools().release(_connClass);
+    _connClass = WEB_CONN_CLASS_NONE;
+
+    // Stop timers
+    for (uint32_t i = 0; i < CONN_TIMER_MAX; i++)
+        cancelTimer((ConnTimer)i);
+
     // Clear all fields
     _pConnManager = nullptr;
     _isStdHeaderRequired = true;
     _sendSpecificHeaders = true;
     _httpResponseStatus = HTTP_STATUS_OK;
+    _isReservedSlot = false;
+    _isTxLimited = false;
+    _txDeficitBytes = 0;
+    _txQuantumBytes = 0;
+    _numBwSharedBuckets = 0;
+    _bwConnBucket.setup(0, 0);
     _timeoutStartMs = 0;
     _timeoutLastActivityMs = 0;
-    _lastLoopServiceMs = 0;
     _timeoutDurationMs = MAX_STD_CONN_DURATION_MS;
     _timeoutOnIdleDurationMs = MAX_CONN_IDLE_DURATION_MS;
     _timeoutActive = false;
@@ -229,6 +248,7 @@ void RaftWebConnection::clearAfterSendCompletion()
         // Set clear pending
         _isClearPending = true;
         _clearPendingStartMs = millis();
+        startTimer(CONN_TIMER_CLEAR_PENDING, _clearPendingStartMs, _clearPendingDurationMs);
     }
     else
     {
@@ -247,23 +267,199 @@ bool RaftWebConnection::isActive()
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Send server-side-event
+// Timers
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void RaftWebConnection::sendOnSSEvents(const char* eventContent, const char* eventGroup)
+void RaftWebConnection::setTimerWheel(RaftWebTimerWheel* pTimerWheel, uint32_t connIdx)
+{
+    _pTimerWheel = pTimerWheel;
+    _timerBaseIdx = connIdx * CONN_TIMER_MAX;
+}
+
+void RaftWebConnection::startTimer(ConnTimer connTimer, uint32_t nowMs, uint32_t durationMs)
 {
-#ifdef DEBUG_WEB_SSEVENT_SEND
-    LOG_I(MODULE_PREFIX, "sendOnSSEvents eventGroup %s eventContent %s responder %d connId %d", 
-                eventGroup, eventContent,
-                (uint32_t)_pResponder, 
-                _pClientConn ? _pClientConn->getClientId() : 0);
+    if (_pTimerWheel)
+        _pTimerWheel->start(_timerBaseIdx + connTimer, nowMs, durationMs);
+}
+
+void RaftWebConnection::cancelTimer(ConnTimer connTimer)
+{
+    if (_pTimerWheel)
+        _pTimerWheel->cancel(_timerBaseIdx + connTimer);
+}
+
+void RaftWebConnection::startRespTimer(RaftWebConnRespTimer respTimer, uint32_t durationMs)
+{
+    ConnTimer connTimer = respTimer == WEB_CONN_RESP_TIMER_PING ? CONN_TIMER_RESP_PING : CONN_TIMER_RESP_NO_PONG;
+    if (durationMs == 0)
+        cancelTimer(connTimer);
+    else
+        startTimer(connTimer, millis(), durationMs);
+}
+
+void RaftWebConnection::onTimer(ConnTimer connTimer, uint32_t nowMs)
+{
+    if (!_pClientConn)
+        return;
+    switch (connTimer)
+    {
+        case CONN_TIMER_RESP_PING:
+        case CONN_TIMER_RESP_NO_PONG:
+        {
+            // Responder timers are handled by the responder
+            if (_pResponder)
+                _pResponder->onTimer(connTimer == CONN_TIMER_RESP_PING ? WEB_CONN_RESP_TIMER_PING : WEB_CONN_RESP_TIMER_NO_PONG, nowMs);
+            return;
+        }
+        case CONN_TIMER_CLEAR_PENDING:
+        {
+            if (!_isClearPending)
+                return;
+#ifdef DEBUG_WEB_CONN_SERVICE_TIME_THRESH_MS
+            LOG_I(MODULE_PREFIX, "onTimer conn %d clearing - clear was pending", _pClientConn->getClientId());
 #endif
+            break;
+        }
+        case CONN_TIMER_IDLE:
+        {
+            // The idle timer isn't restarted on each activity so restart it for the remaining time
+            // if there has been activity (signed as activity can be recorded on another task after nowMs)
+            if (!_timeoutActive)
+                return;
+            int32_t idleMs = (int32_t)(nowMs - _timeoutLastActivityMs);
+            if (idleMs < (int32_t)_timeoutOnIdleDurationMs)
+            {
+                startTimer(CONN_TIMER_IDLE, nowMs, _timeoutOnIdleDurationMs - (idleMs > 0 ? idleMs : 0));
+                return;
+            }
+            LOG_W(MODULE_PREFIX, "onTimer idle timeout connId %d sinceStartMs %d sinceLastActivityMs %d", 
+                    _pClientConn->getClientId(), 
+                    (int)Raft::timeElapsed(nowMs, _timeoutStartMs), idleMs);
+            break;
+        }
+        case CONN_TIMER_DURATION:
+        {
+            if (!_timeoutActive)
+                return;
+            LOG_W(MODULE_PREFIX, "onTimer duration timeout connId %d sinceStartMs %d", 
+                    _pClientConn->getClientId(), (int)Raft::timeElapsed(nowMs, _timeoutStartMs));
+            break;
+        }
+        case CONN_TIMER_HEADER:
+        {
+            if (_header.isComplete)
+                return;
+            LOG_W(MODULE_PREFIX, "onTimer header timeout connId %d sinceStartMs %d", 
+                    _pClientConn->getClientId(), (int)Raft::timeElapsed(nowMs, _timeoutStartMs));
+            break;
+        }
+        default:
+            return;
+    }
+    clear();
+}
 
-    // Send to responder
-    if (_pResponder)
+void RaftWebConnection::forgiveStall(uint32_t nowMs)
+{
+    // Peg the inactivity marker to "now". A simple `+=` is wrong because _timeoutLastActivityMs
+    // can already have been updated mid-stall by network/responder code running on another
+    // (non-cached) task, which would push the marker into the future relative to nowMs
+    if (_pClientConn)
+        _timeoutLastActivityMs = nowMs;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Transmit scheduling
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebConnection::isTxPending()
+{
+    return _pClientConn && _pResponder && !_isClearPending && _pResponder->responseAvailable();
+}
+
+bool RaftWebConnection::isBusy()
+{
+    return _pClientConn && (_pResponder || (_socketTxQueuedBuffer.size() > 0));
+}
+
+void RaftWebConnection::addTxQuantum(uint32_t quantumBytes)
+{
+    _isTxLimited = quantumBytes > 0;
+    _txQuantumBytes = quantumBytes;
+    if (!_isTxLimited)
+    {
+        _txDeficitBytes = 0;
+        return;
+    }
+
+    // Deficit carries over (so a full send buffer chunk can be built up) but doesn't accumulate further
+    uint32_t maxDeficitBytes = quantumBytes > _maxSendBufferBytes ? quantumBytes : _maxSendBufferBytes;
+    _txDeficitBytes += quantumBytes;
+    if (_txDeficitBytes > maxDeficitBytes)
+        _txDeficitBytes = maxDeficitBytes;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Bandwidth caps
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebConnection::getBandwidthAvailable(uint32_t& minBurstBytes)
+{
+    uint32_t availBytes = UINT32_MAX;
+    minBurstBytes = UINT32_MAX;
+    for (uint32_t i = 0; i < _numBwSharedBuckets; i++)
+    {
+        uint32_t bucketBytes = _pBwSharedBuckets[i]->getAvailable();
+        if (bucketBytes < availBytes)
+            availBytes = bucketBytes;
+        if (_pBwSharedBuckets[i]->getBurstBytes() < minBurstBytes)
+            minBurstBytes = _pBwSharedBuckets[i]->getBurstBytes();
+    }
+    if (_bwConnBucket.isEnabled())
+    {
+        uint32_t bucketBytes = _bwConnBucket.getAvailable();
+        if (bucketBytes < availBytes)
+            availBytes = bucketBytes;
+        if (_bwConnBucket.getBurstBytes() < minBurstBytes)
+            minBurstBytes = _bwConnBucket.getBurstBytes();
+    }
+    return availBytes;
+}
+
+void RaftWebConnection::consumeBandwidth(uint32_t numBytes)
+{
+    for (uint32_t i = 0; i < _numBwSharedBuckets; i++)
+        _pBwSharedBuckets[i]->consume(numBytes);
+    _bwConnBucket.consume(numBytes);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Check if evictable
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebConnection::isEvictable(uint32_t minIdleMs, uint32_t& idleMs)
+{
+    if (!_pClientConn)
+        return false;
+
+    // Data still queued for sending (including the tail of a response which is waiting for clear)
+    if (_socketTxQueuedBuffer.size() > 0)
+        return false;
+
+    // Response completed and sent - waiting for clear
+    if (_isClearPending)
     {
-        _pResponder->sendEvent(eventContent, eventGroup);
+        idleMs = Raft::timeElapsed(millis(), _clearPendingStartMs);
+        return idleMs >= minIdleMs;
     }
+
+    // Active transfers (and websocket/event sessions) have a responder
+    if (_pResponder)
+        return false;
+
+    // Waiting for (the rest of) a request header
+    idleMs = Raft::timeElapsed(millis(), _timeoutLastActivityMs);
+    return idleMs >= minIdleMs;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -276,29 +472,6 @@ void RaftWebConnection::loop()
     if (!_pClientConn)
         return;
 
-    // Detect a service-loop stall: if a long time has elapsed since this connection was
-    // last serviced then the whole system was blocked (e.g. a flash erase during OTA or
-    // a file upload disables the flash cache and starves all tasks). Advance the
-    // inactivity marker by the stalled duration so the idle (inactivity) timeout below
-    // is not tripped by a stall that is the server's fault rather than an idle client.
-    uint32_t nowMs = millis();
-    if (_lastLoopServiceMs != 0)
-    {
-        uint32_t sinceLastServiceMs = Raft::timeElapsed(nowMs, _lastLoopServiceMs);
-        if (sinceLastServiceMs > CONN_SERVICE_STALL_THRESHOLD_MS)
-        {
-            // Peg the inactivity marker to "now". A simple `+=` is wrong because
-            // _timeoutLastActivityMs can already have been updated mid-stall by
-            // network/responder code running on another (non-cached) task, which
-            // would push the marker into the future relative to nowMs and trip the
-            // idle timeout via unsigned wraparound in isTimeout().
-            _timeoutLastActivityMs = nowMs;
-            LOG_W(MODULE_PREFIX, "loop service stall %dms - forgiving idle timeout connId %d",
-                    (int)sinceLastServiceMs, _pClientConn->getClientId());
-        }
-    }
-    _lastLoopServiceMs = nowMs;
-
 #ifdef DEBUG_WEB_CONN_SERVICE_TIME_THRESH_MS
     uint64_t debugServiceStartUs = micros();
     uint64_t debugHandleTxStartUs = micros();
@@ -312,31 +485,9 @@ void RaftWebConnection::loop()
     uint64_t debugClearStartUs = micros();
 #endif
 
-    // Check clear
+    // Nothing more to do while clear is pending (the clear pending timer clears the connection)
     if (_isClearPending)
-    {
-        // Check for timeout
-        if (Raft::isTimeout(millis(), _clearPendingStartMs, _clearPendingDurationMs))
-        {
-#ifdef DEBUG_WEB_CONN_SERVICE_TIME_THRESH_MS
-            LOG_I(MODULE_PREFIX, "loop conn %d clearing - clear was pending", _pClientConn->getClientId());
-#endif
-            clear();
-        }
-        return;
-    }
-
-    // Check timeout
-    if (_timeoutActive && (Raft::isTimeout(millis(), _timeoutStartMs, _timeoutDurationMs) ||
-                    Raft::isTimeout(millis(), _timeoutLastActivityMs, _timeoutOnIdleDurationMs)))
-    {
-        LOG_W(MODULE_PREFIX, "loop timeout on connection connId %d sinceStartMs %d sinceLastActivityMs %d", 
-                _pClientConn->getClientId(), 
-                (int)Raft::timeElapsed(millis(), _timeoutStartMs),
-                (int)Raft::timeElapsed(millis(), _timeoutLastActivityMs));
-        clear();
         return;
-    }
 
 #ifdef DEBUG_WEB_CONN_SERVICE_TIME_THRESH_MS
     uint32_t debugClearUs = micros() - debugClearStartUs;
@@ -607,6 +758,7 @@ bool RaftWebConnection::serviceConnHeader(const uint8_t* pRxData, uint32_t dataL
 #endif
         return true;
     }
+    cancelTimer(CONN_TIMER_HEADER);
 
     // Debug
 #ifdef DEBUG_WEB_REQUEST_HEADERS
@@ -628,6 +780,13 @@ bool RaftWebConnection::serviceConnHeader(const uint8_t* pRxData, uint32_t dataL
         return true;
     }
 
+    // Requests on reserved slots which aren't allowed to use them are rejected
+    if (_isReservedSlot && !_pConnManager->isReservedSlotAllowed(_header))
+    {
+        setHTTPResponseStatus(HTTP_STATUS_SERVICEUNAVAILABLE);
+        return true;
+    }
+
     // Now find a responder
     RaftHttpStatusCode statusCode = HTTP_STATUS_NOTFOUND;
     // Delete any existing responder - there shouldn't be one
@@ -648,8 +807,10 @@ bool RaftWebConnection::serviceConnHeader(const uint8_t* pRxData, uint32_t dataL
     RaftWebRequestParams params(
                 std::bind(&RaftWebConnection::canSendOnConn, this),
                 std::bind(&RaftWebConnection::rawSendOnConn, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
-                _pClientConn->getClientId());
-    _pResponder = _pConnManager->getNewResponder(_header, params, statusCode);
+                _pClientConn->getClientId(),
+                std::bind(&RaftWebConnection::startRespTimer, this, std::placeholders::_1, std::placeholders::_2));
+    RaftWebHandler* pHandler = nullptr;
+    _pResponder = _pConnManager->getNewResponder(_header, params, statusCode, &pHandler);
 #ifdef DEBUG_RESPONDER_CREATE_DELETE
     if (_pResponder) 
     {
@@ -669,6 +830,28 @@ bool RaftWebConnection::serviceConnHeader(const uint8_t* pRxData, uint32_t dataL
     }
 #endif
 
+    // Take a slot in the request's class of service (rejected if the class and shared slots are all used)
+    if (_pResponder)
+    {
+        RaftWebConnClass connClass = RaftWebSlotPools::getConnClass(_header, _pResponder);
+        if (_pConnManager->getSlotPools().acquire(connClass))
+        {
+            _connClass = connClass;
+
+            // Bandwidth caps applying to the response
+            if (_pConnManager->getBandwidthCaps().isEnabled())
+                _numBwSharedBuckets = _pConnManager->getBandwidthCaps().getCaps(
+                            pHandler ? pHandler->getName() : "", _pResponder->getResponderType(), 
+                            _pBwSharedBuckets, _bwConnBucket);
+        }
+        else
+        {
+            delete _pResponder;
+            _pResponder = nullptr;
+            statusCode = HTTP_STATUS_SERVICEUNAVAILABLE;
+        }
+    }
+
 #ifdef DEBUG_WEB_REQUEST_HEADERS
     uint64_t gpEnUs = micros();
     uint64_t ssStUs = micros();
@@ -683,7 +866,11 @@ bool RaftWebConnection::serviceConnHeader(const uint8_t* pRxData, uint32_t dataL
     {
         // Remove timeouts on long-running responders
         if (_pResponder->leaveConnOpen())
+        {
             _timeoutActive = false;
+            cancelTimer(CONN_TIMER_DURATION);
+            cancelTimer(CONN_TIMER_IDLE);
+        }
 
         // Start responder
         _pResponder->startResponding(*this);
@@ -1044,6 +1231,80 @@ void RaftWebConnection::parseNameValueLine(const String& reqLine)
             _header.reqConnType = REQ_CONN_TYPE_EVENT;
         }
     }
+    else if (name.equalsIgnoreCase("Content-Disposition"))
+    {
+        std::vector<RaftJson::NameValuePair> contentDispNameVals;
+        RaftJson::extractNameValues(val, "=", ";", NULL, contentDispNameVals);
+        for (RaftJson::NameValuePair &nvp : contentDispNameVals)
+        {
+            if (nvp.name.equalsIgnoreCase("filename"))
+            {
+                _header.extract.fileName = nvp.value;
+                _header.extract.fileName.replace("\"", "");
+            }
+        }
+    }
+    else if (name.equalsIgnoreCase("Content-Encoding"))
+    {
+        _header.extract.contentEncoding = val;
+        _header.extract.contentEncoding.trim();
+    }
+    else if (name.equalsIgnoreCase("Accept-Encoding"))
+    {
+        // Comma separated codings each with optional quality (q=0 means not acceptable)
+        int codingStart = 0;
+        while (codingStart < (int)val.length())
+        {
+            int codingEnd = val.indexOf(',', codingStart);
+            if (codingEnd < 0)
+                codingEnd = val.length();
+            String coding = val.substring(codingStart, codingEnd);
+            codingStart = codingEnd + 1;
+            bool isAcceptable = true;
+            int qualPos = coding.indexOf(";");
+            if (qualPos >= 0)
+            {
+                String qualStr = coding.substring(qualPos + 1);
+                qualStr.trim();
+                if (qualStr.startsWith("q="))
+                    isAcceptable = strtod(qualStr.c_str() + 2, NULL) > 0;
+                coding = coding.substring(0, qualPos);
+            }
+            coding.trim();
+            if (coding.equalsIgnoreCase("gzip"))
+                _header.extract.acceptsGzip = isAcceptable;
+            else if (coding.equalsIgnoreCase("deflate"))
+                _header.extract.acceptsDeflate = isAcceptable;
+        }
+    }
+    else if (name.equalsIgnoreCase("Last-Event-ID"))
+    {
+        _header.extract.lastEventId = strtoul(val.c_str(), NULL, 10);
+        _header.extract.lastEventIdValid = true;
+    }
+    else if (name.equalsIgnoreCase("If-None-Match"))
+    {
+        _header.extract.ifNoneMatch = val;
+    }
+    else if (name.equalsIgnoreCase("X-Uncompressed-Length"))
+    {
+        _header.extract.decodedLength = strtoul(val.c_str(), NULL, 0);
+        _header.extract.decodedLengthValid = true;
+    }
+    else if (name.equalsIgnoreCase("Content-MD5"))
+    {
+        _header.extract.contentMD5 = val;
+    }
+    else if (name.equalsIgnoreCase("CRC16"))
+    {
+        _header.extract.crc16 = strtoul(val.c_str(), NULL, 0);
+        _header.extract.crc16Valid = true;
+    }
+    else if (name.equalsIgnoreCase("FileLengthBytes"))
+    {
+        _header.extract.fileLenBytes = strtoul(val.c_str(), NULL, 0);
+        _header.extract.fileLenValid = true;
+    }
     else if (name.equalsIgnoreCase("Sec-WebSocket-Key"))
     {
         _header.webSocketKey = val;
@@ -1358,8 +1619,15 @@ RaftWebConnSendRetVal RaftWebConnection::rawSendOnConn(const uint8_t* pBuf, uint
 
 bool RaftWebConnection::getStandardHeaders(String& headerStr)
 {
+    // Get content length first as responders may add headers or change the status when working it out
+    // (e.g. Content-Encoding for compressed responses, 304 for cached responses the client already has)
+    int contentLength = _pResponder ? _pResponder->getContentLength() : -1;
+
     // Form the header
-    headerStr = "HTTP/1.1 " + String(_httpResponseStatus) + " " + RaftWebInterface::getHTTPStatusStr(_httpResponseStatus) + "\r\n";
+    RaftHttpStatusCode respStatus = _httpResponseStatus;
+    if (_pResponder)
+        _pResponder->getResponseStatus(respStatus);
+    headerStr = "HTTP/1.1 " + String(respStatus) + " " + RaftWebInterface::getHTTPStatusStr(respStatus) + "\r\n";
 
     // Add headers related to pre-flight checks
     if (_header.extract.method == WEB_METHOD_OPTIONS)
@@ -1369,6 +1637,13 @@ bool RaftWebConnection::getStandardHeaders(String& headerStr)
         headerStr += preFlightRespHeaders;
     }
 
+    // Tell clients rejected due to overload when to retry
+    if (!_pResponder && (respStatus == HTTP_STATUS_SERVICEUNAVAILABLE) && _pConnManager &&
+                (_pConnManager->getServerSettings().overloadRetryAfterSecs > 0))
+    {
+        headerStr += "Retry-After: " + String(_pConnManager->getServerSettings().overloadRetryAfterSecs) + "\r\n";
+    }
+
     // Add content type
     if (_pResponder && _pResponder->getContentType())
     {
@@ -1394,7 +1669,6 @@ bool RaftWebConnection::getStandardHeaders(String& headerStr)
     // Add content length if required
     if (_pResponder)
     {
-        int contentLength = _pResponder->getContentLength();
         if (contentLength >= 0)
         {
             headerStr += "Content-Length: " + String(contentLength) + "\r\n";
@@ -1468,6 +1742,10 @@ bool RaftWebConnection::handleResponseChunk()
         return true;
     }
 
+    // Parked until the responder's response (and so its status) is known
+    if (_isStdHeaderRequired && _pResponder->isStdHeaderRequired() && !_pResponder->isHeaderReady())
+        return true;
+
 #ifdef DEBUG_WEB_RESPONDER_HDL_CHUNK_THRESH_MS
     uint64_t debugHdlRespChunkStartUs = micros();
     uint64_t debugCanSendOnConnStartUs = micros();
@@ -1517,12 +1795,44 @@ bool RaftWebConnection::handleResponseChunk()
     uint32_t debugRawSendOnConnUs = 0;
 #endif
 
+    // When transmit is limited the chunk is sized to this round's deficit (and waits for a later round if
+    // the deficit is less than a quantum so small chunks aren't sent)
+    uint32_t maxChunkBytes = _maxSendBufferBytes;
+    if (_isTxLimited)
+    {
+        uint32_t minChunkBytes = _txQuantumBytes < _maxSendBufferBytes ? _txQuantumBytes : _maxSendBufferBytes;
+        if (_txDeficitBytes < minChunkBytes)
+            return true;
+        if (_txDeficitBytes < maxChunkBytes)
+            maxChunkBytes = _txDeficitBytes;
+    }
+
     // Check if data waiting to be sent
     if (_socketTxQueuedBuffer.size() == 0)
     {
+        // Bandwidth caps pace the response by holding back the next chunk until a full chunk (or burst)
+        // is allowed (data already taken from the responder and queued isn't held back)
+        bool isBwCapped = (_numBwSharedBuckets > 0) || _bwConnBucket.isEnabled();
+        if (isBwCapped)
+        {
+            uint32_t minBurstBytes = 0;
+            uint32_t availBytes = getBandwidthAvailable(minBurstBytes);
+            if (availBytes < (minBurstBytes < maxChunkBytes ? minBurstBytes : maxChunkBytes))
+            {
+                _pConnManager->getBandwidthCaps().recordPaced();
+                return true;
+            }
+            if (availBytes < maxChunkBytes)
+                maxChunkBytes = availBytes;
+        }
+
         // Get next chunk of response
         uint8_t* pRespBuffer = nullptr;
-        uint32_t respSize = _pResponder->getResponseNext(pRespBuffer, _maxSendBufferBytes);
+        uint32_t respSize = _pResponder->getResponseNext(pRespBuffer, maxChunkBytes);
+        if (_isTxLimited)
+            _txDeficitBytes = respSize < _txDeficitBytes ? _txDeficitBytes - respSize : 0;
+        if (isBwCapped)
+            consumeBandwidth(respSize);
 
 #ifdef DEBUG_WEB_RESPONDER_HDL_CHUNK_THRESH_MS
         debugGetRespNextUs = micros() - debugGetRespNextStartUs;
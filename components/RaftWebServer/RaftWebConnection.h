@@ -13,6 +13,8 @@
 #include "RaftWebRequestParams.h"
 #include "RaftWebRequestHeader.h"
 #include "RaftClientConnBase.h"
+#include "RaftWebBandwidth.h"
+#include "RaftWebTimerWheel.h"
 
 // #define DEBUG_TRACE_HEAP_USAGE_WEB_CONN
 
@@ -32,19 +34,55 @@ public:
     // Check if we can send
     RaftWebConnSendRetVal canSendOnConn();
 
-    // Send on server-side events
-    void sendOnSSEvents(const char* eventContent, const char* eventGroup);
-
     // Clear (closes connection if open)
     void clear();
 
     // Set a new connection
+    // If isReservedSlot then only requests allowed to use reserved slots are handled (others get a 503)
     bool setNewConn(RaftClientConnBase* pClientConn, RaftWebConnManager* pConnManager,
-                uint32_t maxSendBufferBytes, uint32_t clearPendingDurationMs);
+                uint32_t maxSendBufferBytes, uint32_t clearPendingDurationMs, bool isReservedSlot);
 
     // True if active
     bool isActive();
 
+    // Class of service (WEB_CONN_CLASS_NONE until the request has been routed)
+    RaftWebConnClass getConnClass() const
+    {
+        return _connClass;
+    }
+
+    // Check if the responder has response data waiting to be sent
+    bool isTxPending();
+
+    // Check if a request is in progress (or data is queued for sending)
+    bool isBusy();
+
+    // Add transmit quantum for this service round (0 if transmit is not limited this round)
+    void addTxQuantum(uint32_t quantumBytes);
+
+    // Connection timers - deadlines are held on the connection manager's timer wheel and the
+    // connection is only called when one expires
+    enum ConnTimer
+    {
+        CONN_TIMER_DURATION,
+        CONN_TIMER_IDLE,
+        CONN_TIMER_CLEAR_PENDING,
+        CONN_TIMER_HEADER,
+        CONN_TIMER_RESP_PING,
+        CONN_TIMER_RESP_NO_PONG,
+        CONN_TIMER_MAX
+    };
+    void setTimerWheel(RaftWebTimerWheel* pTimerWheel, uint32_t connIdx);
+    void onTimer(ConnTimer connTimer, uint32_t nowMs);
+
+    // Forgive idle time after the service task has stalled (the stall is the server's fault rather
+    // than an idle client)
+    void forgiveStall(uint32_t nowMs);
+
+    // Check if the connection is idle and can be evicted to make room for a new connection
+    // (an idle HTTP connection which hasn't started a request or has finished its response)
+    bool isEvictable(uint32_t minIdleMs, uint32_t& idleMs);
+
     // Get header
     RaftWebRequestHeader& getHeader()
     {
@@ -81,6 +119,22 @@ private:
     // Response code if no responder available
     RaftHttpStatusCode _httpResponseStatus;
 
+    // Connection is using a reserved slot
+    bool _isReservedSlot = false;
+
+    // Class of service (set when the request has been routed)
+    RaftWebConnClass _connClass = WEB_CONN_CLASS_NONE;
+
+    // Transmit scheduling - bytes this connection can send (when limited) and the quantum it is given each round
+    bool _isTxLimited = false;
+    uint32_t _txDeficitBytes = 0;
+    uint32_t _txQuantumBytes = 0;
+
+    // Bandwidth caps (shared with other connections and for this connection only)
+    RaftWebTokenBucket* _pBwSharedBuckets[RaftWebBandwidthCaps::MAX_CAPS_PER_CONN] = {};
+    uint32_t _numBwSharedBuckets = 0;
+    RaftWebTokenBucket _bwConnBucket;
+
     // Timeout timer
     static const uint32_t MAX_STD_CONN_DURATION_MS = 5 * 60 * 1000;
     // OTA flash erases can disable the cache and stall the web server task for
@@ -88,18 +142,16 @@ private:
     static const uint32_t MAX_CONN_IDLE_DURATION_MS = 30 * 1000;
     static const uint32_t MAX_HEADER_SEND_RETRY_MS = 10;
     static const uint32_t MAX_CONTENT_SEND_RETRY_MS = 0;
-    // A gap between service-loop iterations longer than this means the whole system
-    // was blocked (e.g. a flash erase during OTA disables the cache and starves all
-    // tasks). When this happens the inactivity (idle) timeout must not be applied as
-    // the stall is the server's fault, not an idle client.
-    static const uint32_t CONN_SERVICE_STALL_THRESHOLD_MS = 1000;
     uint32_t _timeoutStartMs;
     uint32_t _timeoutDurationMs;
     uint32_t _timeoutLastActivityMs;
     uint32_t _timeoutOnIdleDurationMs;
-    uint32_t _lastLoopServiceMs = 0;
     bool _timeoutActive;
 
+    // Timer wheel (owned by the connection manager) and index of this connection's first timer
+    RaftWebTimerWheel* _pTimerWheel = nullptr;
+    uint32_t _timerBaseIdx = 0;
+
     // Responder/connection clear pending
     bool _isClearPending;
     uint32_t _clearPendingStartMs;
@@ -156,6 +208,15 @@ private:
     // Handle sending queued data
     bool handleTxQueuedData();
 
+    // Timers
+    void startTimer(ConnTimer connTimer, uint32_t nowMs, uint32_t durationMs);
+    void cancelTimer(ConnTimer connTimer);
+    void startRespTimer(RaftWebConnRespTimer respTimer, uint32_t durationMs);
+
+    // Bandwidth caps - get bytes which can be sent now (and the smallest burst) and consume bytes sent
+    uint32_t getBandwidthAvailable(uint32_t& minBurstBytes);
+    void consumeBandwidth(uint32_t numBytes);
+
     // Clear the responder and connection after send completion
     void clearAfterSendCompletion();
 };
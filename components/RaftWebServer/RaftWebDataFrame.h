@@ -10,10 +10,11 @@
 
 #include <string.h>
 #include <stdint.h>
-#include <vector>
-#include "SpiramAwareAllocator.h"
+#include "RaftWebFramePool.h"
 
-// Buffer for tx queue
+// Frame for tx - the payload is held in a ref-counted pooled block with headroom reserved
+// for a protocol header so copying the frame (e.g. into a queue) doesn't copy the payload
+// and the header can be prepended without copying the payload again
 class RaftWebDataFrame
 {
 public:
@@ -22,29 +23,112 @@ public:
     }
     RaftWebDataFrame(uint32_t channelID, const uint8_t* pBuf, uint32_t bufLen, uint32_t frameTimeMs)
     {
-        frame.resize(bufLen);
-        memcpy(frame.data(), pBuf, frame.size());
         _channelID = channelID;
         _frameTimeMs = frameTimeMs;
+        _pBlock = RaftWebFramePool::alloc(bufLen);
+        if (!_pBlock)
+            return;
+        _payloadLen = bufLen;
+        if (pBuf && bufLen)
+            memcpy(getPayloadWritable(), pBuf, bufLen);
     }
-    const uint8_t* getData()
+    RaftWebDataFrame(const RaftWebDataFrame& other)
     {
-        return frame.data();
+        copyFrom(other);
     }
-    uint32_t getLen()
+    RaftWebDataFrame& operator=(const RaftWebDataFrame& other)
     {
-        return frame.size();
+        if (this != &other)
+        {
+            RaftWebFramePool::release(_pBlock);
+            copyFrom(other);
+        }
+        return *this;
     }
-    uint32_t getChannelID()
+    ~RaftWebDataFrame()
+    {
+        RaftWebFramePool::release(_pBlock);
+    }
+
+    // Valid (false if the pool was exhausted when the frame was created)
+    bool isValid() const
+    {
+        return _pBlock != nullptr;
+    }
+
+    // Payload
+    const uint8_t* getData() const
+    {
+        return _pBlock ? _pBlock->data() + RaftWebFramePool::FRAME_HEADROOM_BYTES : nullptr;
+    }
+    uint32_t getLen() const
+    {
+        return _payloadLen;
+    }
+    uint8_t* getPayloadWritable()
+    {
+        return _pBlock ? _pBlock->data() + RaftWebFramePool::FRAME_HEADROOM_BYTES : nullptr;
+    }
+
+    // Set the header (hdrLen bytes immediately before the payload)
+    // Frames sharing a block share the headroom so the header is written by the first frame to be sent
+    // and is read-only after that - returns false if there isn't room or the block already has a
+    // different header (or another task is writing it) in which case the caller must copy the payload
+    bool prependHeader(const uint8_t* pHdr, uint32_t hdrLen)
+    {
+        if (!_pBlock || (hdrLen > RaftWebFramePool::FRAME_HEADROOM_BYTES))
+            return false;
+        uint8_t* pDest = _pBlock->data() + RaftWebFramePool::FRAME_HEADROOM_BYTES - hdrLen;
+        uint8_t headerState = RaftWebFrameBlock::HEADER_NONE;
+        if (_pBlock->headerState.compare_exchange_strong(headerState, RaftWebFrameBlock::HEADER_WRITING,
+                    std::memory_order_acquire))
+        {
+            memcpy(pDest, pHdr, hdrLen);
+            _pBlock->headerLen = hdrLen;
+            _pBlock->headerState.store(RaftWebFrameBlock::HEADER_WRITTEN, std::memory_order_release);
+        }
+        else if ((headerState != RaftWebFrameBlock::HEADER_WRITTEN) || (_pBlock->headerLen != hdrLen) ||
+                    (memcmp(pDest, pHdr, hdrLen) != 0))
+        {
+            return false;
+        }
+        _headerLen = hdrLen;
+        return true;
+    }
+
+    // Whole frame (header + payload)
+    const uint8_t* getFrameData() const
+    {
+        return _pBlock ? _pBlock->data() + RaftWebFramePool::FRAME_HEADROOM_BYTES - _headerLen : nullptr;
+    }
+    uint32_t getFrameLen() const
+    {
+        return _headerLen + _payloadLen;
+    }
+
+    uint32_t getChannelID() const
     {
         return _channelID;
     }
-    uint32_t getFrameTimeMs()
+    uint32_t getFrameTimeMs() const
     {
         return _frameTimeMs;
     }
+
 private:
-    std::vector<uint8_t, SpiramAwareAllocator<uint8_t>> frame;
+    RaftWebFrameBlock* _pBlock = nullptr;
+    uint32_t _payloadLen = 0;
+    uint32_t _headerLen = 0;
     uint32_t _channelID = UINT32_MAX;
     uint32_t _frameTimeMs = 0;
+
+    void copyFrom(const RaftWebDataFrame& other)
+    {
+        _pBlock = other._pBlock;
+        RaftWebFramePool::addRef(_pBlock);
+        _payloadLen = other._payloadLen;
+        _headerLen = other._headerLen;
+        _channelID = other._channelID;
+        _frameTimeMs = other._frameTimeMs;
+    }
 };
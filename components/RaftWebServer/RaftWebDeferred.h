@@ -0,0 +1,116 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include "RaftArduino.h"
+#include "RaftThreading.h"
+#include "RaftWebInterface.h"
+
+// Completion handle for a deferred REST API response
+// The endpoint keeps the handle (e.g. passing it to the task which does the work) and calls complete()
+// when the response is ready. The connection is parked until then and times out with a 504 if the
+// response takes too long - isAbandoned() can be used to stop work which is no longer needed.
+// Several responders can wait on the same handle (identical requests coalesced into one call) in which
+// case they share the response and the request is only abandoned when all of them have given up.
+class RaftWebDeferredResponse
+{
+public:
+    RaftWebDeferredResponse()
+    {
+        RaftMutex_init(_mutex);
+    }
+    ~RaftWebDeferredResponse()
+    {
+        RaftMutex_destroy(_mutex);
+    }
+
+    // Complete the response (can be called from any task)
+    // Returns false if the request has already been completed or abandoned
+    bool complete(const String& respStr, RaftHttpStatusCode status = HTTP_STATUS_OK)
+    {
+        if (!RaftMutex_lock(_mutex, RAFT_MUTEX_WAIT_FOREVER))
+            return false;
+        bool isPending = _state == STATE_PENDING;
+        if (isPending)
+        {
+            _pResp = std::make_shared<const String>(respStr);
+            _status = status;
+            _state = STATE_COMPLETE;
+        }
+        RaftMutex_unlock(_mutex);
+        return isPending;
+    }
+
+    // Check if the request was abandoned (timed out or connection closed)
+    bool isAbandoned() const
+    {
+        return _state == STATE_ABANDONED;
+    }
+
+    // Check if the request is still pending
+    bool isPending() const
+    {
+        return _state == STATE_PENDING;
+    }
+
+    // Get the (shared) response if complete (used by responders)
+    bool getResult(std::shared_ptr<const String>& pResp, RaftHttpStatusCode& status)
+    {
+        if (_state != STATE_COMPLETE)
+            return false;
+        if (!RaftMutex_lock(_mutex, RAFT_MUTEX_WAIT_FOREVER))
+            return false;
+        pResp = _pResp;
+        status = _status;
+        RaftMutex_unlock(_mutex);
+        return true;
+    }
+
+    // Add a responder waiting for the response - returns false if no longer pending
+    bool addWaiter()
+    {
+        if (!RaftMutex_lock(_mutex, RAFT_MUTEX_WAIT_FOREVER))
+            return false;
+        bool isPending = _state == STATE_PENDING;
+        if (isPending)
+            _numWaiters++;
+        RaftMutex_unlock(_mutex);
+        return isPending;
+    }
+
+    // Abandon the request (used by responders) - returns false if already complete
+    // The request is only abandoned once all waiting responders have given up
+    bool abandon()
+    {
+        if (!RaftMutex_lock(_mutex, RAFT_MUTEX_WAIT_FOREVER))
+            return false;
+        bool isPending = _state == STATE_PENDING;
+        if (isPending && (_numWaiters > 0))
+            _numWaiters--;
+        if (isPending && (_numWaiters == 0))
+            _state = STATE_ABANDONED;
+        RaftMutex_unlock(_mutex);
+        return isPending;
+    }
+
+private:
+    enum DeferredState
+    {
+        STATE_PENDING,
+        STATE_COMPLETE,
+        STATE_ABANDONED
+    };
+    std::atomic<DeferredState> _state{STATE_PENDING};
+    RaftMutex _mutex;
+    uint32_t _numWaiters = 1;
+    std::shared_ptr<const String> _pResp;
+    RaftHttpStatusCode _status = HTTP_STATUS_OK;
+};
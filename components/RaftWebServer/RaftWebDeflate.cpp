@@ -0,0 +1,306 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "RaftWebDeflate.h"
+#include "RaftWebBodyDecoder.h"
+
+// Length codes 257..285 (base length and number of extra bits)
+static const uint16_t DEFLATE_LEN_BASE[] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t DEFLATE_LEN_EXTRA[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+// Distance codes 0..29 (base distance and number of extra bits)
+static const uint16_t DEFLATE_DIST_BASE[] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+    4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t DEFLATE_DIST_EXTRA[] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constructor
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftWebDeflate::RaftWebDeflate()
+{
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Setup
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebDeflate::setup(bool isGzip, uint32_t level)
+{
+    _isGzip = isGzip;
+    _state = STATE_HEADER;
+    _inPos = 0;
+    _bitBuf = 0;
+    _bitCount = 0;
+    _crc32 = 0;
+    _adler32 = 1;
+
+    // Chain length doubles with each level (level 1 only checks the most recent position)
+    if (level < 1)
+        level = 1;
+    if (level > MAX_LEVEL)
+        level = MAX_LEVEL;
+    _maxChain = 1 << (level - 1);
+
+    // Match finder tables (the chain table isn't needed for the fastest level)
+    _hashHead.assign(1 << HASH_BITS, 0);
+    if (_maxChain > 1)
+        _hashPrev.assign(WINDOW_BYTES, 0);
+    return _hashHead.size() > 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Compress
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebDeflate::compress(const uint8_t* pIn, uint32_t inLen, uint8_t* pOut, uint32_t outMax)
+{
+    if ((outMax < MIN_OUT_BYTES) || (_state == STATE_DONE))
+        return 0;
+    uint8_t* pOutStart = pOut;
+    uint8_t* pOutEnd = pOut + outMax;
+
+    // Header
+    if (_state == STATE_HEADER)
+    {
+        if (_isGzip)
+        {
+            static const uint8_t GZIP_HEADER[] = { 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff };
+            memcpy(pOut, GZIP_HEADER, sizeof(GZIP_HEADER));
+            pOut += sizeof(GZIP_HEADER);
+        }
+        else
+        {
+            // zlib header - deflate with 4KB window, fastest
+            *pOut++ = 0x48;
+            *pOut++ = 0x0d;
+        }
+
+        // Single final block with fixed Huffman codes
+        putBits(pOut, 1, 1);
+        putBits(pOut, 1, 2);
+        _state = STATE_DATA;
+    }
+
+    // Data - each symbol needs at most 6 bytes including bits already buffered
+    static const uint32_t MAX_SYMBOL_BYTES = 8;
+    uint32_t checksumStartPos = _inPos;
+    while ((_state == STATE_DATA) && (pOut + MAX_SYMBOL_BYTES <= pOutEnd))
+    {
+        // End of data
+        if (_inPos >= inLen)
+        {
+            putLiteralOrLength(pOut, 256);
+            flushBits(pOut);
+            _state = STATE_TRAILER;
+            break;
+        }
+
+        // Find match
+        uint32_t matchDist = 0;
+        uint32_t matchLen = findMatch(pIn, inLen, _inPos, matchDist);
+        if (matchLen >= MIN_MATCH)
+        {
+            putMatch(pOut, matchLen, matchDist);
+            for (uint32_t i = 0; i < matchLen; i++)
+                insertHash(pIn, inLen, _inPos + i);
+            _inPos += matchLen;
+        }
+        else
+        {
+            putLiteralOrLength(pOut, pIn[_inPos]);
+            insertHash(pIn, inLen, _inPos);
+            _inPos++;
+        }
+    }
+    updateChecksums(pIn + checksumStartPos, _inPos - checksumStartPos);
+
+    // Trailer
+    static const uint32_t TRAILER_MAX_BYTES = 8;
+    if ((_state == STATE_TRAILER) && (pOut + TRAILER_MAX_BYTES <= pOutEnd))
+    {
+        if (_isGzip)
+        {
+            uint32_t trailer[2] = { _crc32, inLen };
+            for (uint32_t i = 0; i < 2; i++)
+                for (uint32_t j = 0; j < 4; j++)
+                    *pOut++ = (trailer[i] >> (j * 8)) & 0xff;
+        }
+        else
+        {
+            for (int j = 3; j >= 0; j--)
+                *pOut++ = (_adler32 >> (j * 8)) & 0xff;
+        }
+        _state = STATE_DONE;
+    }
+    return pOut - pOutStart;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Match finding
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebDeflate::findMatch(const uint8_t* pIn, uint32_t inLen, uint32_t pos, uint32_t& matchDist) const
+{
+    if (pos + MIN_MATCH > inLen)
+        return 0;
+    uint32_t maxLen = inLen - pos < MAX_MATCH ? inLen - pos : MAX_MATCH;
+    uint32_t bestLen = 0;
+    uint32_t candPlusOne = _hashHead[hash3(pIn + pos)];
+    for (uint32_t chain = 0; (chain < _maxChain) && (candPlusOne != 0); chain++)
+    {
+        uint32_t cand = candPlusOne - 1;
+        if ((cand >= pos) || (pos - cand > WINDOW_BYTES))
+            break;
+
+        // Check match length (quick check of the byte which would extend the best match first)
+        if (pIn[cand + bestLen] == pIn[pos + bestLen])
+        {
+            uint32_t len = 0;
+            while ((len < maxLen) && (pIn[cand + len] == pIn[pos + len]))
+                len++;
+            if (len > bestLen)
+            {
+                bestLen = len;
+                matchDist = pos - cand;
+                if (len == maxLen)
+                    break;
+            }
+        }
+
+        // Next in chain
+        if (_hashPrev.empty())
+            break;
+        uint32_t delta = _hashPrev[cand & (WINDOW_BYTES - 1)];
+        if ((delta == 0) || (delta > cand))
+            break;
+        candPlusOne = cand - delta + 1;
+    }
+    return bestLen;
+}
+
+void RaftWebDeflate::insertHash(const uint8_t* pIn, uint32_t inLen, uint32_t pos)
+{
+    if (pos + MIN_MATCH > inLen)
+        return;
+    uint32_t hashVal = hash3(pIn + pos);
+    if (!_hashPrev.empty())
+    {
+        uint32_t prevPlusOne = _hashHead[hashVal];
+        uint32_t delta = (prevPlusOne != 0) ? pos - (prevPlusOne - 1) : 0;
+        _hashPrev[pos & (WINDOW_BYTES - 1)] = delta < WINDOW_BYTES ? delta : 0;
+    }
+    _hashHead[hashVal] = pos + 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Bit output
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebDeflate::putBits(uint8_t*& pOut, uint32_t value, uint32_t numBits)
+{
+    _bitBuf |= value << _bitCount;
+    _bitCount += numBits;
+    while (_bitCount >= 8)
+    {
+        *pOut++ = _bitBuf & 0xff;
+        _bitBuf >>= 8;
+        _bitCount -= 8;
+    }
+}
+
+void RaftWebDeflate::putHuffman(uint8_t*& pOut, uint32_t code, uint32_t numBits)
+{
+    // Huffman codes are sent most significant bit first
+    uint32_t reversed = 0;
+    for (uint32_t i = 0; i < numBits; i++)
+    {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    putBits(pOut, reversed, numBits);
+}
+
+void RaftWebDeflate::putLiteralOrLength(uint8_t*& pOut, uint32_t symbol)
+{
+    // Fixed Huffman codes
+    if (symbol < 144)
+        putHuffman(pOut, 0x30 + symbol, 8);
+    else if (symbol < 256)
+        putHuffman(pOut, 0x190 + symbol - 144, 9);
+    else if (symbol < 280)
+        putHuffman(pOut, symbol - 256, 7);
+    else
+        putHuffman(pOut, 0xc0 + symbol - 280, 8);
+}
+
+void RaftWebDeflate::putMatch(uint8_t*& pOut, uint32_t matchLen, uint32_t matchDist)
+{
+    // Length
+    uint32_t lenCode = sizeof(DEFLATE_LEN_BASE) / sizeof(DEFLATE_LEN_BASE[0]) - 1;
+    while (DEFLATE_LEN_BASE[lenCode] > matchLen)
+        lenCode--;
+    putLiteralOrLength(pOut, 257 + lenCode);
+    if (DEFLATE_LEN_EXTRA[lenCode])
+        putBits(pOut, matchLen - DEFLATE_LEN_BASE[lenCode], DEFLATE_LEN_EXTRA[lenCode]);
+
+    // Distance
+    uint32_t distCode = sizeof(DEFLATE_DIST_BASE) / sizeof(DEFLATE_DIST_BASE[0]) - 1;
+    while (DEFLATE_DIST_BASE[distCode] > matchDist)
+        distCode--;
+    putHuffman(pOut, distCode, 5);
+    if (DEFLATE_DIST_EXTRA[distCode])
+        putBits(pOut, matchDist - DEFLATE_DIST_BASE[distCode], DEFLATE_DIST_EXTRA[distCode]);
+}
+
+void RaftWebDeflate::flushBits(uint8_t*& pOut)
+{
+    if (_bitCount > 0)
+        *pOut++ = _bitBuf & 0xff;
+    _bitBuf = 0;
+    _bitCount = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Checksums
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebDeflate::updateChecksums(const uint8_t* pBuf, uint32_t bufLen)
+{
+    if (_isGzip)
+    {
+        _crc32 = RaftWebBodyDecoder::crc32Update(_crc32, pBuf, bufLen);
+        return;
+    }
+    static const uint32_t ADLER_MOD = 65521;
+    uint32_t a = _adler32 & 0xffff;
+    uint32_t b = _adler32 >> 16;
+    while (bufLen > 0)
+    {
+        // Process in blocks small enough that the sums can't overflow before the modulo
+        uint32_t blockLen = bufLen < 5552 ? bufLen : 5552;
+        bufLen -= blockLen;
+        while (blockLen--)
+        {
+            a += *pBuf++;
+            b += a;
+        }
+        a %= ADLER_MOD;
+        b %= ADLER_MOD;
+    }
+    _adler32 = (b << 16) | a;
+}
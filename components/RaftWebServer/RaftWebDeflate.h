@@ -0,0 +1,95 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// Streaming deflate compressor for responses (gzip or zlib wrapped)
+// The whole input must be available (e.g. a REST API response string) so matches reference the input
+// directly and no window copy is needed. Output uses fixed Huffman codes with a small hash-chain match
+// finder which keeps RAM use to ~12KB and suits the repetitive text of JSON. The level sets how far
+// match chains are searched (1 = fastest).
+class RaftWebDeflate
+{
+public:
+    RaftWebDeflate();
+
+    // Setup - returns false if memory isn't available
+    bool setup(bool isGzip, uint32_t level);
+
+    // Compress more of the input into the output buffer (which should be at least MIN_OUT_BYTES)
+    // Returns the number of bytes written - call repeatedly until isDone()
+    uint32_t compress(const uint8_t* pIn, uint32_t inLen, uint8_t* pOut, uint32_t outMax);
+
+    // Check done
+    bool isDone() const
+    {
+        return _state == STATE_DONE;
+    }
+
+    // Encoding name for Content-Encoding
+    const char* getEncodingName() const
+    {
+        return _isGzip ? "gzip" : "deflate";
+    }
+
+    // Minimum output buffer size
+    static const uint32_t MIN_OUT_BYTES = 32;
+
+    // Level limits
+    static const uint32_t MAX_LEVEL = 9;
+
+private:
+    enum DeflateState
+    {
+        STATE_HEADER,
+        STATE_DATA,
+        STATE_TRAILER,
+        STATE_DONE
+    };
+    DeflateState _state = STATE_HEADER;
+    bool _isGzip = true;
+
+    // Position in input
+    uint32_t _inPos = 0;
+
+    // Bit buffer
+    uint32_t _bitBuf = 0;
+    uint32_t _bitCount = 0;
+
+    // Checksums
+    uint32_t _crc32 = 0;
+    uint32_t _adler32 = 1;
+
+    // Match finder
+    static const uint32_t WINDOW_BYTES = 4096;
+    static const uint32_t HASH_BITS = 10;
+    static const uint32_t MIN_MATCH = 3;
+    static const uint32_t MAX_MATCH = 258;
+    std::vector<uint32_t> _hashHead;
+    std::vector<uint16_t> _hashPrev;
+    uint32_t _maxChain = 1;
+
+    // Helpers
+    void putBits(uint8_t*& pOut, uint32_t value, uint32_t numBits);
+    void putHuffman(uint8_t*& pOut, uint32_t code, uint32_t numBits);
+    void putLiteralOrLength(uint8_t*& pOut, uint32_t symbol);
+    void putMatch(uint8_t*& pOut, uint32_t matchLen, uint32_t matchDist);
+    void flushBits(uint8_t*& pOut);
+    uint32_t findMatch(const uint8_t* pIn, uint32_t inLen, uint32_t pos, uint32_t& matchDist) const;
+    void insertHash(const uint8_t* pIn, uint32_t inLen, uint32_t pos);
+    static uint32_t hash3(const uint8_t* p)
+    {
+        // Multiplicative hash of all 3 bytes (top HASH_BITS bits of the product)
+        uint32_t val = (uint32_t(p[0]) << 16) | (uint32_t(p[1]) << 8) | p[2];
+        return (val * 2654435761u) >> (32 - HASH_BITS);
+    }
+    void updateChecksums(const uint8_t* pBuf, uint32_t bufLen);
+};
@@ -0,0 +1,171 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include "Logger.h"
+#include "RaftWebFramePool.h"
+#include "SpiramAwareAllocator.h"
+
+// Warn
+#define WARN_ON_FRAME_POOL_SETUP_FAIL
+
+// Debug
+// #define DEBUG_WEB_FRAME_POOL
+
+static const char* MODULE_PREFIX = "RaftWebFramePool";
+
+// Statics
+uint8_t* RaftWebFramePool::_pPoolMem = nullptr;
+std::vector<RaftWebFrameBlock*> RaftWebFramePool::_freeList;
+uint32_t RaftWebFramePool::_numBlocks = 0;
+uint32_t RaftWebFramePool::_blockPayloadBytes = RaftWebFramePool::DEFAULT_BLOCK_PAYLOAD_BYTES;
+bool RaftWebFramePool::_isSetup = false;
+RaftMutex RaftWebFramePool::_poolMutex;
+uint32_t RaftWebFramePool::_allocFailCount = 0;
+uint32_t RaftWebFramePool::_heapAllocCount = 0;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Setup
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebFramePool::setup(uint32_t numBlocks, uint32_t blockPayloadBytes)
+{
+    if (_isSetup)
+        return;
+    RaftMutex_init(_poolMutex);
+    _isSetup = true;
+
+    // Allocate pool memory in a single block (prefers SPIRAM if available)
+    _blockPayloadBytes = blockPayloadBytes;
+    uint32_t blockStride = sizeof(RaftWebFrameBlock) + pooledDataBytes();
+    blockStride = (blockStride + alignof(RaftWebFrameBlock) - 1) & ~(alignof(RaftWebFrameBlock) - 1);
+    SpiramAwareAllocator<uint8_t> allocator;
+    _pPoolMem = numBlocks > 0 ? allocator.allocate(numBlocks * blockStride) : nullptr;
+    if (!_pPoolMem)
+    {
+#ifdef WARN_ON_FRAME_POOL_SETUP_FAIL
+        if (numBlocks > 0)
+            LOG_W(MODULE_PREFIX, "setup failed to allocate %d blocks of %d bytes", numBlocks, blockStride);
+#endif
+        return;
+    }
+
+    // Create free list
+    _numBlocks = numBlocks;
+    _freeList.reserve(numBlocks);
+    for (uint32_t i = 0; i < numBlocks; i++)
+    {
+        RaftWebFrameBlock* pBlock = new (_pPoolMem + i * blockStride) RaftWebFrameBlock();
+        pBlock->refCount = 0;
+        pBlock->capacity = pooledDataBytes();
+        pBlock->isPooled = true;
+        _freeList.push_back(pBlock);
+    }
+
+#ifdef DEBUG_WEB_FRAME_POOL
+    LOG_I(MODULE_PREFIX, "setup numBlocks %d blockPayloadBytes %d stride %d",
+                numBlocks, blockPayloadBytes, blockStride);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Allocate a block
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftWebFrameBlock* RaftWebFramePool::alloc(uint32_t payloadLen)
+{
+    RaftWebFrameBlock* pBlock = nullptr;
+
+    // Use the pool if the payload fits
+    if (_isSetup && (payloadLen <= _blockPayloadBytes) && (_numBlocks > 0))
+    {
+        if (RaftMutex_lock(_poolMutex, FREE_LIST_LOCK_WAIT_MS))
+        {
+            if (!_freeList.empty())
+            {
+                pBlock = _freeList.back();
+                _freeList.pop_back();
+            }
+            RaftMutex_unlock(_poolMutex);
+        }
+        if (!pBlock)
+        {
+            // Pool exhausted - callers treat this as backpressure
+            _allocFailCount++;
+            return nullptr;
+        }
+    }
+    else
+    {
+        // Heap allocation for large payloads (or if the pool isn't setup)
+        uint32_t dataBytes = FRAME_HEADROOM_BYTES + payloadLen;
+        SpiramAwareAllocator<uint8_t> allocator;
+        uint8_t* pMem = allocator.allocate(sizeof(RaftWebFrameBlock) + dataBytes);
+        if (!pMem)
+        {
+            _allocFailCount++;
+            return nullptr;
+        }
+        pBlock = new (pMem) RaftWebFrameBlock();
+        pBlock->capacity = dataBytes;
+        pBlock->isPooled = false;
+        _heapAllocCount++;
+    }
+    pBlock->refCount = 1;
+    pBlock->headerState = RaftWebFrameBlock::HEADER_NONE;
+    pBlock->headerLen = 0;
+    return pBlock;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Release a reference
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebFramePool::release(RaftWebFrameBlock* pBlock)
+{
+    if (!pBlock)
+        return;
+    if (pBlock->refCount.fetch_sub(1) != 1)
+        return;
+
+    // Last reference released
+    if (pBlock->isPooled)
+    {
+        RaftMutex_lock(_poolMutex, RAFT_MUTEX_WAIT_FOREVER);
+        _freeList.push_back(pBlock);
+        RaftMutex_unlock(_poolMutex);
+    }
+    else
+    {
+        uint32_t memBytes = sizeof(RaftWebFrameBlock) + pBlock->capacity;
+        pBlock->~RaftWebFrameBlock();
+        SpiramAwareAllocator<uint8_t> allocator;
+        allocator.deallocate(reinterpret_cast<uint8_t*>(pBlock), memBytes);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Check availability
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebFramePool::isAvailable(uint32_t payloadLen)
+{
+    // Large payloads come from the heap so aren't limited by the pool
+    if (!_isSetup || (_numBlocks == 0) || (payloadLen > _blockPayloadBytes))
+        return true;
+    return getNumFree() > 0;
+}
+
+uint32_t RaftWebFramePool::getNumFree()
+{
+    if (!_isSetup || !RaftMutex_lock(_poolMutex, FREE_LIST_LOCK_WAIT_MS))
+        return 0;
+    uint32_t numFree = _freeList.size();
+    RaftMutex_unlock(_poolMutex);
+    return numFree;
+}
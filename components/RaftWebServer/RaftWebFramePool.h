@@ -0,0 +1,106 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+#include "RaftThreading.h"
+
+// Block of memory holding a frame - the header is immediately followed by the data area
+// which is (headroom + payload) bytes long
+class RaftWebFrameBlock
+{
+public:
+    std::atomic<uint32_t> refCount;
+    uint32_t capacity;
+    bool isPooled;
+
+    // Protocol header in the headroom - written once (by whichever holder sends first) and then
+    // shared read-only by every frame referencing the block
+    static const uint8_t HEADER_NONE = 0;
+    static const uint8_t HEADER_WRITING = 1;
+    static const uint8_t HEADER_WRITTEN = 2;
+    std::atomic<uint8_t> headerState;
+    uint8_t headerLen;
+    uint8_t* data()
+    {
+        return reinterpret_cast<uint8_t*>(this + 1);
+    }
+};
+
+// Pool of ref-counted frame blocks used for outbound websocket frames
+// Blocks are pre-allocated so that frames don't need a heap allocation per message and
+// reserve headroom for the websocket header so the payload is never copied again after
+// being written by the producer. Payloads too big for a pooled block use the heap.
+class RaftWebFramePool
+{
+public:
+    // Headroom reserved before the payload (max websocket header is 2 + 8 len + 4 mask bytes)
+    static const uint32_t FRAME_HEADROOM_BYTES = 14;
+
+    // Defaults
+    static const uint32_t DEFAULT_NUM_BLOCKS = 16;
+    static const uint32_t DEFAULT_BLOCK_PAYLOAD_BYTES = 1500;
+
+    // Setup - can only be done once (before any frames are allocated)
+    static void setup(uint32_t numBlocks, uint32_t blockPayloadBytes);
+
+    // Allocate a block with a single reference for a payload of the given length
+    // Returns nullptr if the pool is exhausted (or heap allocation fails for large payloads)
+    static RaftWebFrameBlock* alloc(uint32_t payloadLen);
+
+    // Add and release references
+    static void addRef(RaftWebFrameBlock* pBlock)
+    {
+        if (pBlock)
+            pBlock->refCount.fetch_add(1);
+    }
+    static void release(RaftWebFrameBlock* pBlock);
+
+    // Check if a block can be allocated for a payload of this length
+    static bool isAvailable(uint32_t payloadLen = 0);
+
+    // Stats
+    static uint32_t getNumFree();
+    static uint32_t getNumBlocks()
+    {
+        return _numBlocks;
+    }
+    static uint32_t getAllocFailCount()
+    {
+        return _allocFailCount;
+    }
+    static uint32_t getHeapAllocCount()
+    {
+        return _heapAllocCount;
+    }
+
+private:
+    // Pool memory and free list
+    static uint8_t* _pPoolMem;
+    static std::vector<RaftWebFrameBlock*> _freeList;
+    static uint32_t _numBlocks;
+    static uint32_t _blockPayloadBytes;
+    static bool _isSetup;
+    static RaftMutex _poolMutex;
+
+    // Time to wait for the free list lock (contention is brief so this shouldn't be treated as exhaustion)
+    static const uint32_t FREE_LIST_LOCK_WAIT_MS = 5;
+
+    // Stats
+    static uint32_t _allocFailCount;
+    static uint32_t _heapAllocCount;
+
+    // Get size of the data area of a pooled block
+    static uint32_t pooledDataBytes()
+    {
+        return FRAME_HEADROOM_BYTES + _blockPayloadBytes;
+    }
+};
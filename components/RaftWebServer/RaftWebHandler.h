@@ -55,6 +55,10 @@ public:
     {
         return false;
     }
+    virtual bool isSSEventsHandler() const
+    {
+        return false;
+    }
     void setWebServerSettings(const RaftWebServerSettings& webServerSettings)
     {
         _webServerSettings = webServerSettings;
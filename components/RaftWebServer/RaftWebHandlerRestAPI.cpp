@@ -68,8 +68,7 @@ RaftWebResponder* RaftWebHandlerRestAPI::getNewResponder(const RaftWebRequestHea
     }
     // Looks like we can handle this so create a new responder object
     RaftWebResponder* pResponder = new RaftWebResponderRestAPI(endpoint, this, params, 
-                    reqStr, requestHeader.extract, 
-                    _webServerSettings.restAPIChannelID);
+                    reqStr, requestHeader.extract, _webServerSettings);
 
     // Debug
 #ifdef DEBUG_WEB_HANDLER_REST_API
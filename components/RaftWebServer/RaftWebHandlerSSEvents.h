@@ -17,10 +17,14 @@
 class RaftWebHandlerSSEvents : public RaftWebHandler
 {
 public:
-    RaftWebHandlerSSEvents(const String& eventsPath, RaftWebSSEventsCB eventCallback)
-            : _eventCallback(eventCallback)
+    RaftWebHandlerSSEvents(const String& eventsPath, RaftWebSSEventsCB eventCallback,
+                uint32_t ringMaxEvents = RaftWebSSEventRing::DEFAULT_MAX_EVENTS,
+                uint32_t ringMaxBytes = RaftWebSSEventRing::DEFAULT_MAX_BYTES,
+                uint32_t maxEventsPerSec = 0)
+            : _eventCallback(eventCallback), _eventRing(ringMaxEvents, ringMaxBytes)
     {
         _eventsPath = eventsPath;
+        _maxEventsPerSec = maxEventsPerSec;
     }
     virtual ~RaftWebHandlerSSEvents()
     {
@@ -29,6 +33,10 @@ public:
     {
         return "HandlerSSEvents";
     }
+    virtual bool isSSEventsHandler() const override final
+    {
+        return true;
+    }
     virtual RaftWebResponder* getNewResponder(const RaftWebRequestHeader& requestHeader, 
                 const RaftWebRequestParams& params, 
                 RaftHttpStatusCode &statusCode) override final
@@ -47,9 +55,31 @@ public:
             return NULL;
         }
 
-        // We can handle this so create a new responder object
+        // We can handle this so create a new responder object - subscribers reconnecting with
+        // Last-Event-ID are replayed the events they missed
+        uint32_t startCursor = _eventRing.getStartCursor(requestHeader.extract.lastEventId,
+                    requestHeader.extract.lastEventIdValid);
+
+        // Subscribers can ask for specific groups (?groups=a,b) and a lower max event rate (&maxRate=N)
+        String groupsList;
+        uint32_t maxEventsPerSec = _maxEventsPerSec;
+        std::vector<RaftJson::NameValuePair> nameValues;
+        RaftJson::extractNameValues(requestHeader.params, "=", "&", NULL, nameValues);
+        for (const RaftJson::NameValuePair& nvPair : nameValues)
+        {
+            if (nvPair.name.equals("groups"))
+                groupsList = nvPair.value;
+            else if (nvPair.name.equals("maxRate"))
+            {
+                uint32_t reqMaxRate = strtoul(nvPair.value.c_str(), NULL, 10);
+                if ((maxEventsPerSec == 0) || ((reqMaxRate > 0) && (reqMaxRate < maxEventsPerSec)))
+                    maxEventsPerSec = reqMaxRate;
+            }
+        }
+        uint32_t groupMask = _eventRing.getGroupMask(groupsList);
+
         RaftWebResponder* pResponder = new RaftWebResponderSSEvents(this, params, requestHeader.URL, 
-                    _eventCallback, webServerSettings);
+                    _eventCallback, _eventRing, startCursor, groupMask, maxEventsPerSec, _webServerSettings);
 
         // Debug
         // LOG_W("WebHandlerSSEvents", "getNewResponder constructed new responder %lx uri %s", (unsigned long)pResponder, requestHeader.URL.c_str());
@@ -59,7 +89,25 @@ public:
         return pResponder;
     }
 
+    // Send event to all subscribers
+    void sendEvent(const char* eventContent, const char* eventGroup)
+    {
+        _eventRing.addEvent(eventContent, eventGroup);
+    }
+
+    // Stats
+    String getStatsJSON()
+    {
+        return _eventRing.getStatsJSON();
+    }
+
 private:
     String _eventsPath;
     RaftWebSSEventsCB _eventCallback;
+
+    // Ring of recent events shared by all subscribers
+    RaftWebSSEventRing _eventRing;
+
+    // Max events per second sent to each subscriber (0 for no limit)
+    uint32_t _maxEventsPerSec;
 };
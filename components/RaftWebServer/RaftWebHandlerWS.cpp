@@ -37,11 +37,25 @@ RaftWebHandlerWS::RaftWebHandlerWS(const RaftJsonIF& config,
     _wsPath = _wsPath.startsWith("/") ? _wsPath : "/" + _wsPath;
     _pktMaxBytes = config.getLong("pktMaxBytes", DEFAULT_WS_PKT_MAX_BYTES);
     _txQueueMax = config.getLong("txQueueMax", DEFAULT_WS_TX_QUEUE_MAX);
+    _txQueuePolicy = RaftWebTxQueue::getPolicyFromStr(config.getString("txQueuePolicy", "fifo"));
+    _txKeyPos = config.getLong("txKeyPos", 0);
+    _txKeyLen = config.getLong("txKeyLen", 0);
+    if (_txKeyLen > MAX_TX_KEY_LEN)
+        _txKeyLen = MAX_TX_KEY_LEN;
+    if (_txKeyLen > 0)
+        _txKeyFn = std::bind(&RaftWebHandlerWS::getTxKeyFromFrame, this, 
+                    std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+    else if (_txQueuePolicy == TX_QUEUE_POLICY_LATEST)
+        LOG_W(MODULE_PREFIX, "RaftWebHandlerWS pfix %s txQueuePolicy latest needs txKeyLen (or setTxKeyFn) - dropOldest used",
+                _wsPath.c_str());
     _pingIntervalMs = config.getLong("pingMs", DEFAULT_WS_PING_MS);
     bool closeIfNoPong = config.getBool("closeIfNoPong", false);
     _noPongMs = (closeIfNoPong && (_pingIntervalMs != 0)) ? _pingIntervalMs * 2 + 2000 : 0;
     _isBinaryWS = config.getString("content", "binary").equalsIgnoreCase("binary");
 
+    // Pub/sub
+    _pubSub.setup(config);
+
     // Setup channelIDs mapping
     _maxConnections = config.getLong("maxConn", 5);
     _connectionSlots.clear();
@@ -49,8 +63,9 @@ RaftWebHandlerWS::RaftWebHandlerWS(const RaftJsonIF& config,
 
 #ifdef DEBUG_WS_OPEN_CLOSE
     // Debug
-    LOG_I(MODULE_PREFIX, "RaftWebHandlerWS: wsPath %s pktMaxBytes %d txQueueMax %d pingMs %d noPongMs %d isBinary %s obj %p",
-            _wsPath.c_str(), _pktMaxBytes, _txQueueMax, _pingIntervalMs, _noPongMs, _isBinaryWS ? "Y" : "N", this);
+    LOG_I(MODULE_PREFIX, "RaftWebHandlerWS: wsPath %s pktMaxBytes %d txQueueMax %d txQueuePolicy %s pingMs %d noPongMs %d isBinary %s obj %p",
+            _wsPath.c_str(), _pktMaxBytes, _txQueueMax, RaftWebTxQueue::getPolicyStr(_txQueuePolicy),
+            _pingIntervalMs, _noPongMs, _isBinaryWS ? "Y" : "N", this);
 #endif
 }
 
@@ -100,6 +115,10 @@ RaftWebResponder* RaftWebHandlerWS::getNewResponder(const RaftWebRequestHeader&
             connSlotIdx, channelID, _connectionSlots[connSlotIdx].isUsed);
 #endif
     
+    // Latest-value coalescing needs a key - without one every frame would replace the last
+    RaftWebTxQueuePolicy txQueuePolicy = ((_txQueuePolicy == TX_QUEUE_POLICY_LATEST) && !_txKeyFn) ? 
+                TX_QUEUE_POLICY_DROP_OLDEST : _txQueuePolicy;
+
     RaftWebResponder* pResponder = new RaftWebResponderWS(this, params, requestHeader.URL, 
                 _inboundCanAcceptCB, 
                 _rxMsgCB, 
@@ -108,7 +127,9 @@ RaftWebResponder* RaftWebHandlerWS::getNewResponder(const RaftWebRequestHeader&
                 _txQueueMax,
                 _pingIntervalMs,
                 _noPongMs,
-                _isBinaryWS
+                _isBinaryWS,
+                txQueuePolicy,
+                _txKeyFn
                 );
 
     if (pResponder)
@@ -136,6 +157,9 @@ void RaftWebHandlerWS::responderDelete(RaftWebResponderWS* pResponder)
     uint32_t channelID = UINT32_MAX;
     if (pResponder->getChannelID(channelID))
     {
+        // Remove any topic subscriptions
+        _pubSub.removeSubscriber(channelID);
+
         // Find the connection slot
         int connSlotIdx = findConnectionSlotByChannelID(channelID);
         if (connSlotIdx < 0)
@@ -165,6 +189,9 @@ void RaftWebHandlerWS::responderDelete(RaftWebResponderWS* pResponder)
 
 void RaftWebHandlerWS::responderInactive(uint32_t channelID)
 {
+    // Remove any topic subscriptions
+    _pubSub.removeSubscriber(channelID);
+
     // Find the connection slot
     int connSlotIdx = findConnectionSlotByChannelID(channelID);
     if (connSlotIdx < 0)
@@ -212,3 +239,15 @@ int RaftWebHandlerWS::findConnectionSlotByChannelID(uint32_t channelID)
     }
     return -1;
 }
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Get tx coalescing key from bytes in the frame (big-endian, up to 4 bytes)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebHandlerWS::getTxKeyFromFrame(uint32_t channelID, const uint8_t* pBuf, uint32_t bufLen)
+{
+    uint32_t frameKey = 0;
+    for (uint32_t i = 0; (i < _txKeyLen) && (_txKeyPos + i < bufLen); i++)
+        frameKey = (frameKey << 8) | pBuf[_txKeyPos + i];
+    return frameKey;
+}
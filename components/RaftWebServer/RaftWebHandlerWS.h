@@ -14,6 +14,7 @@
 #include <vector>
 #include "RaftWebRequestHeader.h"
 #include "RaftWebResponderWS.h"
+#include "RaftWebPubSub.h"
 
 class RaftWebHandlerWS : public RaftWebHandler
 {
@@ -47,6 +48,29 @@ public:
         _connectionSlots[wsConnIdx].isUsed = false;
     }
 
+    // Set function used to extract the coalescing key from frames (for latest-value tx queue policy)
+    // - without a key function (or txKeyLen in config) the latest policy behaves as dropOldest
+    void setTxKeyFn(RaftWebSocketTxKeyFnType txKeyFn)
+    {
+        _txKeyFn = txKeyFn;
+    }
+
+    // Pub/sub (topics multiplexed over each websocket on this handler)
+    RaftWebPubSub& getPubSub()
+    {
+        return _pubSub;
+    }
+    bool isBinary() const
+    {
+        return _isBinaryWS;
+    }
+
+    // Handle inbound control message - returns true if handled (not passed to the inbound callback)
+    bool handleInboundControlMsg(uint32_t channelID, const uint8_t* pBuf, uint32_t bufLen)
+    {
+        return _pubSub.handleControlMsg(channelID, pBuf, bufLen);
+    }
+
     virtual RaftWebResponder* getNewResponder(const RaftWebRequestHeader& requestHeader, 
                 const RaftWebRequestParams& params, 
                 RaftHttpStatusCode &statusCode
@@ -65,8 +89,15 @@ private:
     // Max packet size
     uint32_t _pktMaxBytes = DEFAULT_WS_PKT_MAX_BYTES;
 
-    // Tx queue max
+    // Tx queue max and policy
     uint32_t _txQueueMax = DEFAULT_WS_TX_QUEUE_MAX;
+    RaftWebTxQueuePolicy _txQueuePolicy = TX_QUEUE_POLICY_FIFO;
+
+    // Tx coalescing key - either from a callback or from bytes within the frame
+    RaftWebSocketTxKeyFnType _txKeyFn;
+    uint32_t _txKeyPos = 0;
+    uint32_t _txKeyLen = 0;
+    static const uint32_t MAX_TX_KEY_LEN = 4;
 
     // Ping/pong interval and timeout
     uint32_t _pingIntervalMs = DEFAULT_WS_PING_MS;
@@ -75,6 +106,9 @@ private:
     // Content type
     bool _isBinaryWS = true;
 
+    // Pub/sub topics
+    RaftWebPubSub _pubSub;
+
     // WS interface functions
     RaftWebSocketInboundCanAcceptFnType _inboundCanAcceptCB;
     RaftWebSocketInboundHandleMsgFnType _rxMsgCB;
@@ -104,4 +138,7 @@ private:
     // Handle connection slots
     int findFreeConnectionSlot();
     int findConnectionSlotByChannelID(uint32_t channelID);
+
+    // Default key extraction
+    uint32_t getTxKeyFromFrame(uint32_t channelID, const uint8_t* pBuf, uint32_t bufLen);
 };
@@ -6,6 +6,7 @@
 //
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#include "RaftArduino.h"
 #include "RaftWebInterface.h"
 
 // Web Methods
@@ -63,3 +64,16 @@ const char* RaftWebInterface::getHTTPStatusStr(RaftHttpStatusCode status)
     }
     return "";
 }
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Get endpoint name from a REST API request string (first element of the path)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+String RaftWebInterface::getEndpointName(const String& reqStr)
+{
+    int nameStart = reqStr.startsWith("/") ? 1 : 0;
+    int nameEnd = nameStart;
+    while ((nameEnd < (int)reqStr.length()) && (reqStr[nameEnd] != '/') && (reqStr[nameEnd] != '?'))
+        nameEnd++;
+    return reqStr.substring(nameStart, nameEnd);
+}
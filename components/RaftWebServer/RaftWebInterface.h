@@ -11,6 +11,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <functional>
+#include <memory>
 #include "RaftRetCode.h"
 
 class FileStreamBlock;
@@ -127,6 +128,9 @@ public:
 
     // HTTP status codes
     static const char* getHTTPStatusStr(RaftHttpStatusCode status);
+
+    // Get endpoint name from a REST API request string (first element of the path)
+    static String getEndpointName(const String& reqStr);
 };
 
 // Endpoint functions
@@ -136,6 +140,19 @@ typedef std::function<RaftRetCode(const String &reqStr, const uint8_t *pData, si
 typedef std::function<RaftRetCode(const String &reqStr, FileStreamBlock& fileStreamBlock, const APISourceInfo& sourceInfo)> RaftWebAPIFnChunk;
 typedef std::function<bool(const APISourceInfo& sourceInfo)> RaftWebAPIFnIsReady;
 
+// Streaming responses - the endpoint function is called once (after any request body is received) and
+// sets the generator which is then called as send buffer space becomes available. The generator writes up
+// to bufMaxLen bytes to pBuf and returns the number written (0 if nothing is ready yet) and sets isFinal
+// when the response is complete. Responses are sent with chunked transfer-encoding.
+typedef std::function<uint32_t(uint8_t* pBuf, uint32_t bufMaxLen, bool& isFinal)> RaftWebRespGenerator;
+typedef std::function<RaftRetCode(const String &reqStr, RaftWebRespGenerator& generator, const APISourceInfo& sourceInfo)> RaftWebAPIFnStream;
+
+// Deferred responses - the endpoint function starts the work and returns, the response is sent when the
+// handle is completed (from any task) or a 504 is sent on timeout (see RaftWebDeferred.h)
+class RaftWebDeferredResponse;
+typedef std::shared_ptr<RaftWebDeferredResponse> RaftWebDeferredHandle;
+typedef std::function<RaftRetCode(const String &reqStr, RaftWebDeferredHandle handle, const APISourceInfo& sourceInfo)> RaftWebAPIFnDeferred;
+
 // REST API support
 class RaftWebServerRestEndpoint
 {
@@ -146,6 +163,11 @@ public:
         restApiFnBody = nullptr;
         restApiFnChunk = nullptr;
 		restApiFnIsReady = nullptr;
+        restApiFnStream = nullptr;
+        restApiFnDeferred = nullptr;
+        compressLevel = -1;
+        runOnWorker = false;
+        cacheTtlMs = 0;
     }
 	RaftWebServerRestEndpoint(const RaftWebServerRestEndpoint& other)
 	{
@@ -153,6 +175,11 @@ public:
 		restApiFnBody = other.restApiFnBody;
 		restApiFnChunk = other.restApiFnChunk;
 		restApiFnIsReady = other.restApiFnIsReady;
+		restApiFnStream = other.restApiFnStream;
+		restApiFnDeferred = other.restApiFnDeferred;
+		compressLevel = other.compressLevel;
+		runOnWorker = other.runOnWorker;
+		cacheTtlMs = other.cacheTtlMs;
 	}
 	RaftWebServerRestEndpoint& operator=(const RaftWebServerRestEndpoint& other)
 	{
@@ -160,12 +187,28 @@ public:
 		restApiFnBody = other.restApiFnBody;
 		restApiFnChunk = other.restApiFnChunk;
 		restApiFnIsReady = other.restApiFnIsReady;
+		restApiFnStream = other.restApiFnStream;
+		restApiFnDeferred = other.restApiFnDeferred;
+		compressLevel = other.compressLevel;
+		runOnWorker = other.runOnWorker;
+		cacheTtlMs = other.cacheTtlMs;
 		return *this;
 	}
     RaftWebAPIFunction restApiFn;
     RaftWebAPIFnBody restApiFnBody;
     RaftWebAPIFnChunk restApiFnChunk;
 	RaftWebAPIFnIsReady restApiFnIsReady;
+    RaftWebAPIFnStream restApiFnStream;
+    RaftWebAPIFnDeferred restApiFnDeferred;
+
+    // Response compression level (0 = never compress, -1 = server default)
+    int compressLevel;
+
+    // Run the endpoint function on the REST API worker pool (if enabled)
+    bool runOnWorker;
+
+    // Time GET responses can be served from the response cache (0 = not cached)
+    uint32_t cacheTtlMs;
 };
 
 typedef std::function<bool(const char* url, RaftWebServerMethod method, RaftWebServerRestEndpoint& endpoint)> RaftWebAPIMatchEndpointCB;
@@ -174,3 +217,6 @@ typedef std::function<bool(const char* url, RaftWebServerMethod method, RaftWebS
 typedef std::function<bool(uint32_t channelID)> RaftWebSocketInboundCanAcceptFnType;
 typedef std::function<void(uint32_t channelID, const uint8_t* pBuf, uint32_t bufLen)> RaftWebSocketInboundHandleMsgFnType;
 
+// Extract the key (e.g. message type or topic) used to coalesce queued websocket tx frames
+typedef std::function<uint32_t(uint32_t channelID, const uint8_t* pBuf, uint32_t bufLen)> RaftWebSocketTxKeyFnType;
+
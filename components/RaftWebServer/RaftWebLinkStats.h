@@ -0,0 +1,91 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include "RaftArduino.h"
+
+// Link quality statistics from websocket ping/pong round-trip-time sampling and receive throttling
+// Smoothed RTT and jitter (RTT variation) use the same filter as TCP (RFC6298)
+class RaftWebLinkStats
+{
+public:
+    // Add an RTT sample
+    void addRTTSample(uint32_t rttUs)
+    {
+        if (sampleCount == 0)
+        {
+            smoothedRTTUs = rttUs;
+            jitterUs = rttUs / 2;
+            minRTTUs = rttUs;
+            maxRTTUs = rttUs;
+        }
+        else
+        {
+            uint32_t diffUs = smoothedRTTUs > rttUs ? smoothedRTTUs - rttUs : rttUs - smoothedRTTUs;
+            jitterUs = (3 * jitterUs + diffUs) / 4;
+            smoothedRTTUs = (7 * smoothedRTTUs + rttUs) / 8;
+            if (rttUs < minRTTUs)
+                minRTTUs = rttUs;
+            if (rttUs > maxRTTUs)
+                maxRTTUs = rttUs;
+        }
+        lastRTTUs = rttUs;
+        sampleCount++;
+    }
+
+    // Record a period when receiving was throttled (inbound consumer not ready)
+    void addRxThrottlePeriod(uint32_t durationMs)
+    {
+        rxThrottleCount++;
+        rxThrottleTotalMs += durationMs;
+        if (durationMs > rxThrottleMaxMs)
+            rxThrottleMaxMs = durationMs;
+    }
+
+    // Check valid
+    bool isValid() const
+    {
+        return sampleCount > 0;
+    }
+
+    // Get as JSON
+    String getJSON() const
+    {
+        return "{\"n\":" + String(sampleCount) +
+                ",\"lastUs\":" + String(lastRTTUs) +
+                ",\"srttUs\":" + String(smoothedRTTUs) +
+                ",\"jitterUs\":" + String(jitterUs) +
+                ",\"minUs\":" + String(minRTTUs) +
+                ",\"maxUs\":" + String(maxRTTUs) + "}";
+    }
+
+    // Get rx throttle stats as JSON
+    String getRxThrottleJSON() const
+    {
+        return "{\"n\":" + String(rxThrottleCount) +
+                ",\"totalMs\":" + String(rxThrottleTotalMs) +
+                ",\"maxMs\":" + String(rxThrottleMaxMs) +
+                ",\"active\":" + String(rxThrottleActive ? 1 : 0) + "}";
+    }
+
+    // Stats
+    uint32_t sampleCount = 0;
+    uint32_t lastRTTUs = 0;
+    uint32_t smoothedRTTUs = 0;
+    uint32_t jitterUs = 0;
+    uint32_t minRTTUs = 0;
+    uint32_t maxRTTUs = 0;
+
+    // Receive throttling (flow control)
+    uint32_t rxThrottleCount = 0;
+    uint32_t rxThrottleTotalMs = 0;
+    uint32_t rxThrottleMaxMs = 0;
+    bool rxThrottleActive = false;
+};
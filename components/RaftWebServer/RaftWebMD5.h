@@ -0,0 +1,123 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "RaftArduino.h"
+#include "esp_idf_version.h"
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(6, 0, 0)
+#include "psa/crypto.h"
+#else
+#include "mbedtls/md5.h"
+#endif
+#include "mbedtls/base64.h"
+
+// Incremental MD5 used to verify uploads (Content-MD5) as data arrives
+class RaftWebMD5
+{
+public:
+    static const uint32_t MD5_RESULT_LEN = 16;
+
+    RaftWebMD5()
+    {
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(6, 0, 0)
+        mbedtls_md5_init(&_ctx);
+#endif
+    }
+    ~RaftWebMD5()
+    {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(6, 0, 0)
+        psa_hash_abort(&_op);
+#else
+        mbedtls_md5_free(&_ctx);
+#endif
+    }
+
+    // Set the expected digest from a Content-MD5 header (base64) or a hex string
+    // Returns false if the string is not a valid digest
+    bool setExpected(const String& digestStr)
+    {
+        _isActive = false;
+        size_t digestLen = 0;
+        if (digestStr.length() == MD5_RESULT_LEN * 2)
+        {
+            for (uint32_t i = 0; i < MD5_RESULT_LEN; i++)
+            {
+                char hexStr[3] = { digestStr[i * 2], digestStr[i * 2 + 1], 0 };
+                char* pEnd = nullptr;
+                _expected[i] = strtoul(hexStr, &pEnd, 16);
+                if (pEnd != hexStr + 2)
+                    return false;
+            }
+            digestLen = MD5_RESULT_LEN;
+        }
+        else if (mbedtls_base64_decode(_expected, sizeof(_expected), &digestLen,
+                    (const uint8_t*)digestStr.c_str(), digestStr.length()) != 0)
+        {
+            return false;
+        }
+        if (digestLen != MD5_RESULT_LEN)
+            return false;
+
+        // Start hashing
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(6, 0, 0)
+        _op = PSA_HASH_OPERATION_INIT;
+        _isActive = psa_hash_setup(&_op, PSA_ALG_MD5) == PSA_SUCCESS;
+#else
+        _isActive = mbedtls_md5_starts(&_ctx) == 0;
+#endif
+        return _isActive;
+    }
+
+    // Check if verification is active
+    bool isActive() const
+    {
+        return _isActive;
+    }
+
+    // Add data
+    void update(const uint8_t* pBuf, uint32_t bufLen)
+    {
+        if (!_isActive)
+            return;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(6, 0, 0)
+        psa_hash_update(&_op, pBuf, bufLen);
+#else
+        mbedtls_md5_update(&_ctx, pBuf, bufLen);
+#endif
+    }
+
+    // Finish and check against expected digest
+    bool finishAndVerify()
+    {
+        if (!_isActive)
+            return true;
+        _isActive = false;
+        uint8_t result[MD5_RESULT_LEN];
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(6, 0, 0)
+        size_t hashLen = 0;
+        if (psa_hash_finish(&_op, result, sizeof(result), &hashLen) != PSA_SUCCESS)
+            return false;
+#else
+        if (mbedtls_md5_finish(&_ctx, result) != 0)
+            return false;
+#endif
+        return memcmp(result, _expected, MD5_RESULT_LEN) == 0;
+    }
+
+private:
+    bool _isActive = false;
+    uint8_t _expected[MD5_RESULT_LEN + 2] = {};
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(6, 0, 0)
+    psa_hash_operation_t _op = PSA_HASH_OPERATION_INIT;
+#else
+    mbedtls_md5_context _ctx;
+#endif
+};
@@ -330,13 +330,22 @@ bool RaftWebMultipart::processPayload(const uint8_t *buffer, uint32_t bufPos, ui
         // Check if we have already partially detected a boundary
         if (_boundaryIdx == 0)
         {
-            // If not use boyer-moore algorithm to safely skip non-boundary data
-            uint32_t boundaryLen = _boundaryStr.length();
-            while (bufPos + boundaryLen < bufLen)
+            // If not skip quickly over data that can't contain the start of a boundary
+            // so that spans of payload are passed on in a single callback
+            if (_boundarySearch == BOUNDARY_SEARCH_HORSPOOL)
             {
-                if (isBoundaryChar(buffer[bufPos + boundaryLen - 1]))
-                    break;
-                bufPos += boundaryLen;
+                bufPos = skipNonBoundaryData(buffer, bufPos, bufLen);
+            }
+            else
+            {
+                uint32_t boundaryLen = _boundaryStr.length();
+                while (bufPos + boundaryLen < bufLen)
+                {
+                    uint8_t windowLast = buffer[bufPos + boundaryLen - 1];
+                    if (_boundaryCharMap[windowLast / 32] & (1u << (windowLast % 32)))
+                        break;
+                    bufPos += boundaryLen;
+                }
             }
         }
 
@@ -577,11 +586,6 @@ uint8_t RaftWebMultipart::lower(uint8_t c) const
     return c | 0x20;
 }
 
-inline bool RaftWebMultipart::isBoundaryChar(uint8_t c) const
-{
-    return _boundaryCharMap[c];
-}
-
 bool RaftWebMultipart::isHeaderFieldCharacter(uint8_t c) const
 {
     return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == ASCII_CODE_HYPHEN;
@@ -597,14 +601,58 @@ void RaftWebMultipart::clearCallbacks()
 
 void RaftWebMultipart::indexBoundary()
 {
-    // Clear boundary char map
+    // Build the Boyer-Moore-Horspool skip table - for each byte value this is the distance
+    // the search window can safely advance when that byte is the last one in the window
+    // Skips are clamped to the table element size which just makes the search a little less
+    // aggressive for very long boundaries
+    uint32_t boundaryLen = _boundaryStr.length();
+    uint32_t maxSkip = boundaryLen < UINT8_MAX ? boundaryLen : UINT8_MAX;
+    memset(_boundarySkip, maxSkip, sizeof(_boundarySkip));
+    for (uint32_t i = 0; i + 1 < boundaryLen; i++)
+    {
+        uint32_t skip = boundaryLen - 1 - i;
+        _boundarySkip[(uint8_t)_boundaryStr.charAt(i)] = skip < maxSkip ? skip : maxSkip;
+    }
+
+    // Map of chars appearing in the boundary
     memset(_boundaryCharMap, 0, sizeof(_boundaryCharMap));
+    for (uint32_t i = 0; i < boundaryLen; i++)
+    {
+        uint8_t boundaryChar = (uint8_t)_boundaryStr.charAt(i);
+        _boundaryCharMap[boundaryChar / 32] |= 1u << (boundaryChar % 32);
+    }
+}
 
-    // Set elem in boundary char map for each char appearing in _boundaryStr
-    for (uint32_t i = 0; i < _boundaryStr.length(); i++)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Skip data which cannot be the start of a boundary
+// Returns the position of the first byte which needs to be checked by the byte-by-byte parser - this is either
+// a full candidate boundary, a CR which may be the start of a boundary split across buffers, or the last byte
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebMultipart::skipNonBoundaryData(const uint8_t *buffer, uint32_t bufPos, uint32_t bufLen) const
+{
+    // Horspool search while a whole boundary fits in the remaining data
+    const uint8_t* pBoundary = (const uint8_t*)_boundaryStr.c_str();
+    uint32_t boundaryLen = _boundaryStr.length();
+    if (boundaryLen == 0)
+        return bufPos;
+    uint8_t boundaryLast = pBoundary[boundaryLen - 1];
+    while (bufPos + boundaryLen <= bufLen)
     {
-        _boundaryCharMap[(uint8_t)_boundaryStr.charAt(i)] = true;
+        uint8_t windowLast = buffer[bufPos + boundaryLen - 1];
+        if ((windowLast == boundaryLast) && (memcmp(buffer + bufPos, pBoundary, boundaryLen - 1) == 0))
+            return bufPos;
+        bufPos += _boundarySkip[windowLast];
     }
+
+    // Any boundary in the remaining data is partial and must start with a CR - memchr is
+    // generally vectorised by the C library so this is faster than checking each byte
+    if (bufPos >= bufLen)
+        return bufLen - 1;
+    const uint8_t* pCR = (const uint8_t*)memchr(buffer + bufPos, pBoundary[0], bufLen - bufPos);
+    if (!pCR)
+        return bufLen - 1;
+    return pCR - buffer;
 }
 
 bool RaftWebMultipart::succeeded() const
@@ -81,6 +81,19 @@ public:
         _pCtx = pCtx;
     }
 
+    // Method used to skip payload data which can't contain a boundary - the char map method (which only
+    // skips when the byte at the end of a boundary-length window doesn't appear in the boundary) was used
+    // before the Horspool search and is kept for comparison (see examples/perftest/multipartbench)
+    enum BoundarySearch
+    {
+        BOUNDARY_SEARCH_HORSPOOL,
+        BOUNDARY_SEARCH_CHAR_MAP
+    };
+    void setBoundarySearch(BoundarySearch boundarySearch)
+    {
+        _boundarySearch = boundarySearch;
+    }
+
     static const char* getEventText(RaftMultipartEvent event)
     {
         switch(event)
@@ -123,8 +136,12 @@ private:
     // Boundary string
     String _boundaryStr;
 
-    // Index of chars in boundaryStr for boyes-moore algorithm
-    bool _boundaryCharMap[UINT8_MAX+1];
+    // Skip table for Boyer-Moore-Horspool boundary search
+    uint8_t _boundarySkip[UINT8_MAX+1];
+
+    // Boundary search method and map of chars in the boundary (for the char map method)
+    BoundarySearch _boundarySearch = BOUNDARY_SEARCH_HORSPOOL;
+    uint32_t _boundaryCharMap[(UINT8_MAX+1)/32];
 
     // Buffer to handle unmatched boundaries
     std::vector<uint8_t> _boundaryBuf;
@@ -168,7 +185,7 @@ private:
     void stateCallback(RaftMultipartEvent event, const uint8_t *pBuf, uint32_t pos);
     void dataCallback(const uint8_t *pBuf, uint32_t pos, uint32_t bufLen);
     uint8_t lower(uint8_t c) const;
-    inline bool isBoundaryChar(uint8_t c) const;
+    uint32_t skipNonBoundaryData(const uint8_t *buffer, uint32_t bufPos, uint32_t bufLen) const;
     bool isHeaderFieldCharacter(uint8_t c) const;
     bool processHeaderByte(const uint8_t *buffer, uint32_t bufPos, uint32_t len);
     bool processPayload(const uint8_t *buffer, uint32_t bufPos, uint32_t len);
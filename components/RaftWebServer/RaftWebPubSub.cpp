@@ -0,0 +1,274 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Logger.h"
+#include "RaftUtils.h"
+#include "RaftJson.h"
+#include "RaftWebPubSub.h"
+
+// Warn
+#define WARN_ON_PUBSUB_TOO_MANY_TOPICS
+
+// Debug
+// #define DEBUG_PUBSUB_SUBSCRIBE
+// #define DEBUG_PUBSUB_PUBLISH
+
+static const char* MODULE_PREFIX = "RaftWebPubSub";
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constructor / Destructor
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftWebPubSub::RaftWebPubSub()
+{
+    RaftMutex_init(_topicsMutex);
+}
+
+RaftWebPubSub::~RaftWebPubSub()
+{
+    RaftMutex_destroy(_topicsMutex);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Setup
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebPubSub::setup(const RaftJsonIF& config)
+{
+    _isEnabled = config.getBool("pubsub", false);
+    if (!_isEnabled)
+        return;
+    _maxTopics = config.getLong("maxTopics", DEFAULT_MAX_TOPICS);
+    double defaultRateHz = config.getDouble("topicMaxRateHz", 0);
+    _defaultMinIntervalMs = defaultRateHz > 0 ? (uint32_t)(1000 / defaultRateHz) : 0;
+
+    // Topics with specific rate caps
+    std::vector<String> topicConfigs;
+    config.getArrayElems("topics", topicConfigs);
+    for (const String& topicConfigStr : topicConfigs)
+    {
+        RaftJson topicConfig = topicConfigStr;
+        String topicName = topicConfig.getString("name", "");
+        if (topicName.length() == 0)
+            continue;
+        double maxRateHz = topicConfig.getDouble("maxRateHz", 0);
+        _topics[topicName].minIntervalMs = maxRateHz > 0 ? (uint32_t)(1000 / maxRateHz) : 0;
+    }
+
+#ifdef DEBUG_PUBSUB_SUBSCRIBE
+    LOG_I(MODULE_PREFIX, "setup maxTopics %d defaultMinIntervalMs %d configuredTopics %d",
+                _maxTopics, _defaultMinIntervalMs, (int)_topics.size());
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Handle control message
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebPubSub::handleControlMsg(uint32_t channelID, const uint8_t* pBuf, uint32_t bufLen)
+{
+    // Quick check for a JSON object containing a sub/unsub key
+    if (!_isEnabled || !pBuf || (bufLen < 2))
+        return false;
+    uint32_t pos = 0;
+    while ((pos < bufLen) && isspace(pBuf[pos]))
+        pos++;
+    if ((pos >= bufLen) || (pBuf[pos] != '{'))
+        return false;
+    static const uint8_t SUB_KEY[] = "sub\"";
+    if (Raft::findInBuf(pBuf, bufLen, SUB_KEY, sizeof(SUB_KEY) - 1) < 0)
+        return false;
+
+    // Parse
+    RaftJson msgJson(String(pBuf, bufLen));
+    std::vector<String> subTopics;
+    std::vector<String> unsubTopics;
+    msgJson.getArrayElems("sub", subTopics);
+    msgJson.getArrayElems("unsub", unsubTopics);
+    if ((subTopics.size() == 0) && (unsubTopics.size() == 0))
+        return false;
+
+    // Update subscriptions (the lock is only held briefly by publishers so wait rather than drop the request)
+    RaftMutex_lock(_topicsMutex, RAFT_MUTEX_WAIT_FOREVER);
+    for (const String& topic : subTopics)
+        subscribe(channelID, topic);
+    for (const String& topic : unsubTopics)
+        unsubscribe(channelID, topic);
+    RaftMutex_unlock(_topicsMutex);
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Remove subscriber
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebPubSub::removeSubscriber(uint32_t channelID)
+{
+    if (!_isEnabled)
+        return;
+    RaftMutex_lock(_topicsMutex, RAFT_MUTEX_WAIT_FOREVER);
+    for (auto& topicIt : _topics)
+    {
+        std::vector<uint32_t>& subs = topicIt.second.subscribers;
+        for (auto it = subs.begin(); it != subs.end(); )
+            it = (*it == channelID) ? subs.erase(it) : it + 1;
+    }
+    RaftMutex_unlock(_topicsMutex);
+#ifdef DEBUG_PUBSUB_SUBSCRIBE
+    LOG_I(MODULE_PREFIX, "removeSubscriber channelID %d", channelID);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Get subscribers for publish
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebPubSub::getSubscribersForPublish(const char* topic, std::vector<uint32_t>& channelIDs)
+{
+    channelIDs.clear();
+    if (!_isEnabled || !topic)
+        return false;
+    if (!RaftMutex_lock(_topicsMutex, TOPICS_MUTEX_WAIT_MS))
+        return false;
+    auto topicIt = _topics.find(topic);
+    if ((topicIt == _topics.end()) || topicIt->second.subscribers.empty())
+    {
+        RaftMutex_unlock(_topicsMutex);
+        return false;
+    }
+
+    // Check rate cap
+    TopicRec& topicRec = topicIt->second;
+    uint32_t nowMs = millis();
+    if ((topicRec.minIntervalMs != 0) && (topicRec.publishCount != 0) &&
+            !Raft::isTimeout(nowMs, topicRec.lastPublishMs, topicRec.minIntervalMs))
+    {
+        topicRec.rateDropCount++;
+        RaftMutex_unlock(_topicsMutex);
+        return false;
+    }
+    topicRec.lastPublishMs = nowMs;
+    topicRec.publishCount++;
+    channelIDs = topicRec.subscribers;
+    RaftMutex_unlock(_topicsMutex);
+
+#ifdef DEBUG_PUBSUB_PUBLISH
+    LOG_I(MODULE_PREFIX, "getSubscribersForPublish topic %s numSubscribers %d", topic, (int)channelIDs.size());
+#endif
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Wrap messages
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebPubSub::getWrappedLen(const char* topic, uint32_t payloadLen, bool isBinary)
+{
+    uint32_t topicLen = strnlen(topic, MAX_TOPIC_NAME_LEN);
+    if (isBinary)
+        return 1 + topicLen + payloadLen;
+    // {"topic":"<topic>","data":<payload>}
+    return 10 + topicLen + 9 + payloadLen + 1;
+}
+
+void RaftWebPubSub::wrapMsg(uint8_t* pOut, const char* topic, const uint8_t* pPayload, uint32_t payloadLen, bool isBinary)
+{
+    uint32_t topicLen = strnlen(topic, MAX_TOPIC_NAME_LEN);
+    if (isBinary)
+    {
+        *pOut++ = topicLen;
+        memcpy(pOut, topic, topicLen);
+        memcpy(pOut + topicLen, pPayload, payloadLen);
+        return;
+    }
+    memcpy(pOut, "{\"topic\":\"", 10);
+    pOut += 10;
+    memcpy(pOut, topic, topicLen);
+    pOut += topicLen;
+    memcpy(pOut, "\",\"data\":", 9);
+    pOut += 9;
+    memcpy(pOut, pPayload, payloadLen);
+    pOut += payloadLen;
+    *pOut = '}';
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stats
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+String RaftWebPubSub::getStatsJSON()
+{
+    String statsStr = "[";
+    if (RaftMutex_lock(_topicsMutex, TOPICS_MUTEX_WAIT_MS))
+    {
+        bool isFirst = true;
+        for (auto& topicIt : _topics)
+        {
+            statsStr += String(isFirst ? "" : ",") + "{\"topic\":\"" + topicIt.first +
+                    "\",\"subs\":" + String((uint32_t)topicIt.second.subscribers.size()) +
+                    ",\"pubs\":" + String(topicIt.second.publishCount) +
+                    ",\"rateDrops\":" + String(topicIt.second.rateDropCount) + "}";
+            isFirst = false;
+        }
+        RaftMutex_unlock(_topicsMutex);
+    }
+    return statsStr + "]";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Subscribe / unsubscribe (mutex must be held)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebPubSub::subscribe(uint32_t channelID, const String& topic)
+{
+    if ((topic.length() == 0) || (topic.length() > MAX_TOPIC_NAME_LEN) || (topic.indexOf('"') >= 0))
+        return;
+    auto topicIt = _topics.find(topic);
+    if (topicIt == _topics.end())
+    {
+        if (_topics.size() >= _maxTopics)
+        {
+#ifdef WARN_ON_PUBSUB_TOO_MANY_TOPICS
+            LOG_W(MODULE_PREFIX, "subscribe channelID %d topic %s rejected - max topics %d",
+                        channelID, topic.c_str(), _maxTopics);
+#endif
+            return;
+        }
+        topicIt = _topics.emplace(topic, TopicRec()).first;
+        topicIt->second.minIntervalMs = _defaultMinIntervalMs;
+    }
+    std::vector<uint32_t>& subs = topicIt->second.subscribers;
+    for (uint32_t subChannelID : subs)
+    {
+        if (subChannelID == channelID)
+            return;
+    }
+    subs.push_back(channelID);
+#ifdef DEBUG_PUBSUB_SUBSCRIBE
+    LOG_I(MODULE_PREFIX, "subscribe channelID %d topic %s numSubs %d", channelID, topic.c_str(), (int)subs.size());
+#endif
+}
+
+void RaftWebPubSub::unsubscribe(uint32_t channelID, const String& topic)
+{
+    auto topicIt = _topics.find(topic);
+    if (topicIt == _topics.end())
+        return;
+    std::vector<uint32_t>& subs = topicIt->second.subscribers;
+    for (auto it = subs.begin(); it != subs.end(); ++it)
+    {
+        if (*it == channelID)
+        {
+            subs.erase(it);
+            break;
+        }
+    }
+#ifdef DEBUG_PUBSUB_SUBSCRIBE
+    LOG_I(MODULE_PREFIX, "unsubscribe channelID %d topic %s numSubs %d", channelID, topic.c_str(), (int)subs.size());
+#endif
+}
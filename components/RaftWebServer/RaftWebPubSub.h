@@ -0,0 +1,85 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <map>
+#include <vector>
+#include "RaftArduino.h"
+#include "RaftJsonIF.h"
+#include "RaftThreading.h"
+
+// Topic-based publish/subscribe over websockets
+// Clients subscribe to named topics on a single websocket by sending {"sub":["topic1","topic2"]}
+// and unsubscribe with {"unsub":["topic1"]}. Published messages are wrapped (once) for all
+// subscribers - for text websockets as {"topic":"name","data":<payload>} and for binary
+// websockets as [topicLen][topic][payload].
+class RaftWebPubSub
+{
+public:
+    RaftWebPubSub();
+    virtual ~RaftWebPubSub();
+
+    // Setup from websocket config
+    void setup(const RaftJsonIF& config);
+
+    // Check enabled
+    bool isEnabled() const
+    {
+        return _isEnabled;
+    }
+
+    // Handle an inbound message - returns true if it was a subscription control message
+    bool handleControlMsg(uint32_t channelID, const uint8_t* pBuf, uint32_t bufLen);
+
+    // Remove all subscriptions for a channel
+    void removeSubscriber(uint32_t channelID);
+
+    // Get subscribers for a publish - returns false if there are no subscribers or the
+    // topic's rate cap would be exceeded (in which case the publish should be dropped)
+    bool getSubscribersForPublish(const char* topic, std::vector<uint32_t>& channelIDs);
+
+    // Get length of the wrapped message and wrap it into a buffer
+    static uint32_t getWrappedLen(const char* topic, uint32_t payloadLen, bool isBinary);
+    static void wrapMsg(uint8_t* pOut, const char* topic, const uint8_t* pPayload, uint32_t payloadLen, bool isBinary);
+
+    // Get stats as JSON
+    String getStatsJSON();
+
+private:
+    // Enabled
+    bool _isEnabled = false;
+
+    // Topic record
+    class TopicRec
+    {
+    public:
+        std::vector<uint32_t> subscribers;
+        uint32_t minIntervalMs = 0;
+        uint32_t lastPublishMs = 0;
+        uint32_t publishCount = 0;
+        uint32_t rateDropCount = 0;
+    };
+    std::map<String, TopicRec> _topics;
+
+    // Limits
+    uint32_t _maxTopics = DEFAULT_MAX_TOPICS;
+    static const uint32_t DEFAULT_MAX_TOPICS = 32;
+    static const uint32_t MAX_TOPIC_NAME_LEN = 64;
+
+    // Default rate cap applied to topics not explicitly configured
+    uint32_t _defaultMinIntervalMs = 0;
+
+    // Mutex (publishing may happen on a different task from connection servicing)
+    RaftMutex _topicsMutex;
+    static const uint32_t TOPICS_MUTEX_WAIT_MS = 5;
+
+    // Helpers
+    void subscribe(uint32_t channelID, const String& topic);
+    void unsubscribe(uint32_t channelID, const String& topic);
+};
@@ -31,6 +31,20 @@ public:
         isMultipart = false;
         isDigest = false;
         contentLength = 0;
+        fileName.clear();
+        contentMD5.clear();
+        crc16 = 0;
+        crc16Valid = false;
+        fileLenBytes = 0;
+        fileLenValid = false;
+        contentEncoding.clear();
+        decodedLength = 0;
+        decodedLengthValid = false;
+        acceptsGzip = false;
+        acceptsDeflate = false;
+        ifNoneMatch.clear();
+        lastEventId = 0;
+        lastEventIdValid = false;
     }
 
     // Request method
@@ -54,6 +68,32 @@ public:
     // Authorization
     String authorization;
     bool isDigest;
+
+    // Raw (non-multipart) upload info - file name from Content-Disposition and the
+    // same CRC16 and FileLengthBytes headers used in multipart uploads
+    String fileName;
+    String contentMD5;
+    uint32_t crc16;
+    bool crc16Valid;
+    uint32_t fileLenBytes;
+    bool fileLenValid;
+
+    // Content encoding of the request body (e.g. gzip) and the decoded length if the
+    // client supplies it (X-Uncompressed-Length)
+    String contentEncoding;
+    uint32_t decodedLength;
+    bool decodedLengthValid;
+
+    // Response encodings accepted by the client (Accept-Encoding)
+    bool acceptsGzip;
+    bool acceptsDeflate;
+
+    // Entity tags of a response the client already has (If-None-Match)
+    String ifNoneMatch;
+
+    // Id of the last server-side event received by a reconnecting client (Last-Event-ID)
+    uint32_t lastEventId;
+    bool lastEventIdValid;
 };
 
 // Web request header info
@@ -16,10 +16,12 @@
 class RaftWebRequestParams
 {
 public:
-    RaftWebRequestParams(RaftWebConnReadyToSendFn webConnReadyToSend, RaftWebConnSendFn webConnRawSend, uint32_t connId) 
+    RaftWebRequestParams(RaftWebConnReadyToSendFn webConnReadyToSend, RaftWebConnSendFn webConnRawSend, uint32_t connId,
+                RaftWebConnTimerFn webConnTimer = nullptr) 
     {
         _webConnReadyToSend = webConnReadyToSend;
         _webConnRawSend = webConnRawSend;
+        _webConnTimer = webConnTimer;
         this->connId = connId;
     }
     RaftWebConnSendFn getWebConnRawSend() const
@@ -30,6 +32,10 @@ public:
     {
         return _webConnReadyToSend;
     }
+    RaftWebConnTimerFn getWebConnTimer() const
+    {
+        return _webConnTimer;
+    }
 
     // Connection ID (for debugging)
     uint32_t connId = 0;
@@ -37,4 +43,5 @@ public:
 private:
     RaftWebConnSendFn _webConnRawSend;
     RaftWebConnReadyToSendFn _webConnReadyToSend;
+    RaftWebConnTimerFn _webConnTimer;
 };
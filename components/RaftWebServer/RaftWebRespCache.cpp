@@ -0,0 +1,204 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Logger.h"
+#include "RaftUtils.h"
+#include "ArduinoTime.h"
+#include "RaftWebInterface.h"
+#include "RaftWebRespCache.h"
+
+// Debug
+// #define DEBUG_RESP_CACHE
+
+#if defined(DEBUG_RESP_CACHE)
+static const char* MODULE_PREFIX = "RaftWebRespCache";
+#endif
+
+// Statics
+std::list<RaftWebRespCache::Entry> RaftWebRespCache::_entries;
+uint32_t RaftWebRespCache::_maxBytes = 0;
+uint32_t RaftWebRespCache::_usedBytes = 0;
+RaftMutex RaftWebRespCache::_cacheMutex;
+uint32_t RaftWebRespCache::_hitCount = 0;
+uint32_t RaftWebRespCache::_missCount = 0;
+uint32_t RaftWebRespCache::_evictCount = 0;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Setup
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebRespCache::setup(uint32_t maxBytes)
+{
+    if ((_maxBytes > 0) || (maxBytes == 0))
+        return;
+    RaftMutex_init(_cacheMutex);
+    _maxBytes = maxBytes;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Lookup
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebRespCache::lookup(const String& reqStr, CachedResp& cachedResp)
+{
+    if (!isEnabled() || !RaftMutex_lock(_cacheMutex, RAFT_MUTEX_WAIT_FOREVER))
+        return false;
+    bool isHit = false;
+    for (auto it = _entries.begin(); it != _entries.end(); ++it)
+    {
+        if (!it->reqStr.equals(reqStr))
+            continue;
+
+        // Expired entries are removed
+        uint32_t ageMs = Raft::timeElapsed(millis(), it->storedMs);
+        if (ageMs >= it->ttlMs)
+        {
+            removeEntry(it);
+            break;
+        }
+
+        // Move to front (most recently used)
+        cachedResp.pBody = it->pBody;
+        cachedResp.etag = it->etag;
+        cachedResp.remainingMs = it->ttlMs - ageMs;
+        _entries.splice(_entries.begin(), _entries, it);
+        isHit = true;
+        break;
+    }
+    if (isHit)
+        _hitCount++;
+    else
+        _missCount++;
+    RaftMutex_unlock(_cacheMutex);
+
+#ifdef DEBUG_RESP_CACHE
+    LOG_I(MODULE_PREFIX, "lookup %s %s", reqStr.c_str(), isHit ? "HIT" : "MISS");
+#endif
+    return isHit;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Store
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebRespCache::store(const String& reqStr, std::shared_ptr<const String> pBody, uint32_t ttlMs, CachedResp& cachedResp)
+{
+    cachedResp.pBody = pBody;
+    cachedResp.etag = makeETag(*pBody);
+    cachedResp.remainingMs = ttlMs;
+    if (!isEnabled() || (ttlMs == 0))
+        return false;
+
+    // Create entry
+    Entry entry;
+    entry.reqStr = reqStr;
+    entry.endpointName = RaftWebInterface::getEndpointName(reqStr);
+    entry.pBody = cachedResp.pBody;
+    entry.etag = cachedResp.etag;
+    entry.storedMs = millis();
+    entry.ttlMs = ttlMs;
+    uint32_t entryBytes = entry.getBytes();
+    if (entryBytes > _maxBytes)
+        return false;
+
+    if (!RaftMutex_lock(_cacheMutex, RAFT_MUTEX_WAIT_FOREVER))
+        return false;
+
+    // Replace any existing entry for the request
+    for (auto it = _entries.begin(); it != _entries.end(); ++it)
+    {
+        if (it->reqStr.equals(reqStr))
+        {
+            removeEntry(it);
+            break;
+        }
+    }
+
+    // Evict least recently used entries to make space
+    while ((_usedBytes + entryBytes > _maxBytes) && !_entries.empty())
+    {
+        removeEntry(std::prev(_entries.end()));
+        _evictCount++;
+    }
+    _entries.push_front(entry);
+    _usedBytes += entryBytes;
+    RaftMutex_unlock(_cacheMutex);
+
+#ifdef DEBUG_RESP_CACHE
+    LOG_I(MODULE_PREFIX, "store %s len %d ttlMs %d etag %s usedBytes %d",
+                reqStr.c_str(), pBody->length(), ttlMs, cachedResp.etag.c_str(), _usedBytes);
+#endif
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Invalidate
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebRespCache::invalidate(const char* pEndpointName)
+{
+    if (!isEnabled() || !RaftMutex_lock(_cacheMutex, RAFT_MUTEX_WAIT_FOREVER))
+        return;
+    for (auto it = _entries.begin(); it != _entries.end(); )
+    {
+        auto nextIt = std::next(it);
+        if (!pEndpointName || it->endpointName.equals(pEndpointName))
+            removeEntry(it);
+        it = nextIt;
+    }
+    RaftMutex_unlock(_cacheMutex);
+
+#ifdef DEBUG_RESP_CACHE
+    LOG_I(MODULE_PREFIX, "invalidate %s", pEndpointName ? pEndpointName : "ALL");
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stats
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+String RaftWebRespCache::getStatsJSON()
+{
+    uint32_t numEntries = 0;
+    if (isEnabled() && RaftMutex_lock(_cacheMutex, RAFT_MUTEX_WAIT_FOREVER))
+    {
+        numEntries = _entries.size();
+        RaftMutex_unlock(_cacheMutex);
+    }
+    return "{\"entries\":" + String(numEntries) +
+            ",\"bytes\":" + String(_usedBytes) +
+            ",\"maxBytes\":" + String(_maxBytes) +
+            ",\"hits\":" + String(_hitCount) +
+            ",\"misses\":" + String(_missCount) +
+            ",\"evictions\":" + String(_evictCount) + "}";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers (cache mutex must be held)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebRespCache::removeEntry(std::list<Entry>::iterator it)
+{
+    _usedBytes -= it->getBytes();
+    _entries.erase(it);
+}
+
+String RaftWebRespCache::makeETag(const String& body)
+{
+    // FNV-1a hash of the body and its length
+    uint32_t hash = 2166136261u;
+    const uint8_t* pData = (const uint8_t*)body.c_str();
+    for (uint32_t i = 0; i < body.length(); i++)
+    {
+        hash ^= pData[i];
+        hash *= 16777619u;
+    }
+    char etagStr[24];
+    snprintf(etagStr, sizeof(etagStr), "\"%08x-%x\"", (unsigned)hash, (unsigned)body.length());
+    return etagStr;
+}
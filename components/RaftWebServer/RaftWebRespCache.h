@@ -0,0 +1,83 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include "RaftArduino.h"
+#include "RaftThreading.h"
+
+// Cache of REST API GET responses
+// Entries are keyed on the request (path and query), expire after the endpoint's TTL and are evicted
+// least-recently-used first to keep within the memory budget. Bodies are shared so a responder can keep
+// sending a body after its entry has been evicted or invalidated.
+class RaftWebRespCache
+{
+public:
+    // Setup - maxBytes == 0 disables the cache
+    static void setup(uint32_t maxBytes);
+
+    // Check enabled
+    static bool isEnabled()
+    {
+        return _maxBytes > 0;
+    }
+
+    // Cached response
+    class CachedResp
+    {
+    public:
+        std::shared_ptr<const String> pBody;
+        String etag;
+        uint32_t remainingMs = 0;
+    };
+
+    // Lookup - returns false if not cached (or expired)
+    static bool lookup(const String& reqStr, CachedResp& cachedResp);
+
+    // Store a response - returns false if it can't be cached (cachedResp is filled in either case)
+    static bool store(const String& reqStr, std::shared_ptr<const String> pBody, uint32_t ttlMs, CachedResp& cachedResp);
+
+    // Invalidate entries for an endpoint (or all entries if pEndpointName is null)
+    static void invalidate(const char* pEndpointName);
+
+    // Stats
+    static String getStatsJSON();
+
+private:
+    // Entries (most recently used first)
+    class Entry
+    {
+    public:
+        String reqStr;
+        String endpointName;
+        std::shared_ptr<const String> pBody;
+        String etag;
+        uint32_t storedMs = 0;
+        uint32_t ttlMs = 0;
+        uint32_t getBytes() const
+        {
+            return reqStr.length() + endpointName.length() + pBody->length() + ENTRY_OVERHEAD_BYTES;
+        }
+    };
+    static std::list<Entry> _entries;
+    static uint32_t _maxBytes;
+    static uint32_t _usedBytes;
+    static RaftMutex _cacheMutex;
+    static const uint32_t ENTRY_OVERHEAD_BYTES = 64;
+
+    // Stats
+    static uint32_t _hitCount;
+    static uint32_t _missCount;
+    static uint32_t _evictCount;
+
+    // Helpers
+    static void removeEntry(std::list<Entry>::iterator it);
+    static String makeETag(const String& body);
+};
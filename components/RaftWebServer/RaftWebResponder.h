@@ -12,6 +12,9 @@
 #include "RaftArduino.h"
 #include "RaftJson.h"
 #include "RaftWebConnDefs.h"
+#include "RaftWebInterface.h"
+#include "RaftWebDataFrame.h"
+#include "RaftWebLinkStats.h"
 
 class RaftWebConnection;
 
@@ -102,6 +105,19 @@ public:
         return true;
     }
 
+    // Check if standard headers can be sent yet (responders with deferred responses hold them back
+    // until the response status is known)
+    virtual bool isHeaderReady()
+    {
+        return true;
+    }
+
+    // Get response status if the responder sets it (returns false to use the connection's status)
+    virtual bool getResponseStatus(RaftHttpStatusCode& status)
+    {
+        return false;
+    }
+
     // Ready to send data
     virtual bool isReadyToSend()
     {
@@ -114,9 +130,16 @@ public:
         return false;
     }
 
-    // Send event content and group
-    virtual void sendEvent(const char* eventContent, const char* eventGroup)
+    // Send a pre-encoded frame (the frame may be shared with other responders)
+    virtual bool encodeAndSendFrame(RaftWebDataFrame& frame)
     {
+        return false;
+    }
+
+    // Get link quality stats (returns false if not supported)
+    virtual bool getLinkStats(RaftWebLinkStats& linkStats)
+    {
+        return false;
     }
 
     // Get responder type
@@ -143,6 +166,11 @@ public:
         return false;
     }
 
+    // Timer started through the connection's timer function has expired
+    virtual void onTimer(RaftWebConnRespTimer respTimer, uint32_t nowMs)
+    {
+    }
+
 protected:
     // Connection status
     RaftWebConnStatus _connStatus;
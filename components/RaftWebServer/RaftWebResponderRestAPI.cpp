@@ -10,6 +10,7 @@
 #include "Logger.h"
 #include "FileStreamBlock.h"
 #include "APISourceInfo.h"
+#include "RaftJson.h"
 
 // #define DEBUG_RESPONDER_REST_API
 // #define DEBUG_RESPONDER_REST_API_NON_MULTIPART_DATA
@@ -18,8 +19,14 @@
 // #define DEBUG_MULTIPART_HEADERS
 // #define DEBUG_MULTIPART_DATA
 // #define DEBUG_RESPONDER_API_START_END
-
-#if defined(DEBUG_RESPONDER_REST_API) || defined(DEBUG_RESPONDER_REST_API_NON_MULTIPART_DATA) || defined(DEBUG_RESPONDER_REST_API_MULTIPART_DATA) || defined(DEBUG_MULTIPART_EVENTS) || defined(DEBUG_RESPONDER_REST_API) || defined(DEBUG_MULTIPART_DATA) || defined(DEBUG_RESPONDER_API_START_END)
+// #define DEBUG_RESPONDER_RAW_UPLOAD
+// #define DEBUG_RESPONDER_COMPRESS
+// #define DEBUG_RESPONDER_CHUNKED
+// #define DEBUG_RESPONDER_DEFERRED
+#define WARN_ON_RAW_UPLOAD_FAIL
+#define WARN_ON_DEFERRED_TIMEOUT
+
+#if defined(DEBUG_RESPONDER_REST_API) || defined(DEBUG_RESPONDER_REST_API_NON_MULTIPART_DATA) || defined(DEBUG_RESPONDER_REST_API_MULTIPART_DATA) || defined(DEBUG_MULTIPART_EVENTS) || defined(DEBUG_RESPONDER_REST_API) || defined(DEBUG_MULTIPART_DATA) || defined(DEBUG_RESPONDER_API_START_END) || defined(DEBUG_RESPONDER_RAW_UPLOAD) || defined(DEBUG_RESPONDER_COMPRESS) || defined(DEBUG_RESPONDER_CHUNKED) || defined(DEBUG_RESPONDER_DEFERRED) || defined(WARN_ON_DEFERRED_TIMEOUT) || defined(WARN_ON_RAW_UPLOAD_FAIL)
 static const char *MODULE_PREFIX = "RaftWebRespREST";
 #endif
 
@@ -30,8 +37,8 @@ static const char *MODULE_PREFIX = "RaftWebRespREST";
 RaftWebResponderRestAPI::RaftWebResponderRestAPI(const RaftWebServerRestEndpoint& endpoint, RaftWebHandler* pWebHandler, 
                     const RaftWebRequestParams& params, String& reqStr, 
                     const RaftWebRequestHeaderExtract& headerExtract,
-                    uint32_t channelID)
-    : _reqParams(params), _apiSourceInfo(channelID)
+                    const RaftWebServerSettings& webServerSettings)
+    : _reqParams(params), _apiSourceInfo(webServerSettings.restAPIChannelID)
 {
     _endpoint = endpoint;
     _pWebHandler = pWebHandler;
@@ -40,6 +47,9 @@ RaftWebResponderRestAPI::RaftWebResponderRestAPI(const RaftWebServerRestEndpoint
     _headerExtract = headerExtract;
     _respStrPos = 0;
     _sendStartMs = millis();
+    _respCompressMinBytes = webServerSettings.respCompressMinBytes;
+    _respCompressLevel = webServerSettings.respCompressLevel;
+    _deferredTimeoutMs = webServerSettings.deferredTimeoutMs;
 #ifdef APPLY_MIN_GAP_BETWEEN_API_CALLS_MS    
     _lastFileReqMs = 0;
 #endif
@@ -52,6 +62,21 @@ RaftWebResponderRestAPI::RaftWebResponderRestAPI(const RaftWebServerRestEndpoint
             std::placeholders::_5, std::placeholders::_6);
     _multipartParser.onHeaderNameValue = std::bind(&RaftWebResponderRestAPI::multipartOnHeaderNameValue, this, 
             std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+    _bodyDecodeCB = std::bind(&RaftWebResponderRestAPI::bodyDecodedData, this,
+            std::placeholders::_1, std::placeholders::_2);
+
+    // Body length
+    _bodyTotalLen = _headerExtract.contentLength;
+
+    // Check if body is encoded (compressed)
+    if (RaftWebBodyDecoder::isEncoded(_headerExtract.contentEncoding))
+    {
+        _pBodyDecoder = new RaftWebBodyDecoder();
+        if (!_pBodyDecoder->setup(_headerExtract.contentEncoding, webServerSettings.bodyDecodeWindowBytes))
+            _uploadError = _pBodyDecoder->getErrorStr();
+        _bodyTotalLen = _headerExtract.decodedLength;
+        _bodyTotalLenValid = _headerExtract.decodedLengthValid;
+    }
 
     // Check if multipart
     if (_headerExtract.isMultipart)
@@ -59,6 +84,23 @@ RaftWebResponderRestAPI::RaftWebResponderRestAPI(const RaftWebServerRestEndpoint
         _multipartParser.setBoundary(_headerExtract.multipartBoundary);
     }
 
+    // Check if raw upload
+    else
+    {
+        rawUploadSetup();
+    }
+
+    // Response is deferred for deferred endpoints and those run on the worker pool
+    _isDeferred = _endpoint.restApiFnDeferred || 
+                (_endpoint.runOnWorker && _endpoint.restApiFn && RaftWebWorkerPool::isEnabled());
+
+    // Use the upload pipeline if enabled
+    if (RaftWebUploadPipeline::isEnabled() && _endpoint.restApiFnChunk && (_headerExtract.isMultipart || _isRawUpload))
+    {
+        _pUploadStream = new RaftWebUploadStream();
+        _pUploadStream->begin(_endpoint.restApiFnChunk, _requestStr, _apiSourceInfo, _bodyTotalLen);
+    }
+
 #ifdef DEBUG_RESPONDER_REST_API
     LOG_I(MODULE_PREFIX, "constr new responder %d reqStr %s", (uint32_t)this, 
                     reqStr.c_str());
@@ -67,6 +109,12 @@ RaftWebResponderRestAPI::RaftWebResponderRestAPI(const RaftWebServerRestEndpoint
 
 RaftWebResponderRestAPI::~RaftWebResponderRestAPI()
 {
+    // Let the completing task know the response is no longer wanted
+    if (_deferredHandle)
+        _deferredHandle->abandon();
+    delete _pUploadStream;
+    delete _pBodyDecoder;
+    delete _pRespCompressor;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -78,29 +126,92 @@ bool RaftWebResponderRestAPI::handleInboundData(const uint8_t* pBuf, uint32_t da
     // Record data received so we know when to respond
     uint32_t curBufPos = _numBytesReceived;
     _numBytesReceived += dataLen;
+    bool isFinal = _numBytesReceived >= _headerExtract.contentLength;
+
+    // Handle data which is not encoded
+    if (!_pBodyDecoder)
+    {
+        handleBodyData(pBuf, dataLen, curBufPos, isFinal);
+        return true;
+    }
+
+    // Decode (once failed the rest of the body is discarded)
+    if (_uploadError.length() > 0)
+        return true;
+    bodyDecodeResult(_pBodyDecoder->decode(pBuf, dataLen, isFinal, _bodyDecodeCB));
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Handle decoded body data - returns false to pause decoding (resumed in readyToReceiveData())
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebResponderRestAPI::bodyDecodedData(const uint8_t* pBuf, uint32_t dataLen)
+{
+    handleBodyData(pBuf, dataLen, _bodyDecodedPos, false);
+    _bodyDecodedPos += dataLen;
+    return !_pUploadStream || _pUploadStream->canAccept();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Handle result of body decoding
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebResponderRestAPI::bodyDecodeResult(RaftRetCode retc)
+{
+    // Decoding paused
+    if (retc == RAFT_BUSY)
+        return;
+    if (retc != RAFT_OK)
+    {
+        _uploadError = _pBodyDecoder->getErrorStr();
+        return;
+    }
+
+    // The end of the decoded body is only known once all the encoded body has been decoded
+    if (_numBytesReceived >= _headerExtract.contentLength)
+    {
+        _bodyTotalLen = _bodyDecodedPos;
+        _bodyTotalLenValid = true;
+        handleBodyData(nullptr, 0, _bodyDecodedPos, true);
+    }
+}
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Handle body data (after any decoding)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebResponderRestAPI::handleBodyData(const uint8_t* pBuf, uint32_t dataLen, uint32_t bodyPos, bool isFinal)
+{
     // Handle data which may be multipart
     if (_headerExtract.isMultipart)
     {
 #ifdef DEBUG_RESPONDER_REST_API_MULTIPART_DATA
-        LOG_I(MODULE_PREFIX, "handleInboundData multipart len %d", dataLen);
+        LOG_I(MODULE_PREFIX, "handleBodyData multipart len %d", dataLen);
 #endif
-        _multipartParser.handleData(pBuf, dataLen);
+        if (dataLen > 0)
+            _multipartParser.handleData(pBuf, dataLen);
 #ifdef DEBUG_RESPONDER_REST_API_MULTIPART_DATA
-        LOG_I(MODULE_PREFIX, "handleInboundData multipart finished bytesRx %d contentLen %d", 
+        LOG_I(MODULE_PREFIX, "handleBodyData multipart finished bytesRx %d contentLen %d", 
                     _numBytesReceived, _headerExtract.contentLength);
 #endif
     }
+    else if (_isRawUpload)
+    {
+        if ((dataLen > 0) || isFinal)
+            rawUploadOnData(pBuf, dataLen, bodyPos, isFinal);
+    }
     else
     {
 #ifdef DEBUG_RESPONDER_REST_API_NON_MULTIPART_DATA
-        LOG_I(MODULE_PREFIX, "handleInboundData curPos %d bufLen %d totalLen %d", curBufPos, dataLen, _headerExtract.contentLength);
+        LOG_I(MODULE_PREFIX, "handleBodyData curPos %d bufLen %d totalLen %d", bodyPos, dataLen, _bodyTotalLen);
 #endif
-        // Send as the body
-        if (_endpoint.restApiFnBody)
-            _endpoint.restApiFnBody(_requestStr, pBuf, dataLen, curBufPos, _headerExtract.contentLength, _apiSourceInfo);
+        // Send as the body - if the decoded total isn't known the body ends with a zero length block
+        // once it is known
+        if (_endpoint.restApiFnBody && ((dataLen > 0) || (isFinal && _pBodyDecoder)))
+            _endpoint.restApiFnBody(_requestStr, pBuf, dataLen, bodyPos, 
+                        _bodyTotalLenValid ? _bodyTotalLen : SIZE_MAX, _apiSourceInfo);
     }
-    return true;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -142,33 +253,43 @@ uint32_t RaftWebResponderRestAPI::getResponseNext(uint8_t*& pBuf, uint32_t bufMa
                     bufMaxLen, _endpointCalled, _isActive);
 #endif
 
+    // Wait for paused body decoding to complete
+    if (_pBodyDecoder && _pBodyDecoder->isPaused())
+        return 0;
+
+    // Wait for pipelined upload writes to complete so the result can be reported
+    if (_pUploadStream)
+    {
+        _pUploadStream->service();
+        if (_pUploadStream->isBusy())
+            return 0;
+    }
+
     // Check if we need to call API
     uint32_t respLen = 0;
     if (!_endpointCalled)
-    {
-        // Call endpoint
-        if (_endpoint.restApiFn)
-            _endpoint.restApiFn(_requestStr, _respStr, _apiSourceInfo);
+        callEndpoint();
 
-        // Endpoint done
-        _endpointCalled = true;
-    }
+    // Streamed or compressed response
+    if (_isRespChunked)
+        return getChunkedResponseNext(pBuf, bufMaxLen);
 
     // Check how much of buffer to send
-    uint32_t respRemain = _respStr.length() - _respStrPos;
+    const String& respStr = getRespStr();
+    uint32_t respRemain = respStr.length() - _respStrPos;
     respLen = bufMaxLen > respRemain ? respRemain : bufMaxLen;
 
     // Prep buffer
-    pBuf = (uint8_t*) (_respStr.c_str() + _respStrPos);
+    pBuf = (uint8_t*) (respStr.c_str() + _respStrPos);
 
 #ifdef DEBUG_RESPONDER_API_START_END
     LOG_I(MODULE_PREFIX, "getResponseNext API totalLen %d sending %d fromPos %d URL %s",
-                _respStr.length(), respLen, _respStrPos, _requestStr.c_str());
+                respStr.length(), respLen, _respStrPos, _requestStr.c_str());
 #endif
 
     // Update position
     _respStrPos += respLen;
-    if (_respStrPos >= _respStr.length())
+    if (_respStrPos >= respStr.length())
     {
         _connStatus = CONN_INACTIVE;
 #ifdef DEBUG_RESPONDER_API_START_END
@@ -213,6 +334,29 @@ bool RaftWebResponderRestAPI::readyToReceiveData()
     LOG_I(MODULE_PREFIX, "readyToReceiveData time %d", _lastFileReqMs);
 #endif
 
+    // No more data is needed while waiting for a deferred response (this also keeps the
+    // connection's idle timeout from expiring - the deferred timeout applies instead)
+    if (_deferredHandle)
+        return false;
+
+    // Continue paused body decoding (compressed data can expand many times over) - no more
+    // data is received until the data held by the decoder has been decoded
+    if (_pBodyDecoder && _pBodyDecoder->isPaused())
+    {
+        if (_pUploadStream)
+            _pUploadStream->service();
+        bodyDecodeResult(_pBodyDecoder->resume(_bodyDecodeCB));
+        if (_pBodyDecoder->isPaused())
+            return false;
+    }
+
+    // Pipelined uploads only apply backpressure when all upload buffers are full
+    if (_pUploadStream)
+    {
+        _pUploadStream->service();
+        return _pUploadStream->canAccept();
+    }
+
     // Check if endpoint specifies a ready function
     if (_endpoint.restApiFnIsReady)
         return _endpoint.restApiFnIsReady(_apiSourceInfo);
@@ -237,9 +381,13 @@ RaftRetCode RaftWebResponderRestAPI::multipartOnData(void* pCtx, const uint8_t *
     LOG_W(MODULE_PREFIX, "multipartData len %d filename %s contentPos %d isFinal %d", 
                 bufLen, formInfo._fileName.c_str(), contentPos, isFinalPart);
 #endif
+    // Pipelined upload
+    if (_pUploadStream)
+        return _pUploadStream->addData(pBuf, bufLen, formInfo, contentPos, isFinalPart);
+
     // Upload info
     FileStreamBlock fileStreamBlock(formInfo._fileName.c_str(), 
-                    _headerExtract.contentLength, contentPos, 
+                    _bodyTotalLen, contentPos, 
                     pBuf, bufLen, isFinalPart, formInfo._crc16, formInfo._crc16Valid,
                     formInfo._fileLenBytes, formInfo._fileLenValid, contentPos==0);
     // Check for callback
@@ -261,19 +409,455 @@ void RaftWebResponderRestAPI::multipartOnHeaderNameValue(void* pCtx, const Strin
 
 int RaftWebResponderRestAPI::getContentLength()
 {
+    // Streaming endpoints always respond chunked (the endpoint isn't called until the body is received)
+    if (_endpoint.restApiFnStream)
+    {
+        if (!_isRespChunked)
+            addHeader("Transfer-Encoding", "chunked");
+        _isRespChunked = true;
+        return -1;
+    }
+
     // Check we are getting data
     if (_headerExtract.method != WEB_METHOD_GET)
         return -1;
 
     // Get length by calling API
     if (!_endpointCalled)
+        callEndpoint();
+
+    // Length isn't known if the response is compressed
+    if (_pRespCompressor || respCompressSetup())
+        return -1;
+    return getRespStr().length();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Call endpoint (a failed raw upload is reported without calling the endpoint)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebResponderRestAPI::callEndpoint()
+{
+    if (_pUploadStream && (_pUploadStream->getResult() != RAFT_OK) && (_uploadError.length() == 0))
+        _uploadError = "uploadFailed";
+    if (_uploadError.length() > 0)
+        Raft::setJsonResult(_requestStr.c_str(), _respStr, false, _uploadError.c_str());
+    else if (_endpoint.restApiFnStream)
+    {
+        RaftRetCode retCode = _endpoint.restApiFnStream(_requestStr, _respGenerator, _apiSourceInfo);
+        if ((retCode != RAFT_OK) || !_respGenerator)
+        {
+            _respGenerator = nullptr;
+            Raft::setJsonResult(_requestStr.c_str(), _respStr, false, "streamFailed");
+        }
+    }
+    else if (_endpoint.restApiFnDeferred)
+    {
+        // Identical requests already in progress are joined rather than calling the endpoint again
+        _deferredStartMs = millis();
+        if (!deferredJoin())
+        {
+            RaftRetCode retCode = _endpoint.restApiFnDeferred(_requestStr, _deferredHandle, _apiSourceInfo);
+            if (retCode != RAFT_OK)
+            {
+                _deferredHandle->abandon();
+                _deferredHandle.reset();
+                Raft::setJsonResult(_requestStr.c_str(), _respStr, false, "deferFailed");
+            }
+        }
+    }
+    else if (respCacheLookup())
     {
-        // Call endpoint
-        if (_endpoint.restApiFn)
-            _endpoint.restApiFn(_requestStr, _respStr, _apiSourceInfo);
+        // Response is sent from the cache
+    }
+    else if (_isDeferred && _endpoint.restApiFn)
+    {
+        // Run on worker pool (unless joining an identical request in progress) - rejected if the queue is full
+        _deferredStartMs = millis();
+        if (!deferredJoin() && 
+                !RaftWebWorkerPool::queueJob(_endpoint.restApiFn, _requestStr, _apiSourceInfo, _deferredHandle))
+        {
+            _deferredHandle->abandon();
+            _deferredHandle.reset();
+            _respStatus = HTTP_STATUS_SERVICEUNAVAILABLE;
+            addHeader("Retry-After", "1");
+            Raft::setJsonResult(_requestStr.c_str(), _respStr, false, "busy");
+        }
+    }
+    else if (_endpoint.restApiFn)
+    {
+        _endpoint.restApiFn(_requestStr, _respStr, _apiSourceInfo);
+        respCacheStore();
+    }
+    _endpointCalled = true;
 
-        // Endpoint done
-        _endpointCalled = true;
+    // Deferred responses invalidate the cache when they complete
+    if (!_deferredHandle)
+        respCacheInvalidate();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Check if headers can be sent - for deferred responses this is once the response is complete (or timed out)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebResponderRestAPI::isHeaderReady()
+{
+    if (!_isDeferred)
+        return true;
+
+    // The endpoint is called once the request body has been received
+    if (_numBytesReceived != _headerExtract.contentLength)
+        return false;
+    if (!_endpointCalled)
+        callEndpoint();
+    return !isDeferredPending();
+}
+
+bool RaftWebResponderRestAPI::getResponseStatus(RaftHttpStatusCode& status)
+{
+    if (!_isDeferred && (_respStatus == HTTP_STATUS_OK))
+        return false;
+    status = _respStatus;
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Check if a deferred response is still pending (collects the response when complete)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebResponderRestAPI::isDeferredPending()
+{
+    if (!_deferredHandle)
+        return false;
+
+    // Check for timeout (completion may race with this so abandon only succeeds if still pending)
+    if (!_deferredHandle->getResult(_pSharedResp, _respStatus))
+    {
+        if (!Raft::isTimeout(millis(), _deferredStartMs, _deferredTimeoutMs))
+            return true;
+        if (_deferredHandle->abandon())
+        {
+            _respStatus = HTTP_STATUS_GATEWAYTIMEOUT;
+            Raft::setJsonResult(_requestStr.c_str(), _respStr, false, "timeout");
+#ifdef WARN_ON_DEFERRED_TIMEOUT
+            LOG_W(MODULE_PREFIX, "isDeferredPending timeout after %dms URL %s", 
+                        _deferredTimeoutMs, _requestStr.c_str());
+#endif
+        }
+        else
+        {
+            _deferredHandle->getResult(_pSharedResp, _respStatus);
+        }
     }
-    return _respStr.length();
+#ifdef DEBUG_RESPONDER_DEFERRED
+    LOG_I(MODULE_PREFIX, "isDeferredPending done status %d after %dms len %d", 
+                _respStatus, (int)Raft::timeElapsed(millis(), _deferredStartMs), getRespStr().length());
+#endif
+    _deferredHandle.reset();
+
+    // Responses from the worker pool can be cached
+    if (_respStatus == HTTP_STATUS_OK)
+        respCacheStore();
+    respCacheInvalidate();
+    return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Get the completion handle for a deferred response - GET requests join an identical request in progress
+// (returns true if joined in which case the endpoint must not be called)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebResponderRestAPI::deferredJoin()
+{
+    if ((_headerExtract.method != WEB_METHOD_GET) || (_uploadError.length() > 0))
+    {
+        _deferredHandle = std::make_shared<RaftWebDeferredResponse>();
+        return false;
+    }
+    bool isLeader = true;
+    _deferredHandle = RaftWebSingleFlight::join(_requestStr, isLeader);
+#ifdef DEBUG_RESPONDER_DEFERRED
+    if (!isLeader)
+        LOG_I(MODULE_PREFIX, "deferredJoin joined request in progress %s", _requestStr.c_str());
+#endif
+    return !isLeader;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Response cache - GET responses of endpoints with a cache TTL are shared from the cache
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebResponderRestAPI::isRespCacheable() const
+{
+    return (_endpoint.cacheTtlMs > 0) && (_headerExtract.method == WEB_METHOD_GET) && 
+                RaftWebRespCache::isEnabled() && (_uploadError.length() == 0);
+}
+
+bool RaftWebResponderRestAPI::respCacheLookup()
+{
+    if (!isRespCacheable())
+        return false;
+    RaftWebRespCache::CachedResp cachedResp;
+    if (!RaftWebRespCache::lookup(_requestStr, cachedResp))
+        return false;
+    _pSharedResp = cachedResp.pBody;
+    respCacheHeaders(cachedResp);
+    return true;
+}
+
+void RaftWebResponderRestAPI::respCacheStore()
+{
+    if (!isRespCacheable())
+        return;
+
+    // The response is sent from the cached copy
+    if (!_pSharedResp)
+        _pSharedResp = std::make_shared<const String>(std::move(_respStr));
+    RaftWebRespCache::CachedResp cachedResp;
+    RaftWebRespCache::store(_requestStr, _pSharedResp, _endpoint.cacheTtlMs, cachedResp);
+    _pSharedResp = cachedResp.pBody;
+    _respStr.clear();
+    respCacheHeaders(cachedResp);
+}
+
+void RaftWebResponderRestAPI::respCacheInvalidate()
+{
+    // Requests other than GET may change what an endpoint returns so once the endpoint has run
+    // its cached responses are dropped
+    if ((_headerExtract.method != WEB_METHOD_GET) && RaftWebRespCache::isEnabled())
+        RaftWebRespCache::invalidate(RaftWebInterface::getEndpointName(_requestStr).c_str());
+}
+
+void RaftWebResponderRestAPI::respCacheHeaders(const RaftWebRespCache::CachedResp& cachedResp)
+{
+    addHeader("ETag", cachedResp.etag);
+    addHeader("Cache-Control", "max-age=" + String(cachedResp.remainingMs / 1000));
+
+    // Client already has this response
+    if ((_headerExtract.ifNoneMatch.length() > 0) && (_headerExtract.ifNoneMatch.indexOf(cachedResp.etag) >= 0))
+    {
+        _respStatus = HTTP_STATUS_NOTMODIFIED;
+        _pSharedResp.reset();
+        _respStr.clear();
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Setup response compression if enabled for the endpoint, accepted by the client and the response is large
+// enough - returns true if the response will be compressed
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebResponderRestAPI::respCompressSetup()
+{
+    // Check compression enabled
+    int level = _endpoint.compressLevel < 0 ? _respCompressLevel : _endpoint.compressLevel;
+    if ((_respCompressMinBytes == 0) || (level <= 0))
+        return false;
+
+    // The response depends on Accept-Encoding whether or not this one is compressed (for caches)
+    addHeader("Vary", "Accept-Encoding");
+    if ((getRespStr().length() < _respCompressMinBytes) || !(_headerExtract.acceptsGzip || _headerExtract.acceptsDeflate))
+        return false;
+
+    // Setup compressor (gzip preferred)
+    _pRespCompressor = new RaftWebDeflate();
+    if (!_pRespCompressor->setup(_headerExtract.acceptsGzip, level))
+    {
+        delete _pRespCompressor;
+        _pRespCompressor = nullptr;
+        return false;
+    }
+    addHeader("Content-Encoding", _pRespCompressor->getEncodingName());
+    addHeader("Transfer-Encoding", "chunked");
+    _isRespChunked = true;
+
+#ifdef DEBUG_RESPONDER_COMPRESS
+    LOG_I(MODULE_PREFIX, "respCompressSetup %s level %d len %d URL %s", 
+                _pRespCompressor->getEncodingName(), level, getRespStr().length(), _requestStr.c_str());
+#endif
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Get next part of chunked response (from the generator, compressor or response string) - each chunk is framed
+// as <hex size>\r\n<data>\r\n and the response ends with a zero size chunk
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebResponderRestAPI::getChunkedResponseNext(uint8_t*& pBuf, uint32_t bufMaxLen)
+{
+    static const uint32_t CHUNK_HEADER_BYTES = 8;
+    static const char CHUNK_TRAILER[] = "\r\n";
+    static const char LAST_CHUNK[] = "0\r\n\r\n";
+    static const uint32_t CHUNK_OVERHEAD_BYTES = CHUNK_HEADER_BYTES + sizeof(CHUNK_TRAILER) - 1 + sizeof(LAST_CHUNK) - 1;
+    if (bufMaxLen > RESP_CHUNK_MAX_BYTES)
+        bufMaxLen = RESP_CHUNK_MAX_BYTES;
+    if (bufMaxLen < CHUNK_OVERHEAD_BYTES + RaftWebDeflate::MIN_OUT_BYTES)
+        return 0;
+
+    // Get data into the buffer leaving space for the chunk header
+    _respChunkBuf.resize(bufMaxLen);
+    uint8_t* pChunk = _respChunkBuf.data();
+    uint8_t* pData = pChunk + CHUNK_HEADER_BYTES;
+    uint32_t dataMaxLen = bufMaxLen - CHUNK_OVERHEAD_BYTES;
+    uint32_t dataLen = 0;
+    bool isFinal = false;
+    const String& respStr = getRespStr();
+    if (_pRespCompressor)
+    {
+        dataLen = _pRespCompressor->compress((const uint8_t*)respStr.c_str(), respStr.length(), pData, dataMaxLen);
+        isFinal = _pRespCompressor->isDone();
+    }
+    else if (_respGenerator)
+    {
+        dataLen = _respGenerator(pData, dataMaxLen, isFinal);
+        if (dataLen > dataMaxLen)
+            dataLen = dataMaxLen;
+    }
+    else
+    {
+        uint32_t respRemain = respStr.length() - _respStrPos;
+        dataLen = respRemain < dataMaxLen ? respRemain : dataMaxLen;
+        memcpy(pData, respStr.c_str() + _respStrPos, dataLen);
+        _respStrPos += dataLen;
+        isFinal = _respStrPos >= respStr.length();
+    }
+
+    // Frame chunk (fixed width hex size so the header length is known in advance)
+    uint32_t chunkLen = 0;
+    if (dataLen > 0)
+    {
+        char chunkHeader[CHUNK_HEADER_BYTES + 1];
+        snprintf(chunkHeader, sizeof(chunkHeader), "%06X\r\n", (unsigned)dataLen);
+        memcpy(pChunk, chunkHeader, CHUNK_HEADER_BYTES);
+        chunkLen = CHUNK_HEADER_BYTES + dataLen;
+        memcpy(pChunk + chunkLen, CHUNK_TRAILER, sizeof(CHUNK_TRAILER) - 1);
+        chunkLen += sizeof(CHUNK_TRAILER) - 1;
+    }
+
+    // Check for end of response
+    if (isFinal)
+    {
+        memcpy(pChunk + chunkLen, LAST_CHUNK, sizeof(LAST_CHUNK) - 1);
+        chunkLen += sizeof(LAST_CHUNK) - 1;
+        _connStatus = CONN_INACTIVE;
+#ifdef DEBUG_RESPONDER_CHUNKED
+        LOG_I(MODULE_PREFIX, "getChunkedResponseNext done URL %s", _requestStr.c_str());
+#endif
+    }
+
+    // Chunk may be empty if a generator has nothing ready yet
+    if (chunkLen == 0)
+        return 0;
+    pBuf = pChunk;
+    return chunkLen;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Raw upload setup
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebResponderRestAPI::rawUploadSetup()
+{
+    // Raw upload requires a chunk handler and an octet-stream PUT/POST body
+    if (!_endpoint.restApiFnChunk || (_headerExtract.contentLength == 0) ||
+            ((_headerExtract.method != WEB_METHOD_POST) && (_headerExtract.method != WEB_METHOD_PUT)) ||
+            !_headerExtract.contentType.equalsIgnoreCase("application/octet-stream"))
+        return;
+    _isRawUpload = true;
+
+    // File info from headers
+    _rawUploadInfo._fileName = _headerExtract.fileName;
+    _rawUploadInfo._crc16 = _headerExtract.crc16;
+    _rawUploadInfo._crc16Valid = _headerExtract.crc16Valid;
+    _rawUploadInfo._fileLenBytes = _headerExtract.fileLenValid ? _headerExtract.fileLenBytes : _bodyTotalLen;
+    _rawUploadInfo._fileLenValid = _headerExtract.fileLenValid || _bodyTotalLenValid;
+    String md5Str = _headerExtract.contentMD5;
+
+    // Query params override headers
+    int paramsPos = _requestStr.indexOf('?');
+    if (paramsPos >= 0)
+    {
+        std::vector<RaftJson::NameValuePair> nameValues;
+        RaftJson::extractNameValues(_requestStr.substring(paramsPos + 1), "=", "&", NULL, nameValues);
+        for (RaftJson::NameValuePair& nvp : nameValues)
+        {
+            if (nvp.name.equalsIgnoreCase("filename"))
+            {
+                _rawUploadInfo._fileName = nvp.value;
+            }
+            else if (nvp.name.equalsIgnoreCase("crc16"))
+            {
+                _rawUploadInfo._crc16 = strtoul(nvp.value.c_str(), NULL, 0);
+                _rawUploadInfo._crc16Valid = true;
+            }
+            else if (nvp.name.equalsIgnoreCase("fileLen"))
+            {
+                _rawUploadInfo._fileLenBytes = strtoul(nvp.value.c_str(), NULL, 0);
+                _rawUploadInfo._fileLenValid = true;
+            }
+            else if (nvp.name.equalsIgnoreCase("md5"))
+            {
+                md5Str = nvp.value;
+            }
+        }
+    }
+
+    // MD5 verification
+    if ((md5Str.length() > 0) && !_rawUploadMD5.setExpected(md5Str))
+        _uploadError = "invalidMD5";
+
+#ifdef DEBUG_RESPONDER_RAW_UPLOAD
+    LOG_I(MODULE_PREFIX, "rawUploadSetup filename %s contentLen %d fileLen %d crc16 %04x valid %d md5 %s",
+                _rawUploadInfo._fileName.c_str(), _headerExtract.contentLength, _rawUploadInfo._fileLenBytes,
+                _rawUploadInfo._crc16, _rawUploadInfo._crc16Valid, _rawUploadMD5.isActive() ? "Y" : "N");
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Raw upload data - passed straight to the chunk callback as file stream blocks
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebResponderRestAPI::rawUploadOnData(const uint8_t* pBuf, uint32_t dataLen, uint32_t contentPos, bool isFinalBlock)
+{
+    // Once failed the remainder of the body is discarded
+    if (_uploadError.length() > 0)
+        return;
+
+    // Verify MD5 before passing on the final block so that a corrupt upload is never completed
+    _rawUploadMD5.update(pBuf, dataLen);
+    if (isFinalBlock && !_rawUploadMD5.finishAndVerify())
+    {
+        _uploadError = "md5Mismatch";
+#ifdef WARN_ON_RAW_UPLOAD_FAIL
+        LOG_W(MODULE_PREFIX, "rawUploadOnData filename %s MD5 mismatch", _rawUploadInfo._fileName.c_str());
+#endif
+        return;
+    }
+
+    // Pipelined upload
+    if (_pUploadStream)
+    {
+        if (_pUploadStream->addData(pBuf, dataLen, _rawUploadInfo, contentPos, isFinalBlock) != RAFT_OK)
+            _uploadError = "uploadFailed";
+        return;
+    }
+
+    // Send block
+    FileStreamBlock fileStreamBlock(_rawUploadInfo._fileName.c_str(),
+                    _bodyTotalLen, contentPos,
+                    pBuf, dataLen, isFinalBlock, _rawUploadInfo._crc16, _rawUploadInfo._crc16Valid,
+                    _rawUploadInfo._fileLenBytes, _rawUploadInfo._fileLenValid, contentPos == 0);
+    RaftRetCode retCode = _endpoint.restApiFnChunk(_requestStr, fileStreamBlock, _apiSourceInfo);
+    if (retCode != RAFT_OK)
+    {
+        _uploadError = "chunkFailed";
+#ifdef WARN_ON_RAW_UPLOAD_FAIL
+        LOG_W(MODULE_PREFIX, "rawUploadOnData filename %s pos %d failed retc %d",
+                    _rawUploadInfo._fileName.c_str(), contentPos, retCode);
+#endif
+    }
+
+#ifdef DEBUG_RESPONDER_RAW_UPLOAD
+    LOG_I(MODULE_PREFIX, "rawUploadOnData pos %d len %d final %d retc %d", contentPos, dataLen, isFinalBlock, retCode);
+#endif
 }
@@ -16,6 +16,15 @@
 #include "RaftWebRequestParams.h"
 #include "RaftWebConnection.h"
 #include "RaftWebMultipart.h"
+#include "RaftWebMD5.h"
+#include "RaftWebUploadPipeline.h"
+#include "RaftWebBodyDecoder.h"
+#include "RaftWebDeflate.h"
+#include "RaftWebServerSettings.h"
+#include "RaftWebDeferred.h"
+#include "RaftWebWorkerPool.h"
+#include "RaftWebRespCache.h"
+#include "RaftWebSingleFlight.h"
 #include "APISourceInfo.h"
 
 // #define APPLY_MIN_GAP_BETWEEN_API_CALLS_MS 200
@@ -28,7 +37,7 @@ public:
     RaftWebResponderRestAPI(const RaftWebServerRestEndpoint& endpoint, RaftWebHandler* pWebHandler, 
                         const RaftWebRequestParams& params, String& reqStr, 
                         const RaftWebRequestHeaderExtract& headerExtract,
-                        uint32_t channelID);
+                        const RaftWebServerSettings& webServerSettings);
     virtual ~RaftWebResponderRestAPI();
 
     // Handle inbound data
@@ -58,6 +67,12 @@ public:
     // Ready to receive data
     virtual bool readyToReceiveData() override final;
 
+    // Check if headers can be sent (deferred responses hold them back until complete)
+    virtual bool isHeaderReady() override final;
+
+    // Get response status (set by deferred responses)
+    virtual bool getResponseStatus(RaftHttpStatusCode& status) override final;
+
 private:
     // Endpoint
     RaftWebServerRestEndpoint _endpoint;
@@ -76,15 +91,60 @@ private:
     String _requestStr;
     String _respStr;
     uint32_t _respStrPos;
+
+    // Response shared from the cache (sent instead of _respStr when set)
+    std::shared_ptr<const String> _pSharedResp;
+    const String& getRespStr() const
+    {
+        return _pSharedResp ? *_pSharedResp : _respStr;
+    }
     uint32_t _sendStartMs;
     static const uint32_t SEND_DATA_OVERALL_TIMEOUT_MS = 1 * 60 * 1000;
 
     // Data received
     uint32_t _numBytesReceived;
 
+    // Decoder for bodies with Content-Encoding gzip/deflate - everything after the decoder sees
+    // decoded data, positions and totals (the total is only known if the client supplies it)
+    RaftWebBodyDecoder* _pBodyDecoder = nullptr;
+    RaftWebBodyDecodeCB _bodyDecodeCB;
+    uint32_t _bodyDecodedPos = 0;
+    uint32_t _bodyTotalLen = 0;
+    bool _bodyTotalLenValid = true;
+
     // Multipart parser
     RaftWebMultipart _multipartParser;
 
+    // Raw (application/octet-stream) upload - body is streamed to the chunk callback
+    // without multipart framing, file info comes from query params or headers
+    bool _isRawUpload = false;
+    RaftMultipartForm _rawUploadInfo;
+    RaftWebMD5 _rawUploadMD5;
+
+    // Upload stream when pipelined uploads are enabled (chunks are written by the pipeline's writer task)
+    RaftWebUploadStream* _pUploadStream = nullptr;
+    String _uploadError;
+
+    // Chunked responses (streamed or compressed) - framed in this buffer
+    bool _isRespChunked = false;
+    std::vector<uint8_t> _respChunkBuf;
+    static const uint32_t RESP_CHUNK_MAX_BYTES = 4096;
+
+    // Streaming response generator
+    RaftWebRespGenerator _respGenerator = nullptr;
+
+    // Deferred response (deferred endpoints and endpoints run on the worker pool)
+    bool _isDeferred = false;
+    RaftWebDeferredHandle _deferredHandle;
+    uint32_t _deferredStartMs = 0;
+    uint32_t _deferredTimeoutMs = 0;
+    RaftHttpStatusCode _respStatus = HTTP_STATUS_OK;
+
+    // Response compression - the compressed length isn't known up front so it is sent chunked
+    uint32_t _respCompressMinBytes = 0;
+    uint32_t _respCompressLevel = 0;
+    RaftWebDeflate* _pRespCompressor = nullptr;
+
     // API source
     APISourceInfo _apiSourceInfo;
 
@@ -98,4 +158,19 @@ private:
     RaftRetCode multipartOnData(void* pCtx, const uint8_t *pBuf, uint32_t len, RaftMultipartForm& formInfo, 
                 uint32_t contentPos, bool isFinalPart);
     void multipartOnHeaderNameValue(void* pCtx, const String& name, const String& val);
+    void rawUploadSetup();
+    void rawUploadOnData(const uint8_t* pBuf, uint32_t dataLen, uint32_t contentPos, bool isFinalBlock);
+    void handleBodyData(const uint8_t* pBuf, uint32_t dataLen, uint32_t bodyPos, bool isFinal);
+    bool bodyDecodedData(const uint8_t* pBuf, uint32_t dataLen);
+    void bodyDecodeResult(RaftRetCode retc);
+    void callEndpoint();
+    bool isDeferredPending();
+    bool deferredJoin();
+    bool isRespCacheable() const;
+    bool respCacheLookup();
+    void respCacheStore();
+    void respCacheInvalidate();
+    void respCacheHeaders(const RaftWebRespCache::CachedResp& cachedResp);
+    bool respCompressSetup();
+    uint32_t getChunkedResponseNext(uint8_t*& pBuf, uint32_t bufMaxLen);
 };
@@ -14,9 +14,8 @@
 #include "RaftWebConnDefs.h"
 
 // #define DEBUG_RESPONDER_EVENTS
-#define WARN_EVENTS_SEND_APP_DATA_FAIL
 
-#if defined(DEBUG_RESPONDER_EVENTS) || defined(WARN_EVENTS_SEND_APP_DATA_FAIL)
+#if defined(DEBUG_RESPONDER_EVENTS)
 static const char *MODULE_PREFIX = "RaftWebRespSSEvents";
 #endif
 
@@ -26,45 +25,25 @@ static const char *MODULE_PREFIX = "RaftWebRespSSEvents";
 
 RaftWebResponderSSEvents::RaftWebResponderSSEvents(RaftWebHandler *pWebHandler, const RaftWebRequestParams &params,
                                                const String &reqStr, RaftWebSSEventsCB eventsCallback,
+                                               RaftWebSSEventRing& eventRing, uint32_t startCursor,
+                                               uint32_t groupMask, uint32_t maxEventsPerSec,
                                                const RaftWebServerSettings &webServerSettings)
-    : _reqParams(params), _eventsCB(eventsCallback)
+    : _reqParams(params), _eventsCB(eventsCallback), _eventRing(eventRing)
 {
     // Store socket info
     _pWebHandler = pWebHandler;
     _requestStr = reqStr;
     _isInitialResponse = true;
-    _txQueue.setMaxLen(EVENT_TX_QUEUE_SIZE);
+    _eventCursor = startCursor;
+    _groupMask = groupMask;
+    if (maxEventsPerSec > 0)
+        _minEventIntervalMs = 1000 / maxEventsPerSec;
 }
 
 RaftWebResponderSSEvents::~RaftWebResponderSSEvents()
 {
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Service - called frequently
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-void RaftWebResponderSSEvents::loop()
-{
-    // Check for data waiting to be sent
-    RaftWebSSEvent event;
-    if (_txQueue.get(event))
-    {
-#ifdef DEBUG_RESPONDER_EVENTS
-        LOG_W(MODULE_PREFIX, "loop sendMsg group %s content %s", event.getGroup().c_str(), event.getContent().c_str());
-#endif
-        // Format message
-        String outMsg = generateEventMessage(event.getContent(), event.getGroup(), time(NULL));
-        RaftWebConnSendFn rawSendFn = _reqParams.getWebConnRawSend();
-        if (rawSendFn)
-        {
-            bool rslt = rawSendFn((const uint8_t*)outMsg.c_str(), outMsg.length(), MAX_SSEVENT_SEND_RETRY_MS) == RaftWebConnSendRetVal::WEB_CONN_SEND_OK;
-            if (!rslt)
-                _connStatus = CONN_INACTIVE;
-        }
-    }
-}
-
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Handle inbound data
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -87,9 +66,10 @@ bool RaftWebResponderSSEvents::startResponding(RaftWebConnection &request)
     // Now active
     _connStatus = CONN_ACTIVE;
 #ifdef DEBUG_RESPONDER_EVENTS
-    LOG_I(MODULE_PREFIX, "startResponding isActive %d", _isActive);
+    LOG_I(MODULE_PREFIX, "startResponding cursor %d groupMask %08x minIntervalMs %d", 
+                _eventCursor, _groupMask, _minEventIntervalMs);
 #endif
-    return _isActive;
+    return true;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -98,23 +78,22 @@ bool RaftWebResponderSSEvents::startResponding(RaftWebConnection &request)
 
 bool RaftWebResponderSSEvents::responseAvailable()
 {
-    // TODO - review this
-    return _isActive && _isInitialResponse;
+    if (_connStatus != CONN_ACTIVE)
+        return false;
+    return _isInitialResponse || (_pTxEvent && (_txEventPos < _pTxEvent->getLen())) || 
+                (_eventRing.isEventAvailable(_eventCursor) && !isRateLimited());
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Get response next
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-uint32_t RaftWebResponderSSEvents::getResponseNext(uint8_t *pBuf, uint32_t bufMaxLen)
+uint32_t RaftWebResponderSSEvents::getResponseNext(uint8_t*& pBuf, uint32_t bufMaxLen)
 {
-    uint32_t respLen = 0;
-
     // Check if initial response
     if (_isInitialResponse)
     {
-        // Response for snprintf
-        const char SSEVENT_RESPONSE[] =
+        static const char SSEVENT_RESPONSE[] =
             "HTTP/1.1 200 OK\r\n"
             "Content-Type: text/event-stream\r\n"
             "Access-Control-Allow-Origin: *\r\n"
@@ -122,31 +101,37 @@ uint32_t RaftWebResponderSSEvents::getResponseNext(uint8_t *pBuf, uint32_t bufMa
             "Connection: keep-alive\r\n"
             "Accept-Ranges: none\r\n\r\n";
 
-        // Reponse string
-        snprintf((char *)pBuf, bufMaxLen, SSEVENT_RESPONSE);
-
         // Response done
         _isInitialResponse = false;
 
         // Debug
 #ifdef DEBUG_RESPONDER_EVENTS
-        LOG_I(MODULE_PREFIX, "getResponseNext isActive %d resp %s", _isActive, (char *)pBuf);
+        LOG_I(MODULE_PREFIX, "getResponseNext initial response cursor %d", _eventCursor);
 #endif
+        pBuf = (uint8_t*)SSEVENT_RESPONSE;
+        return sizeof(SSEVENT_RESPONSE) - 1;
+    }
 
-        // Return
-        return strnlen((char *)pBuf, bufMaxLen);
+    // Get the next event (in the groups wanted) from the ring when the previous one has been sent
+    if (!_pTxEvent || (_txEventPos >= _pTxEvent->getLen()))
+    {
+        _pTxEvent.reset();
+        if (isRateLimited() || !_eventRing.getEvent(_eventCursor, _pTxEvent, _groupMask, _minEventIntervalMs > 0))
+            return 0;
+        _txEventPos = 0;
+        _lastEventMs = millis();
     }
 
-    // TODO - review this
-    // // Get
-    // uint32_t respLen = _webSocketLink.getTxData(pBuf, bufMaxLen);
+    // Send as much of the encoded event as fits (directly from the shared event)
+    uint32_t respLen = _pTxEvent->getLen() - _txEventPos;
+    if (respLen > bufMaxLen)
+        respLen = bufMaxLen;
+    pBuf = (uint8_t*)_pTxEvent->getData() + _txEventPos;
+    _txEventPos += respLen;
 
-    // Done response
+    // Debug
 #ifdef DEBUG_RESPONDER_EVENTS
-    if (respLen > 0)
-    {
-        LOG_I(MODULE_PREFIX, "getResponseNext respLen %d isActive %d", respLen, _isActive);
-    }
+    LOG_I(MODULE_PREFIX, "getResponseNext respLen %d cursor %d", respLen, _eventCursor);
 #endif
     return respLen;
 }
@@ -157,7 +142,7 @@ uint32_t RaftWebResponderSSEvents::getResponseNext(uint8_t *pBuf, uint32_t bufMa
 
 const char *RaftWebResponderSSEvents::getContentType()
 {
-    return "application/octet-stream";
+    return "text/event-stream";
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -168,125 +153,3 @@ bool RaftWebResponderSSEvents::leaveConnOpen()
 {
     return true;
 }
-
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Send event content and group
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-void RaftWebResponderSSEvents::sendEvent(const char* eventContent, const char* eventGroup)
-{
-    // Add to queue - don't block if full
-    RaftWebSSEvent event(eventContent, eventGroup);
-    bool putRslt = _txQueue.put(event);
-    if (!putRslt)
-    {
-#ifdef WARN_EVENTS_SEND_APP_DATA_FAIL
-        LOG_W(MODULE_PREFIX, "sendEvent failed group %s content %s", eventGroup, eventContent);
-#endif
-    }
-    else
-    {
-#ifdef DEBUG_RESPONDER_EVENTS
-        LOG_W(MODULE_PREFIX, "sendEvent ok group %s content %s", eventGroup, eventContent);
-#endif
-    }
-}
-
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Send a frame of data
-// From ESPAsyncWebServer
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-String RaftWebResponderSSEvents::generateEventMessage(const String& msgStr, const String& eventStr, uint32_t id)
-{
-    String ev = "";
-
-    if (id)
-    {
-        ev += "id: ";
-        ev += String(id);
-        ev += "\r\n";
-    }
-
-    if (pEvent != NULL)
-    {
-        ev += "event: ";
-        ev += String(pEvent);
-        ev += "\r\n";
-    }
-
-    char* pMsg = msgStr.c_str();
-    size_t messageLen = msgStr.length();
-    char *lineStart = pMsg;
-    char *lineEnd;
-    do
-    {
-        char *nextN = strchr(lineStart, '\n');
-        char *nextR = strchr(lineStart, '\r');
-        if (nextN == NULL && nextR == NULL)
-        {
-            size_t llen = (pMsg + messageLen) - lineStart;
-            char *ldata = (char*)malloc(llen + 1);
-            if (ldata != NULL)
-            {
-                memcpy(ldata, lineStart, llen);
-                ldata[llen] = 0;
-                ev += "data: ";
-                ev += ldata;
-                ev += "\r\n\r\n";
-                free(ldata);
-            }
-            lineStart = pMsg + messageLen;
-        }
-        else
-        {
-            char *nextLine = NULL;
-            if (nextN != NULL && nextR != NULL)
-            {
-                if (nextR < nextN)
-                {
-                    lineEnd = nextR;
-                    if (nextN == (nextR + 1))
-                        nextLine = nextN + 1;
-                    else
-                        nextLine = nextR + 1;
-                }
-                else
-                {
-                    lineEnd = nextN;
-                    if (nextR == (nextN + 1))
-                        nextLine = nextR + 1;
-                    else
-                        nextLine = nextN + 1;
-                }
-            }
-            else if (nextN != NULL)
-            {
-                lineEnd = nextN;
-                nextLine = nextN + 1;
-            }
-            else
-            {
-                lineEnd = nextR;
-                nextLine = nextR + 1;
-            }
-
-            size_t llen = lineEnd - lineStart;
-            char *ldata = (char *)malloc(llen + 1);
-            if (ldata != NULL)
-            {
-                memcpy(ldata, lineStart, llen);
-                ldata[llen] = 0;
-                ev += "data: ";
-                ev += ldata;
-                ev += "\r\n";
-                free(ldata);
-            }
-            lineStart = nextLine;
-            if (lineStart == (pMsg + messageLen))
-                ev += "\r\n";
-        }
-    } while (lineStart < (pMsg + messageLen));
-
-    return ev;
-}
@@ -14,8 +14,9 @@
 #include "RaftWebRequestParams.h"
 #include "RaftWebConnection.h"
 #include "RaftWebSocketLink.h"
-#include "RaftWebSSEvent.h"
-#include "ThreadSafeQueue.h"
+#include "RaftWebSSEventRing.h"
+#include "RaftUtils.h"
+#include "ArduinoTime.h"
 
 class RaftWebHandler;
 class RaftWebServerSettings;
@@ -29,12 +30,11 @@ class RaftWebResponderSSEvents : public RaftWebResponder
 public:
     RaftWebResponderSSEvents(RaftWebHandler* pWebHandler, const RaftWebRequestParams& params, 
                 const String& reqStr, RaftWebSSEventsCB eventsCallback, 
+                RaftWebSSEventRing& eventRing, uint32_t startCursor,
+                uint32_t groupMask, uint32_t maxEventsPerSec,
                 const RaftWebServerSettings& webServerSettings);
     virtual ~RaftWebResponderSSEvents();
 
-    // Service - called frequently
-    virtual void loop() override final;
-
     // Handle inbound data
     virtual bool handleInboundData(const uint8_t* pBuf, uint32_t dataLen) override final;
 
@@ -45,7 +45,7 @@ public:
     virtual bool responseAvailable() override final;
     
     // Get response next
-    virtual uint32_t getResponseNext(uint8_t* pBuf, uint32_t bufMaxLen) override final;
+    virtual uint32_t getResponseNext(uint8_t*& pBuf, uint32_t bufMaxLen) override final;
 
     // Get content type
     virtual const char* getContentType() override final;
@@ -59,9 +59,6 @@ public:
         return false;
     }
 
-    // Send event content and group
-    virtual void sendEvent(const char* eventContent, const char* eventGroup);
-
     // Get responder type
     virtual const char* getResponderType() override final
     {
@@ -82,13 +79,22 @@ private:
     String _requestStr;
     bool _isInitialResponse;
 
-    // Queue for sending frames over the event channel
-    static const uint32_t EVENT_TX_QUEUE_SIZE = 2;
-    ThreadSafeQueue<RaftWebSSEvent> _txQueue;
+    // Event ring (shared by all subscribers) and the id of the next event to send
+    RaftWebSSEventRing& _eventRing;
+    uint32_t _eventCursor;
+
+    // Groups wanted by the subscriber
+    uint32_t _groupMask;
 
-    // Retry
-    static const uint32_t MAX_SSEVENT_SEND_RETRY_MS = 1;
+    // Rate limit - when limited events superseded by a later event in the same group are not sent
+    uint32_t _minEventIntervalMs = 0;
+    uint32_t _lastEventMs = 0;
+    bool isRateLimited()
+    {
+        return (_minEventIntervalMs > 0) && !Raft::isTimeout(millis(), _lastEventMs, _minEventIntervalMs);
+    }
 
-    // Generate event message
-    String generateEventMessage(const String& msgStr, const String& eventStr, uint32_t id);
+    // Event being sent (shared with other subscribers) and position in its encoded form
+    std::shared_ptr<const RaftWebSSEvent> _pTxEvent;
+    uint32_t _txEventPos = 0;
 };
@@ -18,6 +18,8 @@
 #define WARN_WS_SEND_APP_DATA_FAIL
 #define WARN_WS_PACKET_TOO_BIG
 #define WARN_ON_SEND_INACTIVE
+#define WARN_WS_FRAME_POOL_EXHAUSTED
+#define WARN_WS_RX_THROTTLE_EXCEEDED
 
 // Debug
 // #define DEBUG_RESPONDER_WS
@@ -34,6 +36,7 @@
 // #define DEBUG_WEBSOCKET_CONN_STATUS
 // #define DEBUG_WEBSOCKET_RESPONSE_DETAIL
 // #define DEBUG_WS_TX_QUEUE
+// #define DEBUG_WS_RX_THROTTLE
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Constructor / Destructor
@@ -44,12 +47,12 @@ RaftWebResponderWS::RaftWebResponderWS(RaftWebHandlerWS* pWebHandler, const Raft
             RaftWebSocketInboundCanAcceptFnType inboundCanAcceptCB, 
             RaftWebSocketInboundHandleMsgFnType inboundMsgCB,
             uint32_t channelID, uint32_t packetMaxBytes, uint32_t txQueueSize,
-            uint32_t pingIntervalMs, uint32_t disconnIfNoPongMs, bool isBinary)
+            uint32_t pingIntervalMs, uint32_t disconnIfNoPongMs, bool isBinary,
+            RaftWebTxQueuePolicy txQueuePolicy, RaftWebSocketTxKeyFnType txKeyFn)
     :   _reqParams(params), _inboundCanAcceptCB(inboundCanAcceptCB), 
-        _inboundMsgCB(inboundMsgCB)
-#ifdef WEBSOCKET_SEND_USE_TX_QUEUE
-        , _txQueue(txQueueSize)
-#endif
+        _inboundMsgCB(inboundMsgCB),
+        _txQueue(txQueueSize, txQueuePolicy),
+        _txKeyFn(txKeyFn)
 {
     // Store socket info
     _pWebHandler = pWebHandler;
@@ -58,6 +61,13 @@ RaftWebResponderWS::RaftWebResponderWS(RaftWebHandlerWS* pWebHandler, const Raft
     _packetMaxBytes = packetMaxBytes;
     _isBinary = isBinary;
 
+    // Frames are queued (rather than sent directly) if a non-fifo policy is used
+#ifdef WEBSOCKET_SEND_USE_TX_QUEUE
+    _useTxQueue = true;
+#else
+    _useTxQueue = txQueuePolicy != TX_QUEUE_POLICY_FIFO;
+#endif
+
 #ifdef DEBUG_RESPONDER_WS
     // Log responder creation
     LOG_I(MODULE_PREFIX, "CREATED responder this=%p connId %d channelID %d", this, params.connId, _channelID);
@@ -66,7 +76,8 @@ RaftWebResponderWS::RaftWebResponderWS(RaftWebHandlerWS* pWebHandler, const Raft
     // Init socket link
     _webSocketLink.setup(std::bind(&RaftWebResponderWS::onWebSocketEvent, this, 
                             std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
-                params.getWebConnRawSend(), pingIntervalMs, true, disconnIfNoPongMs, isBinary);
+                params.getWebConnRawSend(), pingIntervalMs, true, disconnIfNoPongMs, isBinary,
+                params.getWebConnTimer());
 }
 
 RaftWebResponderWS::~RaftWebResponderWS()
@@ -95,12 +106,9 @@ void RaftWebResponderWS::loop()
     if (Raft::isTimeout(millis(), _debugLastServiceMs, 1000))
     {
         _debugLastServiceMs = millis();
-#ifdef WEBSOCKET_SEND_USE_TX_QUEUE
-        LOG_I(MODULE_PREFIX, "loop connStatus %d _txQueueCount %d", 
-                _connStatus, _txQueue.count());
-#else
-        LOG_I(MODULE_PREFIX, "loop connStatus %d", _connStatus);
-#endif
+        LOG_I(MODULE_PREFIX, "loop connStatus %d txQueue %s count %d dropped %d coalesced %d", 
+                _connStatus, RaftWebTxQueue::getPolicyStr(_txQueue.getPolicy()), _txQueue.count(),
+                _txQueue.getDroppedCount(), _txQueue.getCoalescedCount());
     }
 #endif
 
@@ -120,10 +128,10 @@ void RaftWebResponderWS::loop()
         return;
     }
 
-#ifdef WEBSOCKET_SEND_USE_TX_QUEUE
-    // Check for data waiting to be sent
+    // Check for data waiting to be sent - frames are only taken from the queue when the
+    // connection can accept them so that unsent frames remain subject to the queue policy
     RaftWebDataFrame frame;
-    if (_txQueue.get(frame))
+    if (_useTxQueue && isConnReadyToSend() && _txQueue.get(frame))
     {
 #ifdef DEBUG_WS_TX_QUEUE
         // Always log data being sent for debugging reconnection issues
@@ -131,10 +139,10 @@ void RaftWebResponderWS::loop()
 #endif
 
         // Send
-        RaftWebConnSendRetVal retVal = _webSocketLink.sendMsg(_webSocketLink.msgOpCodeDefault(), frame.getData(), frame.getLen());
+        RaftWebConnSendRetVal retVal = _webSocketLink.sendFrame(_webSocketLink.msgOpCodeDefault(), frame);
 
 #ifdef DEBUG_WS_SEND_APP_DATA
-        LOG_W(MODULE_PREFIX, "loop connId %d sendMsg sent len %d retc %d",
+        LOG_W(MODULE_PREFIX, "loop connId %d sendFrame sent len %d retc %d",
                     _reqParams.connId, frame.getLen(), retVal);
 #endif
 
@@ -162,7 +170,6 @@ void RaftWebResponderWS::loop()
 #endif
         }
     }
-#endif
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -341,6 +348,57 @@ uint32_t RaftWebResponderWS::getResponseNext(uint8_t*& pBuf, uint32_t bufMaxLen)
     return respLen;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Ready to receive data
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebResponderWS::readyToReceiveData()
+{
+    // Always read during the handshake and if there is no way to check the consumer
+    if ((_connStatus != CONN_ACTIVE) || !_inboundCanAcceptCB)
+        return true;
+
+    // Check if the consumer can accept
+    uint32_t nowMs = millis();
+    if (_inboundCanAcceptCB(_channelID))
+    {
+        if (_rxThrottleStartMs != 0)
+        {
+            uint32_t throttleMs = Raft::timeElapsed(nowMs, _rxThrottleStartMs);
+            _rxThrottleStats.addRxThrottlePeriod(throttleMs);
+            _rxThrottleStartMs = 0;
+#ifdef DEBUG_WS_RX_THROTTLE
+            LOG_I(MODULE_PREFIX, "readyToReceiveData connId %d throttle ended after %dms", 
+                        _reqParams.connId, throttleMs);
+#endif
+        }
+        return true;
+    }
+
+    // Start throttling
+    if (_rxThrottleStartMs == 0)
+    {
+        _rxThrottleStartMs = nowMs == 0 ? 1 : nowMs;
+#ifdef DEBUG_WS_RX_THROTTLE
+        LOG_I(MODULE_PREFIX, "readyToReceiveData connId %d throttle started", _reqParams.connId);
+#endif
+        return false;
+    }
+
+    // Allow a read occasionally so close/pong frames are not held off indefinitely
+    if (Raft::isTimeout(nowMs, _rxThrottleStartMs, RX_THROTTLE_MAX_MS))
+    {
+        _rxThrottleStats.addRxThrottlePeriod(Raft::timeElapsed(nowMs, _rxThrottleStartMs));
+        _rxThrottleStartMs = 0;
+#ifdef WARN_WS_RX_THROTTLE_EXCEEDED
+        LOG_W(MODULE_PREFIX, "readyToReceiveData connId %d consumer not ready for %dms - reading anyway",
+                    _reqParams.connId, RX_THROTTLE_MAX_MS);
+#endif
+        return true;
+    }
+    return false;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Get content type
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -371,7 +429,14 @@ bool RaftWebResponderWS::isReadyToSend()
     uint64_t startUs = micros();
 #endif
 
-    bool isReady = _webSocketLink.isActiveAndUpgraded();
+    // When frames are queued the readiness is determined by the queue (drop-oldest and latest-value
+    // policies always accept frames) otherwise by the connection itself
+    bool isReady = false;
+    if (_useTxQueue)
+        isReady = _webSocketLink.isActiveAndUpgraded() && 
+                ((_txQueue.getPolicy() != TX_QUEUE_POLICY_FIFO) || (_txQueue.count() < _txQueue.maxLen()));
+    else
+        isReady = isConnReadyToSend();
     
 #ifdef DEBUG_RESPONDER_IS_READY_TO_SEND
     // Always log to debug reconnection issue
@@ -383,8 +448,9 @@ bool RaftWebResponderWS::isReadyToSend()
     uint64_t afterLinkCheckUs = micros();
 #endif
 
+    // Frame pool exhaustion is signalled as backpressure
     if (isReady)
-        isReady = _reqParams.getWebConnReadyToSend() ? _reqParams.getWebConnReadyToSend()() == WEB_CONN_SEND_OK : true;
+        isReady = RaftWebFramePool::isAvailable();
 
 #ifdef DEBUG_IS_READY_TO_SEND_TIMING
     uint64_t endUs = micros();
@@ -404,6 +470,42 @@ bool RaftWebResponderWS::isReadyToSend()
     return isReady;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Check active before sending
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebResponderWS::isActiveForSend()
+{
+    if (_connStatus == CONN_ACTIVE)
+        return true;
+#ifdef WARN_ON_SEND_INACTIVE
+    // Throttle warning to avoid flooding the log when a channel keeps
+    // broadcasting to a connection whose handshake has not completed
+    _inactiveSendSuppressedCount++;
+    uint32_t nowMs = millis();
+    if ((_inactiveSendWarnLastMs == 0) ||
+        (Raft::isTimeout(nowMs, _inactiveSendWarnLastMs, INACTIVE_SEND_WARN_MIN_INTERVAL_MS)))
+    {
+        LOG_W(MODULE_PREFIX, "encodeAndSendData connId %d REJECTED - not ACTIVE (status=%d) suppressed %d since last",
+                _reqParams.connId, _connStatus, _inactiveSendSuppressedCount);
+        _inactiveSendWarnLastMs = nowMs;
+        _inactiveSendSuppressedCount = 0;
+    }
+#endif
+    return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Check link and connection are ready to send (without considering frame availability)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebResponderWS::isConnReadyToSend()
+{
+    if (!_webSocketLink.isActiveAndUpgraded())
+        return false;
+    return _reqParams.getWebConnReadyToSend() ? _reqParams.getWebConnReadyToSend()() == WEB_CONN_SEND_OK : true;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Encode and send data
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -415,58 +517,70 @@ bool RaftWebResponderWS::encodeAndSendData(const uint8_t* pBuf, uint32_t bufLen)
             _reqParams.connId, bufLen, _connStatus);
 #endif
     
-    // CRITICAL: Check if connection is ready (handshake must be complete)
-    // This prevents data from being sent during WebSocket upgrade
-    if (_connStatus != CONN_ACTIVE)
-    {
-#ifdef WARN_ON_SEND_INACTIVE
-        // Throttle warning to avoid flooding the log when a channel keeps
-        // broadcasting to a connection whose handshake has not completed
-        _inactiveSendSuppressedCount++;
-        uint32_t nowMs = millis();
-        if ((_inactiveSendWarnLastMs == 0) ||
-            (Raft::isTimeout(nowMs, _inactiveSendWarnLastMs, INACTIVE_SEND_WARN_MIN_INTERVAL_MS)))
-        {
-            LOG_W(MODULE_PREFIX, "encodeAndSendData connId %d REJECTED - not ACTIVE (status=%d) suppressed %d since last",
-                    _reqParams.connId, _connStatus, _inactiveSendSuppressedCount);
-            _inactiveSendWarnLastMs = nowMs;
-            _inactiveSendSuppressedCount = 0;
-        }
-#endif
+    // Check active before using a frame buffer
+    if (!isActiveForSend())
         return false;
-    }
     
-#ifdef WEBSOCKET_SEND_USE_TX_QUEUE
-    // Check packet size limit
-    if (bufLen > _packetMaxBytes)
+    // Write the payload once into a pooled frame with headroom for the websocket header
+    RaftWebDataFrame frame(_channelID, pBuf, bufLen, millis());
+    if (!frame.isValid())
     {
-#ifdef WARN_WS_PACKET_TOO_BIG
-        LOG_W(MODULE_PREFIX, "encodeAndSendData connId %d TOO BIG len %d maxLen %d", 
-                    _reqParams.connId, bufLen, _packetMaxBytes);
+#ifdef WARN_WS_FRAME_POOL_EXHAUSTED
+        LOG_W(MODULE_PREFIX, "encodeAndSendData connId %d frame pool exhausted len %d free %d/%d",
+                    _reqParams.connId, bufLen, RaftWebFramePool::getNumFree(), RaftWebFramePool::getNumBlocks());
 #endif
         return false;
     }
-    // Add to queue - don't block if full
-    RaftWebDataFrame frame(_channelID, pBuf, bufLen, millis());
-    bool putRslt = _txQueue.put(frame, MAX_WAIT_FOR_TX_QUEUE_MS);
-    if (!putRslt)
+    return encodeAndSendFrame(frame);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Send a frame
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebResponderWS::encodeAndSendFrame(RaftWebDataFrame& frame)
+{
+    // CRITICAL: Check if connection is ready (handshake must be complete)
+    // This prevents data from being sent during WebSocket upgrade
+    if (!isActiveForSend() || !frame.isValid())
+        return false;
+    const uint8_t* pBuf = frame.getData();
+    uint32_t bufLen = frame.getLen();
+
+    if (_useTxQueue)
     {
+        // Check packet size limit
+        if (bufLen > _packetMaxBytes)
+        {
+#ifdef WARN_WS_PACKET_TOO_BIG
+            LOG_W(MODULE_PREFIX, "encodeAndSendData connId %d TOO BIG len %d maxLen %d", 
+                        _reqParams.connId, bufLen, _packetMaxBytes);
+#endif
+            return false;
+        }
+
+        // Add to queue - don't block if full (the queue policy decides whether to drop/coalesce)
+        uint32_t frameKey = _txKeyFn ? _txKeyFn(_channelID, pBuf, bufLen) : 0;
+        bool putRslt = _txQueue.put(frame, frameKey, MAX_WAIT_FOR_TX_QUEUE_MS);
+        if (!putRslt)
+        {
 #ifdef WARN_WS_SEND_APP_DATA_FAIL
-        LOG_W(MODULE_PREFIX, "encodeAndSendData connId %d add to txQueue failed len %d count %d maxLen %d",
-                    _reqParams.connId, bufLen, _txQueue.count(), _txQueue.maxLen());
+            LOG_W(MODULE_PREFIX, "encodeAndSendData connId %d add to txQueue failed len %d count %d maxLen %d",
+                        _reqParams.connId, bufLen, _txQueue.count(), _txQueue.maxLen());
 #endif
-    }
-    else
-    {
+        }
+        else
+        {
 #ifdef DEBUG_WS_SEND_APP_DATA
-        LOG_W(MODULE_PREFIX, "encodeAndSendData connId %d len %d",
-                    _reqParams.connId, bufLen);
+            LOG_W(MODULE_PREFIX, "encodeAndSendData connId %d len %d key %d",
+                        _reqParams.connId, bufLen, frameKey);
 #endif
+        }
+        return putRslt;
     }
-    return putRslt;
-#else
+
     // Send
-    RaftWebConnSendRetVal retVal = _webSocketLink.sendMsg(_webSocketLink.msgOpCodeDefault(), pBuf, bufLen);
+    RaftWebConnSendRetVal retVal = _webSocketLink.sendFrame(_webSocketLink.msgOpCodeDefault(), frame);
 
 #ifdef DEBUG_WS_SEND_APP_DATA
     LOG_W(MODULE_PREFIX, "encodeAndSendData connId %d sent len %d retc %d",
@@ -497,8 +611,6 @@ bool RaftWebResponderWS::encodeAndSendData(const uint8_t* pBuf, uint32_t bufLen)
 #endif
     }
     return retVal == WEB_CONN_SEND_OK;
-
-#endif
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -542,7 +654,9 @@ void RaftWebResponderWS::onWebSocketEvent(RaftWebSocketEventCode eventCode, cons
         }
 		case WEBSOCKET_EVENT_TEXT:
         {
-            // Handle the inbound message
+            // Handle the inbound message (pub/sub control messages are handled here)
+            if (_pWebHandler && _pWebHandler->handleInboundControlMsg(_channelID, pBuf, bufLen))
+                break;
             if (_inboundMsgCB && (pBuf != NULL))
                 _inboundMsgCB(_channelID, (uint8_t*) pBuf, bufLen);
 #ifdef DEBUG_WEBSOCKETS_TRAFFIC
@@ -556,7 +670,9 @@ void RaftWebResponderWS::onWebSocketEvent(RaftWebSocketEventCode eventCode, cons
         }
 		case WEBSOCKET_EVENT_BINARY:
         {
-            // Handle the inbound message
+            // Handle the inbound message (pub/sub control messages are handled here)
+            if (_pWebHandler && _pWebHandler->handleInboundControlMsg(_channelID, pBuf, bufLen))
+                break;
             if (_inboundMsgCB && (pBuf != NULL))
                 _inboundMsgCB(_channelID, (uint8_t*) pBuf, bufLen);
 #ifdef DEBUG_WEBSOCKETS_TRAFFIC
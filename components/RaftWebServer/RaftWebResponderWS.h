@@ -15,13 +15,14 @@
 #include "RaftWebConnection.h"
 #include "RaftWebSocketLink.h"
 #include "RaftWebDataFrame.h"
-#include "ThreadSafeQueue.h"
+#include "RaftWebTxQueue.h"
 #include "RaftWebInterface.h"
 
 class RaftWebHandlerWS;
 class RaftWebServerSettings;
 class ProtocolEndpointManager;
 
+// Use the tx queue for all websockets (otherwise only used when the txQueuePolicy is not fifo)
 // #define WEBSOCKET_SEND_USE_TX_QUEUE
 
 class RaftWebResponderWS : public RaftWebResponder
@@ -32,7 +33,8 @@ public:
             RaftWebSocketInboundCanAcceptFnType inboundCanAcceptCB, 
             RaftWebSocketInboundHandleMsgFnType inboundMsgCB,
             uint32_t channelID, uint32_t packetMaxBytes, uint32_t txQueueSize,
-            uint32_t pingIntervalMs, uint32_t disconnIfNoPongMs, bool isBinary);
+            uint32_t pingIntervalMs, uint32_t disconnIfNoPongMs, bool isBinary,
+            RaftWebTxQueuePolicy txQueuePolicy, RaftWebSocketTxKeyFnType txKeyFn);
     virtual ~RaftWebResponderWS();
 
     // Service - called frequently
@@ -71,6 +73,9 @@ public:
     // Send a frame of data
     virtual bool encodeAndSendData(const uint8_t* pBuf, uint32_t bufLen) override final;
 
+    // Send a pre-encoded frame (payload is shared, not copied)
+    virtual bool encodeAndSendFrame(RaftWebDataFrame& frame) override final;
+
     // Get responder type
     virtual const char* getResponderType() override final
     {
@@ -90,6 +95,26 @@ public:
         return true;
     }
 
+    // Get link quality stats (ping/pong RTT)
+    virtual bool getLinkStats(RaftWebLinkStats& linkStats) override final
+    {
+        linkStats = _webSocketLink.getLinkStats();
+        linkStats.rxThrottleCount = _rxThrottleStats.rxThrottleCount;
+        linkStats.rxThrottleTotalMs = _rxThrottleStats.rxThrottleTotalMs;
+        linkStats.rxThrottleMaxMs = _rxThrottleStats.rxThrottleMaxMs;
+        linkStats.rxThrottleActive = _rxThrottleStartMs != 0;
+        return true;
+    }
+
+    // Ready to receive data - reflects backpressure from the inbound message consumer
+    virtual bool readyToReceiveData() override final;
+
+    // Ping/no-pong timers run on the connection
+    virtual void onTimer(RaftWebConnRespTimer respTimer, uint32_t nowMs) override final
+    {
+        _webSocketLink.onTimer(respTimer, nowMs);
+    }
+
 private:
     // Handler
     RaftWebHandlerWS* _pWebHandler;
@@ -126,11 +151,21 @@ private:
     // Vars
     String _requestStr;
 
-#ifdef WEBSOCKET_SEND_USE_TX_QUEUE
     // Queue for sending frames over the web socket
-    ThreadSafeQueue<RaftWebDataFrame> _txQueue;
+    RaftWebTxQueue _txQueue;
+    bool _useTxQueue = false;
     static const uint32_t MAX_WAIT_FOR_TX_QUEUE_MS = 2;
-#endif
+
+    // Key extractor for latest-value coalescing
+    RaftWebSocketTxKeyFnType _txKeyFn;
+
+    // Receive flow control - while the inbound consumer can't accept messages the socket
+    // isn't read so the TCP window closes and the client is throttled by TCP
+    uint32_t _rxThrottleStartMs = 0;
+    RaftWebLinkStats _rxThrottleStats;
+    // Reading is allowed after this time even if the consumer is still busy so that
+    // control frames (close/pong) are not held off indefinitely
+    static const uint32_t RX_THROTTLE_MAX_MS = 5000;
 
     // Max packet size
     uint32_t _packetMaxBytes = 5000;
@@ -138,6 +173,12 @@ private:
     // Debug last loop
     uint32_t _debugLastServiceMs = 0;
 
+    // Check link and connection are ready to send
+    bool isConnReadyToSend();
+
+    // Check active before sending (warns if not)
+    bool isActiveForSend();
+
     // Callback on websocket activity
     void onWebSocketEvent(RaftWebSocketEventCode eventCode, const uint8_t* pBuf, uint32_t bufLen);
 
@@ -0,0 +1,62 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "RaftWebSSEvent.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constructor - encodes the event
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftWebSSEvent::RaftWebSSEvent(uint32_t id, const char* eventContent, const char* eventGroup, uint32_t groupMask)
+{
+    _id = id;
+    _groupMask = groupMask;
+    _group = eventGroup ? eventGroup : "";
+    if (!eventContent)
+        eventContent = "";
+    uint32_t contentLen = strlen(eventContent);
+
+    // Space for the id and event lines plus one data line (more is added if the content has several lines)
+    static const char DATA_PREFIX[] = "data: ";
+    static const uint32_t DATA_PREFIX_LEN = sizeof(DATA_PREFIX) - 1;
+    static const uint32_t MAX_ID_LINE_LEN = 20;
+    _encoded.reserve(MAX_ID_LINE_LEN + 9 + _group.length() + DATA_PREFIX_LEN + contentLen + 4);
+
+    // Id line
+    char idLine[MAX_ID_LINE_LEN];
+    append(idLine, snprintf(idLine, sizeof(idLine), "id: %u\r\n", (unsigned)id));
+
+    // Event line
+    if (_group.length() > 0)
+    {
+        append("event: ", 7);
+        append(_group.c_str(), _group.length());
+        append("\r\n", 2);
+    }
+
+    // Data lines - the content is split on CR, LF or CRLF in a single scan (a line break at the end
+    // of the content doesn't start another data line)
+    uint32_t lineStart = 0;
+    uint32_t pos = 0;
+    do
+    {
+        while ((pos < contentLen) && (eventContent[pos] != '\r') && (eventContent[pos] != '\n'))
+            pos++;
+        append(DATA_PREFIX, DATA_PREFIX_LEN);
+        append(eventContent + lineStart, pos - lineStart);
+        append("\r\n", 2);
+        if ((pos < contentLen) && (eventContent[pos] == '\r') && (pos + 1 < contentLen) && (eventContent[pos + 1] == '\n'))
+            pos++;
+        pos++;
+        lineStart = pos;
+    } while (pos < contentLen);
+
+    // Blank line ends the event
+    append("\r\n", 2);
+}
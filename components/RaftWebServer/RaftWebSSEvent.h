@@ -8,30 +8,57 @@
 
 #pragma once
 
+#include <vector>
 #include "RaftArduino.h"
 
-// SSEvent for tx queue
+// SSEvent held in the event ring
+// The event is encoded (id:/event:/data: lines) once when it is created and is immutable after that
+// so it can be shared by reference between all the subscribers sending it
 class RaftWebSSEvent
 {
 public:
-    RaftWebSSEvent()
+    RaftWebSSEvent(uint32_t id, const char* eventContent, const char* eventGroup, uint32_t groupMask);
+
+    uint32_t getId() const
     {
+        return _id;
     }
-    RaftWebSSEvent(const char* eventContent, const char* eventGroup)
+    const String& getGroup() const
     {
-        _content = eventContent;
-        _group = eventGroup;
+        return _group;
     }
-    const String& getContent()
+
+    // Bit for the event's group in subscriber group masks (0 if no subscriber has asked for the group)
+    uint32_t getGroupMask() const
     {
-        return _content;
+        return _groupMask;
     }
-    const String& getGroup()
+
+    // Encoded event (as sent on the wire)
+    const uint8_t* getData() const
     {
-        return _group;
+        return _encoded.data();
+    }
+    uint32_t getLen() const
+    {
+        return _encoded.size();
+    }
+
+    // Memory used
+    uint32_t getBytes() const
+    {
+        return _encoded.capacity() + _group.length();
     }
 
 private:
-    String _content;
+    uint32_t _id = 0;
     String _group;
-};
\ No newline at end of file
+    uint32_t _groupMask = 0;
+    std::vector<uint8_t> _encoded;
+
+    // Helpers
+    void append(const char* pStr, uint32_t len)
+    {
+        _encoded.insert(_encoded.end(), (const uint8_t*)pStr, (const uint8_t*)pStr + len);
+    }
+};
@@ -0,0 +1,205 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Logger.h"
+#include "RaftWebSSEventRing.h"
+
+// Debug
+// #define DEBUG_SSEVENT_RING
+
+#if defined(DEBUG_SSEVENT_RING)
+static const char* MODULE_PREFIX = "RaftWebSSERing";
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constructor / Destructor
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftWebSSEventRing::RaftWebSSEventRing(uint32_t maxEvents, uint32_t maxBytes)
+{
+    _maxEvents = maxEvents > 0 ? maxEvents : 1;
+    _maxBytes = maxBytes;
+    RaftMutex_init(_ringMutex);
+}
+
+RaftWebSSEventRing::~RaftWebSSEventRing()
+{
+    RaftMutex_destroy(_ringMutex);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Add event
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebSSEventRing::addEvent(const char* eventContent, const char* eventGroup)
+{
+    if (!RaftMutex_lock(_ringMutex, RAFT_MUTEX_WAIT_FOREVER))
+        return 0;
+
+    // Group bit
+    uint32_t groupMask = 0;
+    for (uint32_t i = 0; (i < _groups.size()) && eventGroup; i++)
+    {
+        if (_groups[i].equals(eventGroup))
+        {
+            groupMask = 1u << i;
+            break;
+        }
+    }
+
+    // Encode the event once - subscribers all send the same encoded event
+    std::shared_ptr<const RaftWebSSEvent> pEvent = 
+                std::make_shared<const RaftWebSSEvent>(_nextId, eventContent, eventGroup, groupMask);
+
+    // Drop the oldest events to make space (the newest event is always kept)
+    while (!_events.empty() && ((_events.size() >= _maxEvents) || (_usedBytes + pEvent->getBytes() > _maxBytes)))
+    {
+        _usedBytes -= _events.front()->getBytes();
+        _events.pop_front();
+    }
+    _usedBytes += pEvent->getBytes();
+    _events.push_back(pEvent);
+
+    // The id is only advanced once the event is in the ring so subscribers see it as available
+    uint32_t eventId = _nextId;
+    _nextId = eventId + 1;
+    RaftMutex_unlock(_ringMutex);
+
+#ifdef DEBUG_SSEVENT_RING
+    LOG_I(MODULE_PREFIX, "addEvent id %d group %s numEvents %d usedBytes %d", 
+                eventId, eventGroup ? eventGroup : "", _events.size(), _usedBytes);
+#endif
+    return eventId;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Get cursor for a new subscriber
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebSSEventRing::getStartCursor(uint32_t lastEventId, bool lastEventIdValid)
+{
+    // New subscribers only get new events
+    if (!lastEventIdValid)
+        return _nextId;
+
+    // An id from the future means the server restarted since the subscriber's last event so all the
+    // events retained are new to it (getEvent skips on to the oldest event retained)
+    if (lastEventId >= _nextId)
+        return 0;
+    return lastEventId + 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Get event
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebSSEventRing::getEvent(uint32_t& cursor, std::shared_ptr<const RaftWebSSEvent>& pEvent, 
+            uint32_t groupMask, bool coalesce)
+{
+    if (!isEventAvailable(cursor) || !RaftMutex_lock(_ringMutex, RAFT_MUTEX_WAIT_FOREVER))
+        return false;
+    bool eventValid = false;
+    if (!_events.empty())
+    {
+        // Events which have been dropped from the ring are skipped
+        uint32_t oldestId = _events.front()->getId();
+        if ((cursor < oldestId) && (cursor != 0))
+            _skippedCount += oldestId - cursor;
+        if (cursor < oldestId)
+            cursor = oldestId;
+
+        // Ids are contiguous so events can be indexed directly
+        for (uint32_t eventIdx = cursor - oldestId; eventIdx < _events.size(); eventIdx++)
+        {
+            // Events in groups not wanted are passed over
+            const RaftWebSSEvent& event = *_events[eventIdx];
+            cursor = event.getId() + 1;
+            if (!isWanted(event, groupMask))
+                continue;
+
+            // Check if superseded by a later event in the same group
+            bool isSuperseded = false;
+            for (uint32_t laterIdx = eventIdx + 1; coalesce && (laterIdx < _events.size()); laterIdx++)
+            {
+                const RaftWebSSEvent& laterEvent = *_events[laterIdx];
+                if (isWanted(laterEvent, groupMask) && laterEvent.getGroup().equals(event.getGroup()))
+                {
+                    isSuperseded = true;
+                    break;
+                }
+            }
+            if (isSuperseded)
+            {
+                _coalescedCount++;
+                continue;
+            }
+            pEvent = _events[eventIdx];
+            eventValid = true;
+            break;
+        }
+    }
+    RaftMutex_unlock(_ringMutex);
+    return eventValid;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Get group mask for a list of groups
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebSSEventRing::getGroupMask(const String& groupsList)
+{
+    if ((groupsList.length() == 0) || !RaftMutex_lock(_ringMutex, RAFT_MUTEX_WAIT_FOREVER))
+        return GROUP_MASK_ALL;
+
+    // Add groups not seen before - if there are too many groups the subscriber gets all events
+    uint32_t groupMask = 0;
+    int groupStart = 0;
+    while ((groupStart < (int)groupsList.length()) && (groupMask != GROUP_MASK_ALL))
+    {
+        int groupEnd = groupsList.indexOf(',', groupStart);
+        if (groupEnd < 0)
+            groupEnd = groupsList.length();
+        String group = groupsList.substring(groupStart, groupEnd);
+        group.trim();
+        groupStart = groupEnd + 1;
+        if (group.length() == 0)
+            continue;
+        uint32_t groupIdx = 0;
+        while ((groupIdx < _groups.size()) && !_groups[groupIdx].equals(group))
+            groupIdx++;
+        if ((groupIdx == _groups.size()) && (_groups.size() < MAX_GROUPS))
+            _groups.push_back(group);
+        groupMask = groupIdx < _groups.size() ? (groupMask | (1u << groupIdx)) : GROUP_MASK_ALL;
+    }
+    RaftMutex_unlock(_ringMutex);
+
+#ifdef DEBUG_SSEVENT_RING
+    LOG_I(MODULE_PREFIX, "getGroupMask %s mask %08x numGroups %d", groupsList.c_str(), groupMask, _groups.size());
+#endif
+    return groupMask != 0 ? groupMask : GROUP_MASK_ALL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stats
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+String RaftWebSSEventRing::getStatsJSON()
+{
+    uint32_t numEvents = 0;
+    if (RaftMutex_lock(_ringMutex, RAFT_MUTEX_WAIT_FOREVER))
+    {
+        numEvents = _events.size();
+        RaftMutex_unlock(_ringMutex);
+    }
+    return "{\"events\":" + String(numEvents) +
+            ",\"bytes\":" + String(_usedBytes) +
+            ",\"nextId\":" + String(_nextId) +
+            ",\"skipped\":" + String(_skippedCount) +
+            ",\"coalesced\":" + String(_coalescedCount) + 
+            ",\"groups\":" + String((uint32_t)_groups.size()) + "}";
+}
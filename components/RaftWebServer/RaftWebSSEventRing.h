@@ -0,0 +1,87 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include "RaftArduino.h"
+#include "RaftThreading.h"
+#include "RaftWebSSEvent.h"
+
+// Ring of recent server-side events shared by all subscribers
+// Events get monotonically increasing ids and each subscriber only holds the id of the next event
+// it needs (its cursor) so memory use doesn't depend on the number of subscribers. The oldest events
+// are dropped when the ring is full - subscribers which fall behind skip to the oldest event retained
+// and subscribers which reconnect with Last-Event-ID are replayed the events they missed.
+// Subscribers can ask for specific groups - each group asked for gets a bit in a group mask (up to 32
+// groups) and events are only sent to subscribers whose mask includes the event's group.
+class RaftWebSSEventRing
+{
+public:
+    static const uint32_t DEFAULT_MAX_EVENTS = 16;
+    static const uint32_t DEFAULT_MAX_BYTES = 4096;
+    static const uint32_t GROUP_MASK_ALL = 0xffffffff;
+
+    RaftWebSSEventRing(uint32_t maxEvents = DEFAULT_MAX_EVENTS, uint32_t maxBytes = DEFAULT_MAX_BYTES);
+    ~RaftWebSSEventRing();
+
+    // Add an event - returns the event id
+    uint32_t addEvent(const char* eventContent, const char* eventGroup);
+
+    // Get the cursor for a new subscriber
+    // @param lastEventId id from the Last-Event-ID header
+    // @param lastEventIdValid false if the subscriber isn't reconnecting (only new events are sent)
+    uint32_t getStartCursor(uint32_t lastEventId, bool lastEventIdValid);
+
+    // Check if there is an event at or after the cursor
+    bool isEventAvailable(uint32_t cursor) const
+    {
+        return cursor < _nextId;
+    }
+
+    // Get the group mask for a comma separated list of groups (GROUP_MASK_ALL if empty)
+    uint32_t getGroupMask(const String& groupsList);
+
+    // Get the first event at or after the cursor in the groups wanted - the cursor is moved on past the event
+    // If coalesce is set events superseded by a later event in the same group are skipped
+    // The event is shared (not copied) and returns false if there is no event available
+    bool getEvent(uint32_t& cursor, std::shared_ptr<const RaftWebSSEvent>& pEvent, 
+                uint32_t groupMask = GROUP_MASK_ALL, bool coalesce = false);
+
+    // Stats
+    String getStatsJSON();
+
+private:
+    // Events (oldest first)
+    std::deque<std::shared_ptr<const RaftWebSSEvent>> _events;
+    uint32_t _maxEvents;
+    uint32_t _maxBytes;
+    uint32_t _usedBytes = 0;
+
+    // Id of the next event added (ids start at 1 as 0 isn't a useful Last-Event-ID)
+    volatile uint32_t _nextId = 1;
+
+    // Groups subscribers have asked for (index is the bit in group masks)
+    static const uint32_t MAX_GROUPS = 32;
+    std::vector<String> _groups;
+
+    // Mutex
+    RaftMutex _ringMutex;
+
+    // Stats - events skipped by subscribers which fell behind and superseded events not sent
+    uint32_t _skippedCount = 0;
+    uint32_t _coalescedCount = 0;
+
+    // Helpers
+    static bool isWanted(const RaftWebSSEvent& event, uint32_t groupMask)
+    {
+        return (groupMask == GROUP_MASK_ALL) || ((event.getGroupMask() & groupMask) != 0);
+    }
+};
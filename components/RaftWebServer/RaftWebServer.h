@@ -50,6 +50,24 @@ public:
     // Send to all server-side events
     void serverSideEventsSendMsg(const char* eventContent, const char* eventGroup);
 
+    // Get link quality stats (ping/pong RTT) for a channel - allows producers to adapt to link quality
+    bool getChannelLinkStats(uint32_t channelID, RaftWebLinkStats& linkStats)
+    {
+        return _connManager.getChannelLinkStats(channelID, linkStats);
+    }
+
+    // Get stats as JSON (without enclosing braces)
+    String getStatsJSON()
+    {
+        return _connManager.getStatsJSON();
+    }
+
+    // Publish to a topic on pub/sub websockets - returns number of subscribers sent to
+    uint32_t publishToTopic(const char* topic, const uint8_t* pBuf, uint32_t bufLen)
+    {
+        return _connManager.publishToTopic(topic, pBuf, bufLen);
+    }
+
 private:
 
     // Connection manager
@@ -101,4 +101,103 @@ public:
     // Connection clear pending duration ms
     static const uint32_t CONNECTION_CLEAR_PENDING_MS_DEFAULT = 0;
     uint32_t clearPendingDurationMs = CONNECTION_CLEAR_PENDING_MS_DEFAULT;
+
+    // Pool of outbound websocket frame buffers (payloads larger than the block size use the heap)
+    static const uint32_t DEFAULT_FRAME_POOL_BLOCKS = 16;
+    static const uint32_t DEFAULT_FRAME_POOL_BLOCK_BYTES = 1500;
+    uint32_t framePoolBlocks = DEFAULT_FRAME_POOL_BLOCKS;
+    uint32_t framePoolBlockBytes = DEFAULT_FRAME_POOL_BLOCK_BYTES;
+
+    // Upload pipeline - buffers (ideally flash sector sized) filled by the connection while a
+    // writer task passes previous buffers to the upload endpoint (0 buffers to disable)
+    static const uint32_t DEFAULT_UPLOAD_PIPELINE_BUFFERS = 0;
+    static const uint32_t DEFAULT_UPLOAD_PIPELINE_BUFFER_BYTES = 4096;
+    uint32_t uploadPipelineBuffers = DEFAULT_UPLOAD_PIPELINE_BUFFERS;
+    uint32_t uploadPipelineBufferBytes = DEFAULT_UPLOAD_PIPELINE_BUFFER_BYTES;
+
+    // Max window used to decode request bodies with Content-Encoding gzip/deflate (power of 2 up to 32K)
+    static const uint32_t DEFAULT_BODY_DECODE_WINDOW_BYTES = 32768;
+    uint32_t bodyDecodeWindowBytes = DEFAULT_BODY_DECODE_WINDOW_BYTES;
+
+    // REST API responses at least this long are compressed if the client accepts gzip/deflate
+    // (0 to disable) - the level (1..9) can be overridden per endpoint
+    static const uint32_t DEFAULT_RESP_COMPRESS_MIN_BYTES = 0;
+    static const uint32_t DEFAULT_RESP_COMPRESS_LEVEL = 3;
+    uint32_t respCompressMinBytes = DEFAULT_RESP_COMPRESS_MIN_BYTES;
+    uint32_t respCompressLevel = DEFAULT_RESP_COMPRESS_LEVEL;
+
+    // Time allowed for deferred REST API responses to complete before a 504 is sent
+    static const uint32_t DEFAULT_DEFERRED_TIMEOUT_MS = 10000;
+    uint32_t deferredTimeoutMs = DEFAULT_DEFERRED_TIMEOUT_MS;
+
+    // REST API worker pool - endpoints selected to run on workers are called on these tasks rather
+    // than the connection task (0 workers to disable), requests are rejected (503) when the queue is full
+    static const uint32_t DEFAULT_REST_WORKERS = 0;
+    static const uint32_t DEFAULT_REST_WORKER_QUEUE_DEPTH = 8;
+    static const uint32_t DEFAULT_REST_WORKER_CORE = 0;
+    static const uint32_t DEFAULT_REST_WORKER_PRIORITY = 5;
+    static const uint32_t DEFAULT_REST_WORKER_STACK_BYTES = 6000;
+    uint32_t restWorkers = DEFAULT_REST_WORKERS;
+    uint32_t restWorkerQueueDepth = DEFAULT_REST_WORKER_QUEUE_DEPTH;
+    uint32_t restWorkerCore = DEFAULT_REST_WORKER_CORE;
+    uint32_t restWorkerPriority = DEFAULT_REST_WORKER_PRIORITY;
+    uint32_t restWorkerStackBytes = DEFAULT_REST_WORKER_STACK_BYTES;
+
+    // Memory allowed for caching REST API GET responses (0 to disable)
+    static const uint32_t DEFAULT_RESP_CACHE_MAX_BYTES = 0;
+    uint32_t respCacheMaxBytes = DEFAULT_RESP_CACHE_MAX_BYTES;
+
+    // Coalesce identical REST API GET requests which arrive while one is in progress on the worker pool
+    // or a deferred endpoint so the endpoint is only called once
+    static const bool DEFAULT_REST_COALESCE_GETS = true;
+    bool restCoalesceGets = DEFAULT_REST_COALESCE_GETS;
+
+    // Admission control for new connections - max concurrent connections from one client address and
+    // the rate (with burst) at which each address can open connections (0 to disable each limit)
+    static const uint32_t DEFAULT_CONN_MAX_PER_ADDR = 0;
+    static const uint32_t DEFAULT_CONN_RATE_PER_SEC = 0;
+    static const uint32_t DEFAULT_CONN_RATE_BURST = 10;
+    uint32_t connMaxPerAddr = DEFAULT_CONN_MAX_PER_ADDR;
+    uint32_t connRatePerSec = DEFAULT_CONN_RATE_PER_SEC;
+    uint32_t connRateBurst = DEFAULT_CONN_RATE_BURST;
+
+    // Overload - connections arriving when all slots are in use are sent a 503 with this Retry-After
+    // (0 to just close them). Reserved slots are only used by websocket upgrades and requests for paths
+    // starting with one of the comma-separated reservedSlotPaths (e.g. "/api/ota,/api/status")
+    static const uint32_t DEFAULT_OVERLOAD_RETRY_AFTER_SECS = 2;
+    static const uint32_t DEFAULT_RESERVED_CONN_SLOTS = 0;
+    uint32_t overloadRetryAfterSecs = DEFAULT_OVERLOAD_RETRY_AFTER_SECS;
+    uint32_t reservedConnSlots = DEFAULT_RESERVED_CONN_SLOTS;
+    String reservedSlotPaths;
+
+    // When all slots are in use the least recently active idle HTTP connection (no request in progress
+    // for at least this long or response complete) is evicted to make room (0 to disable eviction)
+    static const uint32_t DEFAULT_CONN_EVICT_MIN_IDLE_MS = 1000;
+    uint32_t connEvictMinIdleMs = DEFAULT_CONN_EVICT_MIN_IDLE_MS;
+
+    // Slots guaranteed to each class of service (websocket, server-side events, REST API and static
+    // files) with the remaining slots shared - requests are rejected (503) when their class and the
+    // shared slots are all in use (all 0 to disable)
+    uint32_t minSlotsWS = 0;
+    uint32_t minSlotsSSE = 0;
+    uint32_t minSlotsREST = 0;
+    uint32_t minSlotsStatic = 0;
+
+    // Transmit scheduling - when connections contend for the link, REST API and static file responses
+    // send up to txQuantumBytes times their weight each service round (deficit round robin) while
+    // websocket and server-side event connections are serviced first without limit (0 to disable)
+    static const uint32_t DEFAULT_TX_QUANTUM_BYTES = 0;
+    static const uint32_t DEFAULT_TX_WEIGHT_REST = 2;
+    static const uint32_t DEFAULT_TX_WEIGHT_STATIC = 1;
+    uint32_t txQuantumBytes = DEFAULT_TX_QUANTUM_BYTES;
+    uint32_t txWeightREST = DEFAULT_TX_WEIGHT_REST;
+    uint32_t txWeightStatic = DEFAULT_TX_WEIGHT_STATIC;
+
+    // Bandwidth caps for responses - each is JSON {"type":"<responderType>"|"handler":"<handlerName>",
+    // "bytesPerSec":N,"burst":N,"perConn":0|1} (see RaftWebBandwidthCaps)
+    std::vector<String> bandwidthCaps;
+
+    // Time allowed for a new connection to send its request header (0 for no limit other than the idle timeout)
+    static const uint32_t DEFAULT_HEADER_TIMEOUT_MS = 0;
+    uint32_t headerTimeoutMs = DEFAULT_HEADER_TIMEOUT_MS;
 };
@@ -0,0 +1,92 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Logger.h"
+#include "RaftWebSingleFlight.h"
+
+// Debug
+// #define DEBUG_SINGLE_FLIGHT
+
+#if defined(DEBUG_SINGLE_FLIGHT)
+static const char* MODULE_PREFIX = "RaftWebFlight";
+#endif
+
+// Statics
+std::list<RaftWebSingleFlight::Flight> RaftWebSingleFlight::_flights;
+RaftMutex RaftWebSingleFlight::_flightsMutex;
+bool RaftWebSingleFlight::_isEnabled = false;
+uint32_t RaftWebSingleFlight::_flightCount = 0;
+uint32_t RaftWebSingleFlight::_joinCount = 0;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Setup
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebSingleFlight::setup(bool isEnabled)
+{
+    if (_isEnabled || !isEnabled)
+        return;
+    RaftMutex_init(_flightsMutex);
+    _isEnabled = true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Join (or start) a flight
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftWebDeferredHandle RaftWebSingleFlight::join(const String& reqStr, bool& isLeader)
+{
+    isLeader = true;
+    if (!_isEnabled || !RaftMutex_lock(_flightsMutex, RAFT_MUTEX_WAIT_FOREVER))
+        return std::make_shared<RaftWebDeferredResponse>();
+
+    // Look for a flight in progress (removing those which have landed)
+    RaftWebDeferredHandle handle;
+    for (auto it = _flights.begin(); it != _flights.end(); )
+    {
+        RaftWebDeferredHandle flightHandle = it->handle.lock();
+        if (!flightHandle || !flightHandle->isPending())
+        {
+            it = _flights.erase(it);
+            continue;
+        }
+        if (!handle && it->reqStr.equals(reqStr) && flightHandle->addWaiter())
+        {
+            handle = flightHandle;
+            isLeader = false;
+        }
+        ++it;
+    }
+
+    // Start a new flight
+    if (!handle)
+    {
+        handle = std::make_shared<RaftWebDeferredResponse>();
+        _flights.push_back({reqStr, handle});
+        _flightCount++;
+    }
+    else
+    {
+        _joinCount++;
+    }
+    RaftMutex_unlock(_flightsMutex);
+
+#ifdef DEBUG_SINGLE_FLIGHT
+    LOG_I(MODULE_PREFIX, "join %s %s inFlight %d", reqStr.c_str(), isLeader ? "LEADER" : "JOINED", _flights.size());
+#endif
+    return handle;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stats
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+String RaftWebSingleFlight::getStatsJSON()
+{
+    return "{\"flights\":" + String(_flightCount) + ",\"joined\":" + String(_joinCount) + "}";
+}
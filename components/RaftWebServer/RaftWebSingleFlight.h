@@ -0,0 +1,56 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include "RaftArduino.h"
+#include "RaftThreading.h"
+#include "RaftWebDeferred.h"
+
+// Coalescing (single-flight) of identical REST API GET requests
+// While a request is being computed (on the worker pool or by a deferred endpoint) identical requests
+// join the same flight and share its completion handle (and so the response) rather than calling
+// the endpoint again
+class RaftWebSingleFlight
+{
+public:
+    // Setup
+    static void setup(bool isEnabled);
+
+    // Check enabled
+    static bool isEnabled()
+    {
+        return _isEnabled;
+    }
+
+    // Join the flight for a request (or start a new one if there is none in progress)
+    // isLeader is set if a new flight was started - the caller must then start the computation
+    // which completes the returned handle
+    static RaftWebDeferredHandle join(const String& reqStr, bool& isLeader);
+
+    // Stats
+    static String getStatsJSON();
+
+private:
+    // Flights in progress
+    class Flight
+    {
+    public:
+        String reqStr;
+        std::weak_ptr<RaftWebDeferredResponse> handle;
+    };
+    static std::list<Flight> _flights;
+    static RaftMutex _flightsMutex;
+    static bool _isEnabled;
+
+    // Stats
+    static uint32_t _flightCount;
+    static uint32_t _joinCount;
+};
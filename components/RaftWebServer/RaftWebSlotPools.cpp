@@ -0,0 +1,137 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "Logger.h"
+#include "RaftWebSlotPools.h"
+#include "RaftWebRequestHeader.h"
+#include "RaftWebResponder.h"
+
+// Warn
+#define WARN_ON_SLOT_POOL_FULL
+
+// Debug
+// #define DEBUG_SLOT_POOLS
+
+#if defined(WARN_ON_SLOT_POOL_FULL) || defined(DEBUG_SLOT_POOLS)
+static const char* MODULE_PREFIX = "RaftWebSlotPools";
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Setup
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebSlotPools::setup(uint32_t numSlots, const uint32_t minSlots[WEB_CONN_CLASS_MAX])
+{
+    uint32_t totalMinSlots = 0;
+    for (uint32_t i = 0; i < WEB_CONN_CLASS_MAX; i++)
+    {
+        _classes[i] = ClassInfo();
+        _classes[i].minSlots = minSlots[i];
+        totalMinSlots += minSlots[i];
+    }
+    _isEnabled = totalMinSlots > 0;
+    _overflowSlots = numSlots > totalMinSlots ? numSlots - totalMinSlots : 0;
+
+#ifdef DEBUG_SLOT_POOLS
+    LOG_I(MODULE_PREFIX, "setup numSlots %d ws %d sse %d rest %d static %d overflow %d", numSlots,
+            minSlots[WEB_CONN_CLASS_WS], minSlots[WEB_CONN_CLASS_SSE], minSlots[WEB_CONN_CLASS_REST],
+            minSlots[WEB_CONN_CLASS_STATIC], _overflowSlots);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Get class of a request
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftWebConnClass RaftWebSlotPools::getConnClass(const RaftWebRequestHeader& header, RaftWebResponder* pResponder)
+{
+    if (header.reqConnType == REQ_CONN_TYPE_WEBSOCKET)
+        return WEB_CONN_CLASS_WS;
+    if (header.reqConnType == REQ_CONN_TYPE_EVENT)
+        return WEB_CONN_CLASS_SSE;
+    if (!pResponder)
+        return WEB_CONN_CLASS_NONE;
+    const char* pType = pResponder->getResponderType();
+    if (strcmp(pType, "FILE") == 0)
+        return WEB_CONN_CLASS_STATIC;
+    if (strcmp(pType, "SSEvents") == 0)
+        return WEB_CONN_CLASS_SSE;
+    if (strcmp(pType, "WS") == 0)
+        return WEB_CONN_CLASS_WS;
+    return WEB_CONN_CLASS_REST;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Acquire / release
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebSlotPools::acquire(RaftWebConnClass connClass)
+{
+    if (!_isEnabled || (connClass <= WEB_CONN_CLASS_NONE) || (connClass >= WEB_CONN_CLASS_MAX))
+        return true;
+
+    // Use the class minimum first then the overflow pool
+    ClassInfo& classInfo = _classes[connClass];
+    if ((classInfo.used >= classInfo.minSlots) && (getOverflowUsed() >= _overflowSlots))
+    {
+        classInfo.rejects++;
+#ifdef WARN_ON_SLOT_POOL_FULL
+        LOG_W(MODULE_PREFIX, "acquire %s pool full used %d min %d overflow %d", 
+                RaftWebConnClassDefs::getConnClassStr(connClass), classInfo.used, classInfo.minSlots, _overflowSlots);
+#endif
+        return false;
+    }
+    classInfo.used++;
+    if (classInfo.used > classInfo.peak)
+        classInfo.peak = classInfo.used;
+    return true;
+}
+
+void RaftWebSlotPools::release(RaftWebConnClass connClass)
+{
+    if (!_isEnabled || (connClass <= WEB_CONN_CLASS_NONE) || (connClass >= WEB_CONN_CLASS_MAX))
+        return;
+    if (_classes[connClass].used > 0)
+        _classes[connClass].used--;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stats
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+String RaftWebSlotPools::getStatsJSON() const
+{
+    String classesStr;
+    for (uint32_t i = 0; i < WEB_CONN_CLASS_MAX; i++)
+    {
+        const ClassInfo& classInfo = _classes[i];
+        classesStr += String(i == 0 ? "" : ",") + 
+                "\"" + RaftWebConnClassDefs::getConnClassStr((RaftWebConnClass)i) + "\":" +
+                "{\"min\":" + String(classInfo.minSlots) +
+                ",\"used\":" + String(classInfo.used) +
+                ",\"peak\":" + String(classInfo.peak) +
+                ",\"rejects\":" + String(classInfo.rejects) + "}";
+    }
+    return "{\"enabled\":" + String(_isEnabled ? 1 : 0) +
+            ",\"overflow\":" + String(_overflowSlots) +
+            ",\"overflowUsed\":" + String(getOverflowUsed()) +
+            ",\"classes\":{" + classesStr + "}}";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebSlotPools::getOverflowUsed() const
+{
+    uint32_t overflowUsed = 0;
+    for (const ClassInfo& classInfo : _classes)
+        overflowUsed += classInfo.used > classInfo.minSlots ? classInfo.used - classInfo.minSlots : 0;
+    return overflowUsed;
+}
@@ -0,0 +1,66 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RaftArduino.h"
+#include "RaftWebConnDefs.h"
+
+class RaftWebRequestHeader;
+class RaftWebResponder;
+
+// Connection slots partitioned by class of service (websocket, server-side events, REST API, static files)
+// Each class is guaranteed a minimum number of slots and the remaining slots form an overflow pool
+// shared by all classes. A connection takes a slot in its class when its request has been routed
+// and gives it back when the connection closes.
+class RaftWebSlotPools
+{
+public:
+    // Setup - numSlots is the total number of connection slots and minSlots the minimum for each class
+    // (partitioning is disabled if all minimums are 0)
+    void setup(uint32_t numSlots, const uint32_t minSlots[WEB_CONN_CLASS_MAX]);
+
+    // Check if enabled
+    bool isEnabled() const
+    {
+        return _isEnabled;
+    }
+
+    // Get the class of a request from its header and the responder it was routed to
+    static RaftWebConnClass getConnClass(const RaftWebRequestHeader& header, RaftWebResponder* pResponder);
+
+    // Acquire a slot in a class - returns false if the class minimum and overflow pool are both used
+    bool acquire(RaftWebConnClass connClass);
+
+    // Release a slot
+    void release(RaftWebConnClass connClass);
+
+    // Stats
+    String getStatsJSON() const;
+
+private:
+    // Enabled
+    bool _isEnabled = false;
+
+    // Slots in the shared overflow pool
+    uint32_t _overflowSlots = 0;
+
+    // Per class
+    class ClassInfo
+    {
+    public:
+        uint32_t minSlots = 0;
+        uint32_t used = 0;
+        uint32_t peak = 0;
+        uint32_t rejects = 0;
+    };
+    ClassInfo _classes[WEB_CONN_CLASS_MAX];
+
+    // Slots used from the overflow pool
+    uint32_t getOverflowUsed() const;
+};
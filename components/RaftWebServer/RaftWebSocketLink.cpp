@@ -83,7 +83,7 @@ RaftWebSocketLink::~RaftWebSocketLink()
 
 void RaftWebSocketLink::setup(RaftWebSocketCB webSocketCB, RaftWebConnSendFn rawConnSendFn,
                 uint32_t pingIntervalMs, bool roleIsServer, uint32_t disconnIfNoPongMs,
-                bool isBinary)
+                bool isBinary, RaftWebConnTimerFn connTimerFn)
 {
 #ifdef DEBUG_WEBSOCKET_HANDSHAKE
     LOG_I(MODULE_PREFIX, "setup roleIsServer=%d upgradeRespSent was=%d (resetting to false)",
@@ -95,7 +95,9 @@ void RaftWebSocketLink::setup(RaftWebSocketCB webSocketCB, RaftWebConnSendFn raw
     _pingIntervalMs = pingIntervalMs;
     _pingTimeLastMs = 0;
     _pongRxLastMs = 0;
+    _linkStats = RaftWebLinkStats();
     _disconnIfNoPongMs = disconnIfNoPongMs;
+    _connTimerFn = connTimerFn;
     _maskSentData = !roleIsServer;
     _isActive = true;
     _defaultContentOpCode = isBinary ? WEBSOCKET_OPCODE_BINARY : WEBSOCKET_OPCODE_TEXT;
@@ -110,38 +112,92 @@ void RaftWebSocketLink::setup(RaftWebSocketCB webSocketCB, RaftWebConnSendFn raw
 
 void RaftWebSocketLink::loop()
 {
-    static const uint8_t PING_MSG[] = "RAFT";
-    // Handle ping / pong
-    if (_upgradeRespSent && _pingIntervalMs != 0)
+    // Ping / pong deadlines are handled in onTimer() when they run as connection timers
+    if (_connTimerFn || !_upgradeRespSent || (_pingIntervalMs == 0))
+        return;
+
+    // Check if time to send ping
+    if (Raft::isTimeout(millis(), _pingTimeLastMs, _pingIntervalMs))
+        sendPing();
+
+    // Check for disconnect on no pong - this intentionally only starts working after
+    // a first pong has been received - this is because older martypy versions did not
+    // correctly handle the pong response
+    if ((_disconnIfNoPongMs != 0) && (_pongRxLastMs != 0) &&
+             Raft::isTimeout(millis(), _pongRxLastMs, _disconnIfNoPongMs))
+        noPongTimeout(millis());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Connection timer expired
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebSocketLink::onTimer(RaftWebConnRespTimer respTimer, uint32_t nowMs)
+{
+    if (!_connTimerFn || !_upgradeRespSent || (_pingIntervalMs == 0))
+        return;
+
+    // Long timers can fire early so check the deadline and restart for any remaining time
+    // (signed as the times can be recorded after nowMs)
+    if (respTimer == WEB_CONN_RESP_TIMER_PING)
     {
-        // Check if time to send ping
-        if (Raft::isTimeout(millis(), _pingTimeLastMs, _pingIntervalMs))
+        int32_t sincePingMs = (int32_t)(nowMs - _pingTimeLastMs);
+        if (sincePingMs < (int32_t)_pingIntervalMs)
         {
-#ifdef DEBUG_WEBSOCKET_PING_PONG
-            LOG_I(MODULE_PREFIX, "PING");
-#endif
-            sendMsg(WEBSOCKET_OPCODE_PING, PING_MSG, sizeof(PING_MSG));
-            _pingTimeLastMs = millis();
+            _connTimerFn(WEB_CONN_RESP_TIMER_PING, _pingIntervalMs - (sincePingMs > 0 ? sincePingMs : 0));
+            return;
         }
-
-        // Check for disconnect on no pong - this intentionally only starts working after
-        // a first pong has been received - this is because older martypy versions did not
-        // correctly handle the pong response
-        if ((_disconnIfNoPongMs != 0) && (_pongRxLastMs != 0) &&
-                 Raft::isTimeout(millis(), _pongRxLastMs, _disconnIfNoPongMs))
+        sendPing();
+    }
+    else if ((respTimer == WEB_CONN_RESP_TIMER_NO_PONG) && (_disconnIfNoPongMs != 0) && (_pongRxLastMs != 0))
+    {
+        int32_t sincePongMs = (int32_t)(nowMs - _pongRxLastMs);
+        if (sincePongMs < (int32_t)_disconnIfNoPongMs)
         {
-            if (!_warnNoPongShown)
-            {
-                LOG_W(MODULE_PREFIX, "loop - no PONG received for %dms (>%dms), link inactive",
-                        (int)Raft::timeElapsed(millis(), (int)_pongRxLastMs),
-                        _disconnIfNoPongMs);
-                _warnNoPongShown = true;
-            }
-            _isActive = false;
+            _connTimerFn(WEB_CONN_RESP_TIMER_NO_PONG, _disconnIfNoPongMs - (sincePongMs > 0 ? sincePongMs : 0));
+            return;
         }
+        noPongTimeout(nowMs);
     }
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Send ping
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebSocketLink::sendPing()
+{
+#ifdef DEBUG_WEBSOCKET_PING_PONG
+    LOG_I(MODULE_PREFIX, "PING");
+#endif
+    // Ping payload contains a timestamp which is echoed in the PONG to measure RTT
+    uint8_t pingMsg[PING_PAYLOAD_LEN];
+    memcpy(pingMsg, PING_PAYLOAD_PREFIX, PING_PAYLOAD_PREFIX_LEN);
+    uint64_t pingTimeUs = micros();
+    for (uint32_t i = 0; i < sizeof(pingTimeUs); i++)
+        pingMsg[PING_PAYLOAD_PREFIX_LEN + i] = (pingTimeUs >> (i * 8)) & 0xff;
+    sendMsg(WEBSOCKET_OPCODE_PING, pingMsg, sizeof(pingMsg));
+    _pingTimeLastMs = millis();
+    if (_connTimerFn)
+        _connTimerFn(WEB_CONN_RESP_TIMER_PING, _pingIntervalMs);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// No pong received in time - link inactive
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebSocketLink::noPongTimeout(uint32_t nowMs)
+{
+    if (!_warnNoPongShown)
+    {
+        LOG_W(MODULE_PREFIX, "loop - no PONG received for %dms (>%dms), link inactive",
+                (int)Raft::timeElapsed(nowMs, _pongRxLastMs),
+                _disconnIfNoPongMs);
+        _warnNoPongShown = true;
+    }
+    _isActive = false;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Upgrade the link - explicitly assume request header received
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -317,6 +373,8 @@ uint32_t RaftWebSocketLink::getTxData(uint8_t*& pBuf, uint32_t bufMaxLen)
 
         // Make sure we don't PING too early
         _pingTimeLastMs = millis();
+        if (_connTimerFn && (_pingIntervalMs != 0))
+            _connTimerFn(WEB_CONN_RESP_TIMER_PING, _pingIntervalMs);
 
         // Form the upgrade response
         _wsUpgradeResponse = formUpgradeResponse(_wsKey, _wsVersion, bufMaxLen);
@@ -474,6 +532,73 @@ RaftWebConnSendRetVal RaftWebSocketLink::sendMsg(RaftWebSocketOpCodes opCode, co
     return sendRetc;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Send frame - the header is written into the frame headroom so the payload isn't copied
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftWebConnSendRetVal RaftWebSocketLink::sendFrame(RaftWebSocketOpCodes opCode, RaftWebDataFrame& frame)
+{
+    // Masked data (client role) is modified in place so can't be shared - use the copying path
+    if (_maskSentData)
+        return sendMsg(opCode, frame.getData(), frame.getLen());
+
+    // Check valid
+    uint32_t payloadLen = frame.getLen();
+    if (!frame.isValid() || (payloadLen + RaftWebFramePool::FRAME_HEADROOM_BYTES >= MAX_WS_MESSAGE_SIZE))
+    {
+#ifdef WARN_ON_WS_LINK_SEND_TOO_LONG
+        LOG_W(MODULE_PREFIX, "sendFrame invalid or too long %d > %d", payloadLen, MAX_WS_MESSAGE_SIZE);
+#endif
+        return WEB_CONN_SEND_TOO_LONG;
+    }
+
+    // Header length
+    uint32_t hdrLen = 2;
+    uint32_t hdrLenCode = payloadLen;
+    if (payloadLen > 65535)
+    {
+        hdrLen += 8;
+        hdrLenCode = 127;
+    }
+    else if (payloadLen > 125)
+    {
+        hdrLen += 2;
+        hdrLenCode = 126;
+    }
+
+    // Form header
+    uint8_t hdr[MAX_SERVER_FRAME_HEADER_BYTES];
+    hdr[0] = 0x80 | opCode;
+    hdr[1] = hdrLenCode;
+    if (hdrLenCode == 126)
+    {
+        hdr[2] = payloadLen / 256;
+        hdr[3] = payloadLen % 256;
+    }
+    else if (hdrLenCode == 127)
+    {
+        memset(hdr + 2, 0, 4);
+        for (int i = 3; i >= 0; i--)
+            hdr[2 + 4 + (3 - i)] = (payloadLen >> (i * 8)) & 0xff;
+    }
+
+    // Place header in the headroom (shared with other frames on the same block) - if the block
+    // already has a different header then use the copying path
+    if (!frame.prependHeader(hdr, hdrLen))
+        return sendMsg(opCode, frame.getData(), frame.getLen());
+
+    // Send
+    RaftWebConnSendRetVal sendRetc = RaftWebConnSendRetVal::WEB_CONN_SEND_FAIL;
+    if (_rawConnSendFn)
+        sendRetc = _rawConnSendFn(frame.getFrameData(), frame.getFrameLen(), MAX_WS_SEND_RETRY_MS);
+
+#ifdef DEBUG_WEBSOCKET_LINK_SEND
+    LOG_I(MODULE_PREFIX, "sendFrame result %s send %d bytes", 
+            RaftWebConnDefs::getSendRetValStr(sendRetc), frame.getFrameLen());
+#endif
+    return sendRetc;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Form response to upgrade connection
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -614,9 +739,32 @@ uint32_t RaftWebSocketLink::handleRxPacketData(const uint8_t *pBuf, uint32_t buf
             callbackEventCode = WEBSOCKET_EVENT_PONG;
             _pongRxLastMs = millis();
             _warnNoPongShown = false;
+            if (_connTimerFn && (_pingIntervalMs != 0) && (_disconnIfNoPongMs != 0))
+                _connTimerFn(WEB_CONN_RESP_TIMER_NO_PONG, _disconnIfNoPongMs);
+
+            // Measure RTT if the PONG echoes our timestamped PING payload (client frames are masked)
+            if ((_wsHeader.len == PING_PAYLOAD_LEN) && (bufLen >= _wsHeader.dataPos + PING_PAYLOAD_LEN))
+            {
+                uint8_t pongPayload[PING_PAYLOAD_LEN];
+                for (uint32_t i = 0; i < PING_PAYLOAD_LEN; i++)
+                {
+                    pongPayload[i] = pBuf[_wsHeader.dataPos + i];
+                    if (_wsHeader.mask)
+                        pongPayload[i] ^= _wsHeader.maskKey[i % WSHeaderInfo::WEB_SOCKET_MASK_KEY_BYTES];
+                }
+                if (memcmp(pongPayload, PING_PAYLOAD_PREFIX, PING_PAYLOAD_PREFIX_LEN) == 0)
+                {
+                    uint64_t pingTimeUs = 0;
+                    for (uint32_t i = 0; i < sizeof(pingTimeUs); i++)
+                        pingTimeUs |= ((uint64_t)pongPayload[PING_PAYLOAD_PREFIX_LEN + i]) << (i * 8);
+                    uint64_t nowUs = micros();
+                    if ((nowUs >= pingTimeUs) && (nowUs - pingTimeUs < MAX_VALID_RTT_US))
+                        _linkStats.addRTTSample(nowUs - pingTimeUs);
+                }
+            }
 
 #ifdef DEBUG_WEBSOCKET_PING_PONG
-            LOG_I(MODULE_PREFIX, "handleRxPacketData PONG");
+            LOG_I(MODULE_PREFIX, "handleRxPacketData PONG rtt %s", _linkStats.getJSON().c_str());
 #endif
             break;
         }
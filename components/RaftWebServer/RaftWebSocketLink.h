@@ -13,6 +13,8 @@
 #include "RaftArduino.h"
 #include "RaftWebSocketDefs.h"
 #include "RaftWebConnDefs.h"
+#include "RaftWebDataFrame.h"
+#include "RaftWebLinkStats.h"
 
 class RaftWebSocketLink
 {
@@ -23,13 +25,18 @@ public:
     virtual ~RaftWebSocketLink();
 
     // Setup the web socket
+    // If connTimerFn is provided ping and no-pong deadlines are run as connection timers (see onTimer())
+    // rather than checked in loop()
     void setup(RaftWebSocketCB webSocketCB, RaftWebConnSendFn rawConnSendFn, 
             uint32_t pingIntervalMs, bool roleIsServer, uint32_t disconnIfNoPongMs, 
-            bool isBinary);
+            bool isBinary, RaftWebConnTimerFn connTimerFn = nullptr);
 
     // Service - called frequently
     void loop();
 
+    // Connection timer expired
+    void onTimer(RaftWebConnRespTimer respTimer, uint32_t nowMs);
+
     // Upgrade the link
     void upgradeReceived(const String& wsKey, const String& wsVersion);
 
@@ -44,6 +51,9 @@ public:
     // Send message
     RaftWebConnSendRetVal sendMsg(RaftWebSocketOpCodes opCode, const uint8_t* pBuf, uint32_t bufLen);
 
+    // Send frame (header is prepended in the frame headroom - payload not copied)
+    RaftWebConnSendRetVal sendFrame(RaftWebSocketOpCodes opCode, RaftWebDataFrame& frame);
+
     // Check active
     bool isActive()
     {
@@ -74,6 +84,12 @@ public:
         return "NONE";
     }
 
+    // Link quality (RTT) stats
+    const RaftWebLinkStats& getLinkStats() const
+    {
+        return _linkStats;
+    }
+
     // Websocket Opcode to use by default
     RaftWebSocketOpCodes msgOpCodeDefault() { return _defaultContentOpCode; }
 
@@ -108,6 +124,9 @@ private:
     // Max message size
     static const uint32_t MAX_WS_MESSAGE_SIZE = 500000;
 
+    // Max header for an unmasked (server) frame
+    static const uint32_t MAX_SERVER_FRAME_HEADER_BYTES = 10;
+
     // Retry on EAGAIN - set to 0 to avoid blocking the main loop;
     // relies on _socketTxQueuedBuffer (sized via sendMax) to absorb EAGAIN overflow
     // See devdocs/websocket-backpressure-analysis.md for details
@@ -120,6 +139,18 @@ private:
     uint32_t _pongRxLastMs = 0;
     uint32_t _disconnIfNoPongMs = 0;
     bool _warnNoPongShown = false;
+
+    // Connection timers for ping/no-pong deadlines (nullptr if they are checked in loop())
+    RaftWebConnTimerFn _connTimerFn = nullptr;
+
+    // Ping payload is a prefix followed by the 64 bit send time in us (little-endian)
+    static constexpr const char* PING_PAYLOAD_PREFIX = "RAFT";
+    static const uint32_t PING_PAYLOAD_PREFIX_LEN = 4;
+    static const uint32_t PING_PAYLOAD_LEN = PING_PAYLOAD_PREFIX_LEN + sizeof(uint64_t);
+    static const uint64_t MAX_VALID_RTT_US = 60000000;
+
+    // Link quality stats
+    RaftWebLinkStats _linkStats;
     
     // Default content opcode
     RaftWebSocketOpCodes _defaultContentOpCode;
@@ -223,6 +254,8 @@ private:
     uint32_t handleRxPacketData(const uint8_t* pBuf, uint32_t bufLen);
     uint32_t extractWSHeaderInfo(const uint8_t* pBuf, uint32_t bufLen);
     void unmaskData();
+    void sendPing();
+    void noPongTimeout(uint32_t nowMs);
 
     // Form response to upgrade connection
     String formUpgradeResponse(const String& wsKey, const String& wsVersion, uint32_t bufMaxLen);
@@ -0,0 +1,179 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "RaftWebTimerWheel.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Setup
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebTimerWheel::setup(uint32_t numTimers, uint32_t nowMs)
+{
+    _timers.assign(numTimers < NONE ? numTimers : NONE - 1, Timer());
+    for (uint16_t& bucket : _buckets)
+        bucket = NONE;
+    _curTick = 0;
+    _curTickMs = nowMs;
+    _numRunning = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Start / cancel
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebTimerWheel::start(uint32_t timerIdx, uint32_t nowMs, uint32_t durationMs)
+{
+    if (timerIdx >= _timers.size())
+        return;
+    unlink(timerIdx);
+
+    // Expiry rounded up to the next tick
+    uint64_t msFromCurTick = (uint64_t)(uint32_t)(nowMs - _curTickMs) + durationMs;
+    _timers[timerIdx].expiryTick = _curTick + (uint32_t)((msFromCurTick + TICK_MS - 1) / TICK_MS);
+    insert(timerIdx);
+}
+
+void RaftWebTimerWheel::cancel(uint32_t timerIdx)
+{
+    if (timerIdx < _timers.size())
+        unlink(timerIdx);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Advance
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebTimerWheel::advance(uint32_t nowMs, const ExpiredCB& expiredCB)
+{
+    while ((uint32_t)(nowMs - _curTickMs) >= TICK_MS)
+    {
+        _curTick++;
+        _curTickMs += TICK_MS;
+
+        // Move timers down from higher levels when the level below wraps
+        if ((_curTick & WHEEL_MASK) == 0)
+        {
+            if (((_curTick >> WHEEL_BITS) & WHEEL_MASK) == 0)
+                cascade(2);
+            cascade(1);
+        }
+
+        // Fire timers in the current bucket (callbacks may start or cancel timers)
+        uint16_t* pBucket = &_buckets[_curTick & WHEEL_MASK];
+        while (*pBucket != NONE)
+        {
+            uint32_t timerIdx = *pBucket;
+            unlink(timerIdx);
+            _numExpired++;
+            expiredCB(timerIdx, nowMs);
+        }
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Time to next expiry
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebTimerWheel::getMsToNextExpiry(uint32_t nowMs) const
+{
+    if (_numRunning == 0)
+        return UINT32_MAX;
+
+    // Find the first occupied bucket ahead of the current tick in each level - level 0 buckets hold
+    // timers for a single tick and higher level buckets are cascaded at the start of their span
+    uint32_t nextTick = UINT32_MAX;
+    for (uint32_t level = 0; level < WHEEL_LEVELS; level++)
+    {
+        uint32_t levelShift = WHEEL_BITS * level;
+        uint32_t curSlot = _curTick >> levelShift;
+        for (uint32_t slotsAhead = 1; slotsAhead <= WHEEL_SLOTS; slotsAhead++)
+        {
+            if (_buckets[level * WHEEL_SLOTS + ((curSlot + slotsAhead) & WHEEL_MASK)] == NONE)
+                continue;
+            uint32_t ticksAhead = ((curSlot + slotsAhead) << levelShift) - _curTick;
+            if (ticksAhead < nextTick)
+                nextTick = ticksAhead;
+            break;
+        }
+    }
+    if (nextTick == UINT32_MAX)
+        return UINT32_MAX;
+
+    // Convert to ms from now
+    uint32_t msSinceCurTick = nowMs - _curTickMs;
+    uint32_t msToNextTick = nextTick * TICK_MS;
+    return msToNextTick > msSinceCurTick ? msToNextTick - msSinceCurTick : 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebTimerWheel::insert(uint32_t timerIdx)
+{
+    Timer& timer = _timers[timerIdx];
+
+    // Timers already due fire on the next tick and those beyond the wheel are held in the top level
+    int32_t delta = (int32_t)(timer.expiryTick - _curTick);
+    if (delta <= 0)
+    {
+        timer.expiryTick = _curTick + 1;
+        delta = 1;
+    }
+    static const uint32_t MAX_DELTA = (1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    if ((uint32_t)delta > MAX_DELTA)
+        timer.expiryTick = _curTick + MAX_DELTA;
+
+    // Find level and bucket
+    uint32_t level = 0;
+    while ((level < WHEEL_LEVELS - 1) && ((uint32_t)delta >= (1u << (WHEEL_BITS * (level + 1)))))
+        level++;
+    uint32_t bucketIdx = level * WHEEL_SLOTS + ((timer.expiryTick >> (WHEEL_BITS * level)) & WHEEL_MASK);
+
+    // Link at head of bucket
+    timer.bucketIdx = bucketIdx;
+    timer.prevIdx = NONE;
+    timer.nextIdx = _buckets[bucketIdx];
+    if (timer.nextIdx != NONE)
+        _timers[timer.nextIdx].prevIdx = timerIdx;
+    _buckets[bucketIdx] = timerIdx;
+    _numRunning++;
+}
+
+void RaftWebTimerWheel::unlink(uint32_t timerIdx)
+{
+    Timer& timer = _timers[timerIdx];
+    if (timer.bucketIdx == NONE)
+        return;
+    if (timer.prevIdx != NONE)
+        _timers[timer.prevIdx].nextIdx = timer.nextIdx;
+    else
+        _buckets[timer.bucketIdx] = timer.nextIdx;
+    if (timer.nextIdx != NONE)
+        _timers[timer.nextIdx].prevIdx = timer.prevIdx;
+    timer.bucketIdx = NONE;
+    timer.prevIdx = NONE;
+    timer.nextIdx = NONE;
+    _numRunning--;
+}
+
+void RaftWebTimerWheel::cascade(uint32_t level)
+{
+    // Re-insert all timers in the bucket of this level for the current tick (they move to lower levels)
+    uint32_t bucketIdx = level * WHEEL_SLOTS + ((_curTick >> (WHEEL_BITS * level)) & WHEEL_MASK);
+    uint16_t timerIdx = _buckets[bucketIdx];
+    _buckets[bucketIdx] = NONE;
+    while (timerIdx != NONE)
+    {
+        uint16_t nextIdx = _timers[timerIdx].nextIdx;
+        _timers[timerIdx].bucketIdx = NONE;
+        _numRunning--;
+        insert(timerIdx);
+        timerIdx = nextIdx;
+    }
+}
@@ -0,0 +1,96 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <functional>
+#include "RaftArduino.h"
+
+// Hierarchical timer wheel
+// Timers are identified by index (set up in advance so starting, restarting and cancelling a timer
+// don't allocate) and are held in the bucket for their expiry tick. Each level has WHEEL_SLOTS buckets
+// and covers WHEEL_SLOTS times the span of the level below - timers in higher levels are moved down as
+// the wheel turns. Timers further out than the top level are held there and fire early (the owner
+// should check the actual deadline and restart the timer for the remaining time).
+class RaftWebTimerWheel
+{
+public:
+    // Callback for expired timers
+    typedef std::function<void(uint32_t timerIdx, uint32_t nowMs)> ExpiredCB;
+
+    // Setup
+    void setup(uint32_t numTimers, uint32_t nowMs);
+
+    // Start (or restart) a timer
+    void start(uint32_t timerIdx, uint32_t nowMs, uint32_t durationMs);
+
+    // Cancel a timer
+    void cancel(uint32_t timerIdx);
+
+    // Check if a timer is running
+    bool isRunning(uint32_t timerIdx) const
+    {
+        return (timerIdx < _timers.size()) && (_timers[timerIdx].bucketIdx != NONE);
+    }
+
+    // Advance the wheel calling expiredCB for each timer which expires
+    void advance(uint32_t nowMs, const ExpiredCB& expiredCB);
+
+    // Get time until the wheel next needs to be advanced (UINT32_MAX if no timers are running)
+    // This scans the bucket heads so timers in higher levels count from the start of their bucket's
+    // span - the result is never later than the next expiry but may be earlier
+    uint32_t getMsToNextExpiry(uint32_t nowMs) const;
+
+    // Stats
+    uint32_t getNumRunning() const
+    {
+        return _numRunning;
+    }
+    uint32_t getNumExpired() const
+    {
+        return _numExpired;
+    }
+
+private:
+    // Wheel geometry
+    static const uint32_t TICK_MS = 8;
+    static const uint32_t WHEEL_BITS = 6;
+    static const uint32_t WHEEL_SLOTS = 1 << WHEEL_BITS;
+    static const uint32_t WHEEL_MASK = WHEEL_SLOTS - 1;
+    static const uint32_t WHEEL_LEVELS = 3;
+    static const uint16_t NONE = 0xffff;
+
+    // Timers (doubly linked into bucket lists by index)
+    class Timer
+    {
+    public:
+        uint32_t expiryTick = 0;
+        uint16_t bucketIdx = NONE;
+        uint16_t prevIdx = NONE;
+        uint16_t nextIdx = NONE;
+    };
+    std::vector<Timer> _timers;
+
+    // Bucket list heads
+    uint16_t _buckets[WHEEL_LEVELS * WHEEL_SLOTS];
+
+    // Current tick and the time it started (ticks are counted from elapsed time so they are
+    // continuous when millis() wraps)
+    uint32_t _curTick = 0;
+    uint32_t _curTickMs = 0;
+
+    // Stats
+    uint32_t _numRunning = 0;
+    uint32_t _numExpired = 0;
+
+    // Helpers
+    void insert(uint32_t timerIdx);
+    void unlink(uint32_t timerIdx);
+    void cascade(uint32_t level);
+};
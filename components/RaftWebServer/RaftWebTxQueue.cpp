@@ -0,0 +1,135 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Logger.h"
+#include "RaftWebTxQueue.h"
+
+// #define DEBUG_WEB_TX_QUEUE_POLICY
+
+#ifdef DEBUG_WEB_TX_QUEUE_POLICY
+static const char* MODULE_PREFIX = "RaftWebTxQueue";
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Constructor / Destructor
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftWebTxQueue::RaftWebTxQueue(uint32_t maxLen, RaftWebTxQueuePolicy policy)
+{
+    _maxLen = maxLen == 0 ? 1 : maxLen;
+    _policy = policy;
+    RaftMutex_init(_queueMutex);
+}
+
+RaftWebTxQueue::~RaftWebTxQueue()
+{
+    RaftMutex_destroy(_queueMutex);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Put
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebTxQueue::put(const RaftWebDataFrame& frame, uint32_t frameKey, uint32_t maxWaitMs)
+{
+    if (!RaftMutex_lock(_queueMutex, maxWaitMs))
+        return false;
+
+    // Latest-value policy replaces an unsent frame with the same key in place so the
+    // key keeps its position in the queue but only the newest value is sent
+    if (_policy == TX_QUEUE_POLICY_LATEST)
+    {
+        for (TxQueueEntry& entry : _queue)
+        {
+            if (entry.frameKey == frameKey)
+            {
+                entry.frame = frame;
+                _coalescedCount++;
+                RaftMutex_unlock(_queueMutex);
+#ifdef DEBUG_WEB_TX_QUEUE_POLICY
+                LOG_I(MODULE_PREFIX, "put coalesced key %d count %d", frameKey, _coalescedCount);
+#endif
+                return true;
+            }
+        }
+    }
+
+    // Check for full queue
+    if (_queue.size() >= _maxLen)
+    {
+        if (_policy == TX_QUEUE_POLICY_FIFO)
+        {
+            RaftMutex_unlock(_queueMutex);
+            return false;
+        }
+        _queue.pop_front();
+        _droppedCount++;
+#ifdef DEBUG_WEB_TX_QUEUE_POLICY
+        LOG_I(MODULE_PREFIX, "put dropped oldest count %d", _droppedCount);
+#endif
+    }
+
+    // Add to queue
+    _queue.emplace_back(frame, frameKey);
+    RaftMutex_unlock(_queueMutex);
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Get
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebTxQueue::get(RaftWebDataFrame& frame)
+{
+    if (!RaftMutex_lock(_queueMutex, 0))
+        return false;
+    bool isValid = !_queue.empty();
+    if (isValid)
+    {
+        frame = _queue.front().frame;
+        _queue.pop_front();
+    }
+    RaftMutex_unlock(_queueMutex);
+    return isValid;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Count
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebTxQueue::count()
+{
+    if (!RaftMutex_lock(_queueMutex, 0))
+        return 0;
+    uint32_t queueCount = _queue.size();
+    RaftMutex_unlock(_queueMutex);
+    return queueCount;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Policy strings
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftWebTxQueuePolicy RaftWebTxQueue::getPolicyFromStr(const String& policyStr)
+{
+    if (policyStr.equalsIgnoreCase("dropOldest"))
+        return TX_QUEUE_POLICY_DROP_OLDEST;
+    if (policyStr.equalsIgnoreCase("latest"))
+        return TX_QUEUE_POLICY_LATEST;
+    return TX_QUEUE_POLICY_FIFO;
+}
+
+const char* RaftWebTxQueue::getPolicyStr(RaftWebTxQueuePolicy policy)
+{
+    switch(policy)
+    {
+        case TX_QUEUE_POLICY_DROP_OLDEST: return "dropOldest";
+        case TX_QUEUE_POLICY_LATEST: return "latest";
+        default: return "fifo";
+    }
+}
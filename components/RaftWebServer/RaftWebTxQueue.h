@@ -0,0 +1,93 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <list>
+#include "RaftArduino.h"
+#include "RaftThreading.h"
+#include "RaftWebDataFrame.h"
+
+// Policy applied when frames are added to a websocket tx queue
+enum RaftWebTxQueuePolicy
+{
+    // Reject new frames when the queue is full
+    TX_QUEUE_POLICY_FIFO,
+    // Discard the oldest frame to make room for a new one
+    TX_QUEUE_POLICY_DROP_OLDEST,
+    // Replace an unsent frame with the same key (latest-value), else drop oldest when full
+    // (needs a key per frame - for websockets set txKeyLen in config or use setTxKeyFn)
+    TX_QUEUE_POLICY_LATEST
+};
+
+class RaftWebTxQueue
+{
+public:
+    RaftWebTxQueue(uint32_t maxLen, RaftWebTxQueuePolicy policy);
+    virtual ~RaftWebTxQueue();
+
+    // Add a frame - returns false if the frame could not be queued
+    bool put(const RaftWebDataFrame& frame, uint32_t frameKey, uint32_t maxWaitMs);
+
+    // Get the frame at the head of the queue
+    bool get(RaftWebDataFrame& frame);
+
+    // Count of frames queued
+    uint32_t count();
+
+    // Max length
+    uint32_t maxLen() const
+    {
+        return _maxLen;
+    }
+
+    // Policy
+    RaftWebTxQueuePolicy getPolicy() const
+    {
+        return _policy;
+    }
+
+    // Stats
+    uint32_t getDroppedCount() const
+    {
+        return _droppedCount;
+    }
+    uint32_t getCoalescedCount() const
+    {
+        return _coalescedCount;
+    }
+
+    // Policy from/to string (as used in websocket config)
+    static RaftWebTxQueuePolicy getPolicyFromStr(const String& policyStr);
+    static const char* getPolicyStr(RaftWebTxQueuePolicy policy);
+
+private:
+    // Queued frame and its key
+    class TxQueueEntry
+    {
+    public:
+        TxQueueEntry(const RaftWebDataFrame& frame, uint32_t frameKey)
+            : frame(frame), frameKey(frameKey)
+        {
+        }
+        RaftWebDataFrame frame;
+        uint32_t frameKey;
+    };
+    std::list<TxQueueEntry> _queue;
+
+    // Settings
+    uint32_t _maxLen = 0;
+    RaftWebTxQueuePolicy _policy = TX_QUEUE_POLICY_FIFO;
+
+    // Stats
+    uint32_t _droppedCount = 0;
+    uint32_t _coalescedCount = 0;
+
+    // Mutex for queue access
+    RaftMutex _queueMutex;
+};
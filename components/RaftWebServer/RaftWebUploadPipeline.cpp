@@ -0,0 +1,397 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <new>
+#include "Logger.h"
+#include "RaftUtils.h"
+#include "ArduinoTime.h"
+#include "FileStreamBlock.h"
+#include "RaftWebUploadPipeline.h"
+
+// Warn
+#define WARN_ON_UPLOAD_PIPELINE_SETUP_FAIL
+#define WARN_ON_UPLOAD_WRITE_FAIL
+#define WARN_ON_UPLOAD_NO_BUFFER
+
+// Debug
+// #define DEBUG_UPLOAD_PIPELINE
+// #define DEBUG_UPLOAD_PIPELINE_WRITES
+
+static const char* MODULE_PREFIX = "RaftWebUpload";
+
+// Statics
+uint32_t* RaftWebUploadPipeline::_pPoolMem = nullptr;
+std::vector<uint8_t*> RaftWebUploadPipeline::_freeList;
+uint32_t RaftWebUploadPipeline::_numBuffers = 0;
+uint32_t RaftWebUploadPipeline::_bufferBytes = RaftWebUploadPipeline::DEFAULT_BUFFER_BYTES;
+RaftMutex RaftWebUploadPipeline::_poolMutex;
+ThreadSafeQueue<RaftWebUploadPipeline::WriteJob> RaftWebUploadPipeline::_writeQueue;
+RaftThreadHandle RaftWebUploadPipeline::_writerTaskHandle = RAFT_THREAD_HANDLE_INVALID;
+uint32_t RaftWebUploadPipeline::_writeCount = 0;
+uint32_t RaftWebUploadPipeline::_writeBytes = 0;
+uint32_t RaftWebUploadPipeline::_writeMaxUs = 0;
+uint32_t RaftWebUploadPipeline::_writeFailCount = 0;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Setup
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebUploadPipeline::setup(uint32_t numBuffers, uint32_t bufferBytes)
+{
+    if ((_numBuffers > 0) || (numBuffers == 0))
+        return;
+
+    // Buffers are word aligned and a whole number of words
+    if (bufferBytes < MIN_BUFFER_BYTES)
+        bufferBytes = MIN_BUFFER_BYTES;
+    uint32_t bufferWords = (bufferBytes + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    _pPoolMem = new (std::nothrow) uint32_t[numBuffers * bufferWords];
+    if (!_pPoolMem)
+    {
+#ifdef WARN_ON_UPLOAD_PIPELINE_SETUP_FAIL
+        LOG_W(MODULE_PREFIX, "setup failed to allocate %d buffers of %d bytes", numBuffers, bufferBytes);
+#endif
+        return;
+    }
+    RaftMutex_init(_poolMutex);
+    _bufferBytes = bufferWords * sizeof(uint32_t);
+    _freeList.reserve(numBuffers);
+    for (uint32_t i = 0; i < numBuffers; i++)
+        _freeList.push_back((uint8_t*)(_pPoolMem + i * bufferWords));
+
+    // Queue can hold every buffer plus a final (empty) block for each
+    _writeQueue.setMaxLen(numBuffers * 2);
+    _numBuffers = numBuffers;
+
+    // Start writer task
+    RaftThread_start(_writerTaskHandle, &writerTask, nullptr,
+            WRITER_TASK_STACK_BYTES, "uploadWriter", WRITER_TASK_PRIORITY, WRITER_TASK_CORE, false);
+
+#ifdef DEBUG_UPLOAD_PIPELINE
+    LOG_I(MODULE_PREFIX, "setup numBuffers %d bufferBytes %d", numBuffers, _bufferBytes);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Buffers
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t RaftWebUploadPipeline::getNumFree()
+{
+    if (!isEnabled() || !RaftMutex_lock(_poolMutex, 0))
+        return 0;
+    uint32_t numFree = _freeList.size();
+    RaftMutex_unlock(_poolMutex);
+    return numFree;
+}
+
+uint8_t* RaftWebUploadPipeline::allocBuffer()
+{
+    if (!isEnabled())
+        return nullptr;
+    uint8_t* pBuf = nullptr;
+    if (RaftMutex_lock(_poolMutex, RAFT_MUTEX_WAIT_FOREVER))
+    {
+        if (!_freeList.empty())
+        {
+            pBuf = _freeList.back();
+            _freeList.pop_back();
+        }
+        RaftMutex_unlock(_poolMutex);
+    }
+    return pBuf;
+}
+
+void RaftWebUploadPipeline::freeBuffer(uint8_t* pBuf)
+{
+    if (!pBuf)
+        return;
+    RaftMutex_lock(_poolMutex, RAFT_MUTEX_WAIT_FOREVER);
+    _freeList.push_back(pBuf);
+    RaftMutex_unlock(_poolMutex);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Queue a write
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebUploadPipeline::queueWrite(const WriteJob& job)
+{
+    job.pStatus->pendingWrites++;
+    if (!_writeQueue.put(job, RAFT_MUTEX_WAIT_FOREVER))
+    {
+        job.pStatus->pendingWrites--;
+        freeBuffer(job.pBuf);
+        return false;
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Writer task
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebUploadPipeline::writerTask(void* pArg)
+{
+    while (true)
+    {
+        WriteJob job;
+        if (!_writeQueue.get(job))
+        {
+            RaftThread_sleep(WRITER_IDLE_SLEEP_MS);
+            continue;
+        }
+
+        // Writes after a failure in the same upload are discarded
+        if (job.pStatus->result == RAFT_OK)
+        {
+            FileStreamBlock fileStreamBlock(job.fileInfo._fileName.c_str(),
+                        job.contentLen, job.filePos,
+                        job.pBuf, job.bufLen, job.isFinal, job.fileInfo._crc16, job.fileInfo._crc16Valid,
+                        job.fileInfo._fileLenBytes, job.fileInfo._fileLenValid, job.filePos == 0);
+            uint64_t startUs = micros();
+            RaftRetCode retCode = job.chunkFn ? job.chunkFn(job.reqStr, fileStreamBlock, job.sourceInfo) : RAFT_NOT_IMPLEMENTED;
+            uint32_t elapsedUs = Raft::timeElapsed(micros(), startUs);
+            _writeCount++;
+            _writeBytes += job.bufLen;
+            if (elapsedUs > _writeMaxUs)
+                _writeMaxUs = elapsedUs;
+            if (retCode != RAFT_OK)
+            {
+                job.pStatus->result = retCode;
+                _writeFailCount++;
+#ifdef WARN_ON_UPLOAD_WRITE_FAIL
+                LOG_W(MODULE_PREFIX, "writerTask filename %s pos %d len %d failed retc %d",
+                            job.fileInfo._fileName.c_str(), job.filePos, job.bufLen, retCode);
+#endif
+            }
+#ifdef DEBUG_UPLOAD_PIPELINE_WRITES
+            LOG_I(MODULE_PREFIX, "writerTask pos %d len %d final %d took %dus retc %d",
+                        job.filePos, job.bufLen, job.isFinal, elapsedUs, retCode);
+#endif
+        }
+
+        // Release buffer
+        freeBuffer(job.pBuf);
+        job.pStatus->pendingWrites--;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stats
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+String RaftWebUploadPipeline::getStatsJSON()
+{
+    return "{\"free\":" + String(getNumFree()) +
+            ",\"total\":" + String(_numBuffers) +
+            ",\"bufBytes\":" + String(_bufferBytes) +
+            ",\"writes\":" + String(_writeCount) +
+            ",\"bytes\":" + String(_writeBytes) +
+            ",\"maxWriteUs\":" + String(_writeMaxUs) +
+            ",\"fails\":" + String(_writeFailCount) + "}";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Upload stream
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftWebUploadStream::RaftWebUploadStream()
+    : _pStatus(std::make_shared<RaftWebUploadStatus>())
+{
+}
+
+RaftWebUploadStream::~RaftWebUploadStream()
+{
+    RaftWebUploadPipeline::freeBuffer(_curJob.pBuf);
+}
+
+void RaftWebUploadStream::begin(const RaftWebAPIFnChunk& chunkFn, const String& reqStr,
+            const APISourceInfo& sourceInfo, uint32_t contentLen)
+{
+    _curJob.chunkFn = chunkFn;
+    _curJob.reqStr = reqStr;
+    _curJob.sourceInfo = sourceInfo;
+    _curJob.contentLen = contentLen;
+    _curJob.pStatus = _pStatus;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Add data
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftRetCode RaftWebUploadStream::addData(const uint8_t* pBuf, uint32_t bufLen, const RaftMultipartForm& fileInfo,
+            uint32_t filePos, bool isFinal)
+{
+    // Check for an earlier failure
+    if (getResult() != RAFT_OK)
+        return getResult();
+
+    // Data must be written in order so if data is already held this is held too
+    if (!_pendingData.empty())
+        return holdData(pBuf, bufLen, fileInfo, filePos, isFinal);
+
+    // Write into buffers and hold anything which doesn't fit
+    uint32_t bytesUsed = 0;
+    RaftRetCode retCode = writeToBuffers(pBuf, bufLen, fileInfo, filePos, isFinal, bytesUsed);
+    if (retCode == RAFT_BUSY)
+        return holdData(pBuf + bytesUsed, bufLen - bytesUsed, fileInfo, filePos + bytesUsed, isFinal);
+    return retCode;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Service - move held data into buffers as they become free
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebUploadStream::service()
+{
+    while (!_pendingData.empty() && (getResult() == RAFT_OK))
+    {
+        PendingData& pending = _pendingData.front();
+        uint32_t bytesUsed = 0;
+        RaftRetCode retCode = writeToBuffers(pending.data.data(), pending.data.size(), pending.fileInfo,
+                    pending.filePos, pending.isFinal, bytesUsed);
+        _pendingBytes -= bytesUsed;
+        if (retCode == RAFT_BUSY)
+        {
+            pending.data.erase(pending.data.begin(), pending.data.begin() + bytesUsed);
+            pending.filePos += bytesUsed;
+            return;
+        }
+        _pendingData.pop_front();
+    }
+
+    // After a failure held data is discarded
+    if (getResult() != RAFT_OK)
+    {
+        _pendingData.clear();
+        _pendingBytes = 0;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Check if more data can be accepted
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebUploadStream::canAccept() const
+{
+    // After a failure data is discarded so always accept
+    if (getResult() != RAFT_OK)
+        return true;
+    if (!_pendingData.empty())
+        return false;
+    uint32_t spaceInCur = _curJob.pBuf ? RaftWebUploadPipeline::getBufferBytes() - _curJob.bufLen : 0;
+    return (spaceInCur >= RaftWebUploadPipeline::MIN_BUFFER_BYTES) || (RaftWebUploadPipeline::getNumFree() > 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Write data into buffers queueing each as it fills
+// Returns RAFT_BUSY if no buffer is free (bytesUsed is the number of bytes written)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftRetCode RaftWebUploadStream::writeToBuffers(const uint8_t* pBuf, uint32_t bufLen, const RaftMultipartForm& fileInfo,
+            uint32_t filePos, bool isFinal, uint32_t& bytesUsed)
+{
+    bytesUsed = 0;
+
+    // A new file (e.g. next multipart part) starts a new buffer - the current buffer is queued
+    // with the info of the file that filled it
+    if (_curJob.pBuf && (filePos != _curJobEndPos))
+    {
+        if (!queueCurJob(false))
+            return RAFT_OTHER_FAILURE;
+    }
+
+    // Copy data into buffers queueing each as it fills
+    uint32_t bufferBytes = RaftWebUploadPipeline::getBufferBytes();
+    while (bytesUsed < bufLen)
+    {
+        if (!_curJob.pBuf)
+        {
+            _curJob.pBuf = RaftWebUploadPipeline::allocBuffer();
+            if (!_curJob.pBuf)
+                return RAFT_BUSY;
+            _curJob.filePos = filePos;
+            _curJob.bufLen = 0;
+        }
+        _curJob.fileInfo = fileInfo;
+        uint32_t toCopy = bufferBytes - _curJob.bufLen;
+        if (toCopy > bufLen - bytesUsed)
+            toCopy = bufLen - bytesUsed;
+        memcpy(_curJob.pBuf + _curJob.bufLen, pBuf + bytesUsed, toCopy);
+        _curJob.bufLen += toCopy;
+        bytesUsed += toCopy;
+        filePos += toCopy;
+        _curJobEndPos = filePos;
+        if (_curJob.bufLen == bufferBytes)
+        {
+            bool lastOfFinal = isFinal && (bytesUsed == bufLen);
+            if (!queueCurJob(lastOfFinal))
+                return RAFT_OTHER_FAILURE;
+            if (lastOfFinal)
+                return RAFT_OK;
+        }
+    }
+
+    // Final block (may have no data if the previous buffer ended exactly at the end)
+    if (isFinal)
+    {
+        if (!_curJob.pBuf)
+        {
+            _curJob.filePos = filePos;
+            _curJob.bufLen = 0;
+        }
+        _curJob.fileInfo = fileInfo;
+        if (!queueCurJob(true))
+            return RAFT_OTHER_FAILURE;
+    }
+    return RAFT_OK;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Hold data until a buffer is free
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RaftRetCode RaftWebUploadStream::holdData(const uint8_t* pBuf, uint32_t bufLen, const RaftMultipartForm& fileInfo,
+            uint32_t filePos, bool isFinal)
+{
+    if (_pendingBytes + bufLen > MAX_PENDING_BYTES)
+    {
+#ifdef WARN_ON_UPLOAD_NO_BUFFER
+        LOG_W(MODULE_PREFIX, "holdData no buffer available pos %d held %d", filePos, _pendingBytes);
+#endif
+        _pStatus->result = RAFT_INSUFFICIENT_RESOURCE;
+        return RAFT_INSUFFICIENT_RESOURCE;
+    }
+    _pendingData.emplace_back();
+    PendingData& pending = _pendingData.back();
+    pending.data.assign(pBuf, pBuf + bufLen);
+    pending.fileInfo = fileInfo;
+    pending.filePos = filePos;
+    pending.isFinal = isFinal;
+    _pendingBytes += bufLen;
+#ifdef DEBUG_UPLOAD_PIPELINE
+    LOG_I(MODULE_PREFIX, "holdData pos %d len %d held %d", filePos, bufLen, _pendingBytes);
+#endif
+    return RAFT_OK;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Queue the current buffer for writing
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebUploadStream::queueCurJob(bool isFinal)
+{
+    _curJob.isFinal = isFinal;
+    bool queuedOk = RaftWebUploadPipeline::queueWrite(_curJob);
+    _curJob.pBuf = nullptr;
+    _curJob.bufLen = 0;
+    if (!queuedOk)
+        _pStatus->result = RAFT_OTHER_FAILURE;
+    return queuedOk;
+}
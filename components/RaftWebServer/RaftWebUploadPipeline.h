@@ -0,0 +1,174 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <vector>
+#include "RaftArduino.h"
+#include "RaftRetCode.h"
+#include "RaftThreading.h"
+#include "ThreadSafeQueue.h"
+#include "SpiramAwareAllocator.h"
+#include "RaftWebInterface.h"
+#include "RaftWebMultipart.h"
+#include "APISourceInfo.h"
+
+// Status shared between an upload stream and the writes it has queued (the stream may be
+// deleted, e.g. if the connection drops, while writes are still queued)
+class RaftWebUploadStatus
+{
+public:
+    std::atomic<uint32_t> pendingWrites{0};
+    std::atomic<int> result{RAFT_OK};
+};
+
+// Upload pipeline - a pool of word-aligned write buffers (ideally sized to flash sectors) and a
+// writer task which passes filled buffers to the endpoint's chunk callback. The connection keeps
+// receiving into the next buffer while the previous one is being written and only applies
+// backpressure when all buffers are full.
+class RaftWebUploadPipeline
+{
+public:
+    // Setup - numBuffers == 0 disables the pipeline (chunks are handled synchronously)
+    static void setup(uint32_t numBuffers, uint32_t bufferBytes);
+
+    // Check enabled
+    static bool isEnabled()
+    {
+        return _numBuffers > 0;
+    }
+
+    // Buffers
+    static uint32_t getBufferBytes()
+    {
+        return _bufferBytes;
+    }
+    static uint32_t getNumBuffers()
+    {
+        return _numBuffers;
+    }
+    static uint32_t getNumFree();
+    static uint8_t* allocBuffer();
+    static void freeBuffer(uint8_t* pBuf);
+
+    // Write job
+    class WriteJob
+    {
+    public:
+        RaftWebAPIFnChunk chunkFn;
+        String reqStr;
+        APISourceInfo sourceInfo = APISourceInfo(0);
+        RaftMultipartForm fileInfo;
+        uint32_t contentLen = 0;
+        uint32_t filePos = 0;
+        uint8_t* pBuf = nullptr;
+        uint32_t bufLen = 0;
+        bool isFinal = false;
+        std::shared_ptr<RaftWebUploadStatus> pStatus;
+    };
+
+    // Queue a write - the job owns the buffer from this point
+    static bool queueWrite(const WriteJob& job);
+
+    // Stats
+    static String getStatsJSON();
+
+    // Smallest buffer size - must be larger than a single receive from the socket
+    // (plus multipart boundary carry-over) so that a free buffer always has room
+    static const uint32_t MIN_BUFFER_BYTES = 2048;
+    static const uint32_t DEFAULT_BUFFER_BYTES = 4096;
+
+private:
+    // Buffers
+    static uint32_t* _pPoolMem;
+    static std::vector<uint8_t*> _freeList;
+    static uint32_t _numBuffers;
+    static uint32_t _bufferBytes;
+    static RaftMutex _poolMutex;
+
+    // Writer
+    static ThreadSafeQueue<WriteJob> _writeQueue;
+    static RaftThreadHandle _writerTaskHandle;
+    static void writerTask(void* pArg);
+    static const uint32_t WRITER_TASK_STACK_BYTES = 6000;
+    static const uint32_t WRITER_TASK_PRIORITY = 5;
+    static const uint32_t WRITER_TASK_CORE = 0;
+    static const uint32_t WRITER_IDLE_SLEEP_MS = 1;
+
+    // Stats
+    static uint32_t _writeCount;
+    static uint32_t _writeBytes;
+    static uint32_t _writeMaxUs;
+    static uint32_t _writeFailCount;
+};
+
+// Upload stream - collects the data of a single upload into pipeline buffers
+class RaftWebUploadStream
+{
+public:
+    RaftWebUploadStream();
+    ~RaftWebUploadStream();
+
+    // Begin an upload
+    void begin(const RaftWebAPIFnChunk& chunkFn, const String& reqStr, const APISourceInfo& sourceInfo,
+                uint32_t contentLen);
+
+    // Add data - queues buffers for writing as they fill (and on the final block) - data which
+    // arrives when no buffer is free is held until the writer frees one (see service())
+    RaftRetCode addData(const uint8_t* pBuf, uint32_t bufLen, const RaftMultipartForm& fileInfo,
+                uint32_t filePos, bool isFinal);
+
+    // Service - moves held data into buffers as they are freed (call regularly, never blocks)
+    void service();
+
+    // Check if more data can be accepted without waiting
+    bool canAccept() const;
+
+    // Check if writes (or held data) are still pending
+    bool isBusy() const
+    {
+        return (_pStatus->pendingWrites > 0) || !_pendingData.empty();
+    }
+
+    // Result of writes so far
+    RaftRetCode getResult() const
+    {
+        return (RaftRetCode)_pStatus->result.load();
+    }
+
+private:
+    std::shared_ptr<RaftWebUploadStatus> _pStatus;
+    RaftWebUploadPipeline::WriteJob _curJob;
+    uint32_t _curJobEndPos = 0;
+
+    // Data received when no buffer was free (in order of arrival)
+    class PendingData
+    {
+    public:
+        std::vector<uint8_t, SpiramAwareAllocator<uint8_t>> data;
+        RaftMultipartForm fileInfo;
+        uint32_t filePos = 0;
+        bool isFinal = false;
+    };
+    std::list<PendingData> _pendingData;
+    uint32_t _pendingBytes = 0;
+
+    // Max data held - the connection stops reading (and body decoding pauses) while data is held so
+    // this only needs to cover the data from a single receive or decoded block
+    static const uint32_t MAX_PENDING_BYTES = 16384;
+
+    // Helpers
+    RaftRetCode writeToBuffers(const uint8_t* pBuf, uint32_t bufLen, const RaftMultipartForm& fileInfo,
+                uint32_t filePos, bool isFinal, uint32_t& bytesUsed);
+    RaftRetCode holdData(const uint8_t* pBuf, uint32_t bufLen, const RaftMultipartForm& fileInfo,
+                uint32_t filePos, bool isFinal);
+    bool queueCurJob(bool isFinal);
+};
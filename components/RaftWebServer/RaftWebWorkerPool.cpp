@@ -0,0 +1,192 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "Logger.h"
+#include "RaftUtils.h"
+#include "ArduinoTime.h"
+#include "RaftWebWorkerPool.h"
+
+// Warn
+#define WARN_ON_WORKER_QUEUE_FULL
+
+// Debug
+// #define DEBUG_WORKER_POOL
+// #define DEBUG_WORKER_POOL_JOBS
+
+#if defined(WARN_ON_WORKER_QUEUE_FULL) || defined(DEBUG_WORKER_POOL) || defined(DEBUG_WORKER_POOL_JOBS)
+static const char* MODULE_PREFIX = "RaftWebWorkers";
+#endif
+
+// Statics
+const uint16_t RaftWebWorkerPool::HIST_BUCKET_LIMITS_MS[NUM_HIST_BUCKETS - 1] = { 1, 2, 5, 10, 20, 50, 100, 200, 500 };
+uint32_t RaftWebWorkerPool::_numWorkers = 0;
+ThreadSafeQueue<RaftWebWorkerPool::Job> RaftWebWorkerPool::_jobQueue;
+std::vector<RaftWebWorkerPool::EndpointStats> RaftWebWorkerPool::_endpointStats;
+RaftMutex RaftWebWorkerPool::_statsMutex;
+uint32_t RaftWebWorkerPool::_rejectCount = 0;
+uint32_t RaftWebWorkerPool::_expiredCount = 0;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Setup
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebWorkerPool::setup(uint32_t numWorkers, uint32_t queueDepth, uint32_t taskCore,
+            uint32_t taskPriority, uint32_t taskStackBytes)
+{
+    if ((_numWorkers > 0) || (numWorkers == 0))
+        return;
+    RaftMutex_init(_statsMutex);
+    _jobQueue.setMaxLen(queueDepth > 0 ? queueDepth : 1);
+    _numWorkers = numWorkers;
+
+    // Start workers
+    for (uint32_t i = 0; i < numWorkers; i++)
+    {
+        RaftThreadHandle workerHandle = RAFT_THREAD_HANDLE_INVALID;
+        String taskName = "restWorker" + String(i);
+        RaftThread_start(workerHandle, &workerTask, nullptr,
+                taskStackBytes, taskName.c_str(), taskPriority, taskCore, false);
+    }
+
+#ifdef DEBUG_WORKER_POOL
+    LOG_I(MODULE_PREFIX, "setup numWorkers %d queueDepth %d core %d priority %d stack %d",
+                numWorkers, queueDepth, taskCore, taskPriority, taskStackBytes);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Queue job
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RaftWebWorkerPool::queueJob(const RaftWebAPIFunction& restApiFn, const String& reqStr,
+            const APISourceInfo& sourceInfo, RaftWebDeferredHandle handle)
+{
+    Job job;
+    job.restApiFn = restApiFn;
+    job.reqStr = reqStr;
+    job.sourceInfo = sourceInfo;
+    job.handle = handle;
+    if (!_jobQueue.put(job))
+    {
+        _rejectCount++;
+#ifdef WARN_ON_WORKER_QUEUE_FULL
+        LOG_W(MODULE_PREFIX, "queueJob queue full rejecting %s", reqStr.c_str());
+#endif
+        return false;
+    }
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Worker task
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebWorkerPool::workerTask(void* pArg)
+{
+    while (true)
+    {
+        Job job;
+        if (!_jobQueue.get(job))
+        {
+            RaftThread_sleep(WORKER_IDLE_SLEEP_MS);
+            continue;
+        }
+
+        // Requests which timed out (or whose connection closed) while queued are dropped
+        if (job.handle->isAbandoned())
+        {
+            _expiredCount++;
+            continue;
+        }
+
+        // Call endpoint and complete the response
+        String respStr;
+        uint64_t startUs = micros();
+        job.restApiFn(job.reqStr, respStr, job.sourceInfo);
+        uint32_t elapsedUs = Raft::timeElapsed(micros(), startUs);
+        job.handle->complete(respStr);
+        recordExecTime(job.reqStr, elapsedUs);
+
+#ifdef DEBUG_WORKER_POOL_JOBS
+        LOG_I(MODULE_PREFIX, "workerTask %s took %dus respLen %d", job.reqStr.c_str(), elapsedUs, respStr.length());
+#endif
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stats
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RaftWebWorkerPool::recordExecTime(const String& reqStr, uint32_t elapsedUs)
+{
+    String name = RaftWebInterface::getEndpointName(reqStr);
+
+    // Histogram bucket
+    uint32_t elapsedMs = elapsedUs / 1000;
+    uint32_t bucketIdx = 0;
+    while ((bucketIdx < NUM_HIST_BUCKETS - 1) && (elapsedMs >= HIST_BUCKET_LIMITS_MS[bucketIdx]))
+        bucketIdx++;
+
+    // Find (or add) endpoint - once the table is full further endpoints share the last entry
+    if (!RaftMutex_lock(_statsMutex, RAFT_MUTEX_WAIT_FOREVER))
+        return;
+    EndpointStats* pStats = nullptr;
+    for (EndpointStats& stats : _endpointStats)
+    {
+        if (stats.name.equals(name))
+        {
+            pStats = &stats;
+            break;
+        }
+    }
+    if (!pStats)
+    {
+        if (_endpointStats.size() < MAX_ENDPOINT_STATS)
+        {
+            _endpointStats.push_back(EndpointStats());
+            _endpointStats.back().name = _endpointStats.size() < MAX_ENDPOINT_STATS ? name : String("other");
+        }
+        pStats = &_endpointStats.back();
+    }
+    pStats->count++;
+    pStats->totalUs += elapsedUs;
+    if (elapsedUs > pStats->maxUs)
+        pStats->maxUs = elapsedUs;
+    pStats->hist[bucketIdx]++;
+    RaftMutex_unlock(_statsMutex);
+}
+
+String RaftWebWorkerPool::getStatsJSON()
+{
+    String endpointsStr;
+    if (isEnabled() && RaftMutex_lock(_statsMutex, RAFT_MUTEX_WAIT_FOREVER))
+    {
+        for (const EndpointStats& stats : _endpointStats)
+        {
+            String histStr;
+            for (uint32_t i = 0; i < NUM_HIST_BUCKETS; i++)
+                histStr += String(i == 0 ? "" : ",") + String(stats.hist[i]);
+            endpointsStr += String(endpointsStr.length() == 0 ? "" : ",") +
+                    "{\"name\":\"" + stats.name + "\"" +
+                    ",\"n\":" + String(stats.count) +
+                    ",\"avgUs\":" + String(stats.count > 0 ? (uint32_t)(stats.totalUs / stats.count) : 0) +
+                    ",\"maxUs\":" + String(stats.maxUs) +
+                    ",\"hist\":[" + histStr + "]}";
+        }
+        RaftMutex_unlock(_statsMutex);
+    }
+    String limitsStr;
+    for (uint32_t i = 0; i < NUM_HIST_BUCKETS - 1; i++)
+        limitsStr += String(i == 0 ? "" : ",") + String(HIST_BUCKET_LIMITS_MS[i]);
+    return "{\"workers\":" + String(_numWorkers) +
+            ",\"queued\":" + String(_jobQueue.count()) +
+            ",\"rejects\":" + String(_rejectCount) +
+            ",\"expired\":" + String(_expiredCount) +
+            ",\"histMs\":[" + limitsStr + "]" +
+            ",\"endpoints\":[" + endpointsStr + "]}";
+}
@@ -0,0 +1,80 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// RaftWebServer
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include "RaftArduino.h"
+#include "RaftRetCode.h"
+#include "RaftThreading.h"
+#include "ThreadSafeQueue.h"
+#include "RaftWebInterface.h"
+#include "RaftWebDeferred.h"
+#include "APISourceInfo.h"
+
+// Worker pool for REST API endpoints - endpoint functions (which build the response synchronously) are
+// run on worker tasks and their responses delivered through a deferred response handle so that the
+// connection service task isn't blocked. When the queue is full the request is rejected (503).
+class RaftWebWorkerPool
+{
+public:
+    // Setup - numWorkers == 0 disables the pool (endpoints are called on the connection task)
+    static void setup(uint32_t numWorkers, uint32_t queueDepth, uint32_t taskCore,
+                uint32_t taskPriority, uint32_t taskStackBytes);
+
+    // Check enabled
+    static bool isEnabled()
+    {
+        return _numWorkers > 0;
+    }
+
+    // Queue endpoint call - returns false if the queue is full
+    static bool queueJob(const RaftWebAPIFunction& restApiFn, const String& reqStr,
+                const APISourceInfo& sourceInfo, RaftWebDeferredHandle handle);
+
+    // Stats (including per-endpoint execution time histograms)
+    static String getStatsJSON();
+
+    // Histogram bucket upper limits (ms) - the last bucket counts anything longer
+    static const uint32_t NUM_HIST_BUCKETS = 10;
+    static const uint16_t HIST_BUCKET_LIMITS_MS[NUM_HIST_BUCKETS - 1];
+
+private:
+    // Job
+    class Job
+    {
+    public:
+        RaftWebAPIFunction restApiFn;
+        String reqStr;
+        APISourceInfo sourceInfo = APISourceInfo(0);
+        RaftWebDeferredHandle handle;
+    };
+
+    // Workers
+    static uint32_t _numWorkers;
+    static ThreadSafeQueue<Job> _jobQueue;
+    static void workerTask(void* pArg);
+    static const uint32_t WORKER_IDLE_SLEEP_MS = 1;
+
+    // Stats for each endpoint
+    class EndpointStats
+    {
+    public:
+        String name;
+        uint32_t count = 0;
+        uint32_t maxUs = 0;
+        uint64_t totalUs = 0;
+        uint32_t hist[NUM_HIST_BUCKETS] = {};
+    };
+    static std::vector<EndpointStats> _endpointStats;
+    static const uint32_t MAX_ENDPOINT_STATS = 16;
+    static RaftMutex _statsMutex;
+    static uint32_t _rejectCount;
+    static uint32_t _expiredCount;
+    static void recordExecTime(const String& reqStr, uint32_t elapsedUs);
+};
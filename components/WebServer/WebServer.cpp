@@ -10,6 +10,7 @@
 #include "WebServerResource.h"
 #include "Logger.h"
 #include "RaftUtils.h"
+#include "RaftJson.h"
 #include "RestAPIEndpointManager.h"
 #ifdef ESP_PLATFORM
 #include "NetworkSystem.h"
@@ -21,6 +22,7 @@
 #include "RaftWebHandlerStaticFiles.h"
 #include "RaftWebHandlerRestAPI.h"
 #include "RaftWebHandlerWS.h"
+#include "RaftWebHandlerSSEvents.h"
 
 // This define enables checking of channel connection state for websockets
 // Comment the following to use canSendBufferOnChannel (which gets actual busy state of channel but
@@ -108,6 +110,91 @@ void WebServer::applySetup()
     // Clear pending duration ms
     uint32_t clearPendingDurationMs = configGetLong("clearPendingMs", 0);
 
+    // Websocket frame buffer pool
+    uint32_t framePoolBlocks = configGetLong("wsFrameBufs", RaftWebServerSettings::DEFAULT_FRAME_POOL_BLOCKS);
+    uint32_t framePoolBlockBytes = configGetLong("wsFrameBufBytes", RaftWebServerSettings::DEFAULT_FRAME_POOL_BLOCK_BYTES);
+
+    // Upload pipeline
+    uint32_t uploadPipelineBuffers = configGetLong("uploadBufs", RaftWebServerSettings::DEFAULT_UPLOAD_PIPELINE_BUFFERS);
+    uint32_t uploadPipelineBufferBytes = configGetLong("uploadBufBytes", RaftWebServerSettings::DEFAULT_UPLOAD_PIPELINE_BUFFER_BYTES);
+
+    // Request body decoding window
+    uint32_t bodyDecodeWindowBytes = configGetLong("bodyDecodeWindow", RaftWebServerSettings::DEFAULT_BODY_DECODE_WINDOW_BYTES);
+
+    // REST API response compression - per endpoint levels are in the form {"name":"<endpoint>","level":N}
+    uint32_t respCompressMinBytes = configGetLong("respCompressMinBytes", RaftWebServerSettings::DEFAULT_RESP_COMPRESS_MIN_BYTES);
+    uint32_t respCompressLevel = configGetLong("respCompressLevel", RaftWebServerSettings::DEFAULT_RESP_COMPRESS_LEVEL);
+    std::vector<String> respCompressEndpoints;
+    configGetArrayElems("respCompressEndpoints", respCompressEndpoints);
+    _respCompressEndpointLevels.clear();
+    for (const String& endpointConfig : respCompressEndpoints)
+    {
+        RaftJson endpointJson(endpointConfig);
+        _respCompressEndpointLevels.push_back({endpointJson.getString("name", ""), 
+                    (int)endpointJson.getLong("level", respCompressLevel)});
+    }
+
+    // Deferred REST API response timeout
+    uint32_t deferredTimeoutMs = configGetLong("deferredTimeoutMs", RaftWebServerSettings::DEFAULT_DEFERRED_TIMEOUT_MS);
+
+    // REST API worker pool - restWorkerEndpoints lists the endpoints to run on workers ("*" for all)
+    uint32_t restWorkers = configGetLong("restWorkers", RaftWebServerSettings::DEFAULT_REST_WORKERS);
+    uint32_t restWorkerQueueDepth = configGetLong("restWorkerQueue", RaftWebServerSettings::DEFAULT_REST_WORKER_QUEUE_DEPTH);
+    uint32_t restWorkerCore = configGetLong("restWorkerCore", RaftWebServerSettings::DEFAULT_REST_WORKER_CORE);
+    uint32_t restWorkerPriority = configGetLong("restWorkerPriority", RaftWebServerSettings::DEFAULT_REST_WORKER_PRIORITY);
+    uint32_t restWorkerStackBytes = configGetLong("restWorkerStack", RaftWebServerSettings::DEFAULT_REST_WORKER_STACK_BYTES);
+    _restWorkerEndpoints.clear();
+    configGetArrayElems("restWorkerEndpoints", _restWorkerEndpoints);
+
+    // REST API response cache - GET responses of endpoints defined with ENDPOINT_CACHE_ALWAYS are cached
+    // for respCacheTtlMs, other endpoints can be cached (or TTLs changed) with {"name":"<endpoint>","ttlMs":N}
+    uint32_t respCacheMaxBytes = configGetLong("respCacheMaxBytes", RaftWebServerSettings::DEFAULT_RESP_CACHE_MAX_BYTES);
+    _respCacheTtlMs = configGetLong("respCacheTtlMs", DEFAULT_RESP_CACHE_TTL_MS);
+    std::vector<String> respCacheEndpoints;
+    configGetArrayElems("respCacheEndpoints", respCacheEndpoints);
+    _respCacheEndpointTtls.clear();
+    for (const String& endpointConfig : respCacheEndpoints)
+    {
+        RaftJson endpointJson(endpointConfig);
+        _respCacheEndpointTtls.push_back({endpointJson.getString("name", ""), 
+                    (uint32_t)endpointJson.getLong("ttlMs", _respCacheTtlMs)});
+    }
+
+    // Coalescing of identical REST API GET requests in progress
+    bool restCoalesceGets = configGetBool("restCoalesce", RaftWebServerSettings::DEFAULT_REST_COALESCE_GETS);
+
+    // Admission control for new connections from each client address
+    uint32_t connMaxPerAddr = configGetLong("connMaxPerIP", RaftWebServerSettings::DEFAULT_CONN_MAX_PER_ADDR);
+    uint32_t connRatePerSec = configGetLong("connRatePerSec", RaftWebServerSettings::DEFAULT_CONN_RATE_PER_SEC);
+    uint32_t connRateBurst = configGetLong("connRateBurst", RaftWebServerSettings::DEFAULT_CONN_RATE_BURST);
+
+    // Overload handling - Retry-After sent with 503s when all slots are in use and slots reserved for
+    // websockets and the paths listed in reservedSlotPaths (comma-separated prefixes)
+    uint32_t overloadRetryAfterSecs = configGetLong("overloadRetryAfterSecs", RaftWebServerSettings::DEFAULT_OVERLOAD_RETRY_AFTER_SECS);
+    uint32_t reservedConnSlots = configGetLong("reservedConnSlots", RaftWebServerSettings::DEFAULT_RESERVED_CONN_SLOTS);
+    if (reservedConnSlots >= numConnSlots)
+        reservedConnSlots = numConnSlots > 0 ? numConnSlots - 1 : 0;
+    String reservedSlotPaths = configGetString("reservedSlotPaths", "");
+    uint32_t connEvictMinIdleMs = configGetLong("connEvictMinIdleMs", RaftWebServerSettings::DEFAULT_CONN_EVICT_MIN_IDLE_MS);
+
+    // Slots guaranteed to each class of service (the rest are shared between classes)
+    uint32_t minSlotsWS = configGetLong("minSlotsWS", 0);
+    uint32_t minSlotsSSE = configGetLong("minSlotsSSE", 0);
+    uint32_t minSlotsREST = configGetLong("minSlotsREST", 0);
+    uint32_t minSlotsStatic = configGetLong("minSlotsStatic", 0);
+
+    // Transmit scheduling between connections (weights are relative amounts sent per round when contended)
+    uint32_t txQuantumBytes = configGetLong("txQuantumBytes", RaftWebServerSettings::DEFAULT_TX_QUANTUM_BYTES);
+    uint32_t txWeightREST = configGetLong("txWeightREST", RaftWebServerSettings::DEFAULT_TX_WEIGHT_REST);
+    uint32_t txWeightStatic = configGetLong("txWeightStatic", RaftWebServerSettings::DEFAULT_TX_WEIGHT_STATIC);
+
+    // Bandwidth caps for responses {"type":"FILE"|"handler":"HandlerStaticFiles","bytesPerSec":N,"burst":N,"perConn":0|1}
+    std::vector<String> bandwidthCaps;
+    configGetArrayElems("bwCaps", bandwidthCaps);
+
+    // Time allowed for a new connection to send its request header
+    uint32_t headerTimeoutMs = configGetLong("headerTimeoutMs", RaftWebServerSettings::DEFAULT_HEADER_TIMEOUT_MS);
+
     // Setup server if required
     if (_webServerEnabled)
     {
@@ -118,6 +205,37 @@ void WebServer::applySetup()
                     enableFileServer, taskCore, taskPriority, taskStackSize, sendBufferMaxLen,
                     CommsCoreIF::CHANNEL_ID_REST_API, stdRespHeaders, nullptr, nullptr,
                     clearPendingDurationMs);
+            settings.framePoolBlocks = framePoolBlocks;
+            settings.framePoolBlockBytes = framePoolBlockBytes;
+            settings.uploadPipelineBuffers = uploadPipelineBuffers;
+            settings.uploadPipelineBufferBytes = uploadPipelineBufferBytes;
+            settings.bodyDecodeWindowBytes = bodyDecodeWindowBytes;
+            settings.respCompressMinBytes = respCompressMinBytes;
+            settings.respCompressLevel = respCompressLevel;
+            settings.deferredTimeoutMs = deferredTimeoutMs;
+            settings.restWorkers = restWorkers;
+            settings.restWorkerQueueDepth = restWorkerQueueDepth;
+            settings.restWorkerCore = restWorkerCore;
+            settings.restWorkerPriority = restWorkerPriority;
+            settings.restWorkerStackBytes = restWorkerStackBytes;
+            settings.respCacheMaxBytes = respCacheMaxBytes;
+            settings.restCoalesceGets = restCoalesceGets;
+            settings.connMaxPerAddr = connMaxPerAddr;
+            settings.connRatePerSec = connRatePerSec;
+            settings.connRateBurst = connRateBurst;
+            settings.overloadRetryAfterSecs = overloadRetryAfterSecs;
+            settings.reservedConnSlots = reservedConnSlots;
+            settings.reservedSlotPaths = reservedSlotPaths;
+            settings.connEvictMinIdleMs = connEvictMinIdleMs;
+            settings.minSlotsWS = minSlotsWS;
+            settings.minSlotsSSE = minSlotsSSE;
+            settings.minSlotsREST = minSlotsREST;
+            settings.minSlotsStatic = minSlotsStatic;
+            settings.txQuantumBytes = txQuantumBytes;
+            settings.txWeightREST = txWeightREST;
+            settings.txWeightStatic = txWeightStatic;
+            settings.bandwidthCaps = bandwidthCaps;
+            settings.headerTimeoutMs = headerTimeoutMs;
             _raftWebServer.setup(settings);
         }
 
@@ -174,7 +292,12 @@ void WebServer::addRestAPIEndpoints(RestAPIEndpointManager &endpointManager)
                     std::placeholders::_3, std::placeholders::_4,
                     std::placeholders::_5, std::placeholders::_6),
             nullptr);
-    LOG_I(MODULE_PREFIX, "addRestAPIEndpoints added webcerts API");
+    endpointManager.addEndpoint("webstats", 
+            RestAPIEndpoint::ENDPOINT_CALLBACK, 
+            RestAPIEndpoint::ENDPOINT_GET,
+            std::bind(&WebServer::apiWebStats, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3),
+            "webstats - get web server stats (websocket link RTT, frame pool, topics)");
+    LOG_I(MODULE_PREFIX, "addRestAPIEndpoints added webcerts and webstats APIs");
 
     // Setup endpoints
     setupEndpoints();
@@ -222,6 +345,17 @@ RaftRetCode WebServer::apiWebCertificates(const String &reqStr, String &respStr,
     return RaftRetCode::RAFT_OK;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Get web server stats
+/// @param reqStr request string
+/// @param respStr response string
+/// @param sourceInfo source information
+RaftRetCode WebServer::apiWebStats(const String &reqStr, String &respStr, const APISourceInfo& sourceInfo)
+{
+    String statsJson = _raftWebServer.getStatsJSON();
+    return Raft::setJsonBoolResult(reqStr.c_str(), respStr, true, statsJson.c_str());
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// @brief Set system settings body
 /// @param reqStr request string
@@ -270,6 +404,20 @@ void WebServer::addStaticResource(const WebServerResource *pResource, const char
 {
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Streaming and deferred endpoints
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void WebServer::addStreamingEndpoint(const char* pEndpointName, RaftWebAPIFnStream streamFn)
+{
+    _webEndpoints.push_back({pEndpointName, streamFn, nullptr});
+}
+
+void WebServer::addDeferredEndpoint(const char* pEndpointName, RaftWebAPIFnDeferred deferredFn)
+{
+    _webEndpoints.push_back({pEndpointName, nullptr, deferredFn});
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Static Files
 // 
@@ -304,10 +452,26 @@ void WebServer::serveStaticFiles(const char* servePaths, const char* cacheContro
 
 void WebServer::enableServerSideEvents(const String& eventsURL)
 {
+    // Size of the ring of recent events used to replay events to reconnecting clients
+    uint32_t ringMaxEvents = configGetLong("sseRingEvents", RaftWebSSEventRing::DEFAULT_MAX_EVENTS);
+    uint32_t ringMaxBytes = configGetLong("sseRingBytes", RaftWebSSEventRing::DEFAULT_MAX_BYTES);
+
+    // Max events per second to each subscriber (0 for no limit) - subscribers can ask for a lower rate
+    uint32_t maxEventsPerSec = configGetLong("sseMaxRate", 0);
+
+    // Add handler
+    RaftWebHandlerSSEvents* pHandler = new RaftWebHandlerSSEvents(eventsURL, nullptr, ringMaxEvents, ringMaxBytes,
+                maxEventsPerSec);
+    bool handlerAddOk = _raftWebServer.addHandler(pHandler);
+    LOG_I(MODULE_PREFIX, "enableServerSideEvents url %s ringEvents %d ringBytes %d maxRate %d %s", 
+                eventsURL.c_str(), ringMaxEvents, ringMaxBytes, maxEventsPerSec, handlerAddOk ? "OK" : "FAILED");
+    if (!handlerAddOk)
+        delete pHandler;
 }
 
 void WebServer::sendServerSideEvent(const char* eventContent, const char* eventGroup)
 {
+    _raftWebServer.serverSideEventsSendMsg(eventContent, eventGroup);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -406,6 +570,23 @@ bool WebServer::restAPIMatchEndpoint(const char* url, RaftWebServerMethod method
     if (!getRestAPIEndpointManager())
         return false;
 
+    // Streaming and deferred endpoints are matched on the first element of the path
+    if (_webEndpoints.size() > 0)
+    {
+        const char* pNameStart = url[0] == '/' ? url + 1 : url;
+        uint32_t nameLen = strcspn(pNameStart, "/?");
+        for (const WebEndpoint& webEndpoint : _webEndpoints)
+        {
+            if ((webEndpoint.endpointName.length() == nameLen) && 
+                    (strncmp(webEndpoint.endpointName.c_str(), pNameStart, nameLen) == 0))
+            {
+                endpoint.restApiFnStream = webEndpoint.streamFn;
+                endpoint.restApiFnDeferred = webEndpoint.deferredFn;
+                return true;
+            }
+        }
+    }
+
     // Rest API match
     RestAPIEndpoint::EndpointMethod restAPIMethod = convWebToRESTAPIMethod(method);
     RestAPIEndpoint* pEndpointDef = getRestAPIEndpointManager()->getMatchingEndpoint(url, restAPIMethod, false);
@@ -415,6 +596,31 @@ bool WebServer::restAPIMatchEndpoint(const char* url, RaftWebServerMethod method
         endpoint.restApiFnBody = pEndpointDef->_callbackBody;
         endpoint.restApiFnChunk = pEndpointDef->_callbackChunk;
         endpoint.restApiFnIsReady = pEndpointDef->_callbackIsReady;
+        for (const RespCompressEndpointLevel& endpointLevel : _respCompressEndpointLevels)
+        {
+            if (endpointLevel.endpointName.equals(pEndpointDef->_endpointStr))
+            {
+                endpoint.compressLevel = endpointLevel.level;
+                break;
+            }
+        }
+        endpoint.cacheTtlMs = (pEndpointDef->_cache == RestAPIEndpoint::ENDPOINT_CACHE_ALWAYS) ? _respCacheTtlMs : 0;
+        for (const RespCacheEndpointTtl& endpointTtl : _respCacheEndpointTtls)
+        {
+            if (endpointTtl.endpointName.equals(pEndpointDef->_endpointStr))
+            {
+                endpoint.cacheTtlMs = endpointTtl.ttlMs;
+                break;
+            }
+        }
+        for (const String& workerEndpoint : _restWorkerEndpoints)
+        {
+            if (workerEndpoint.equals("*") || workerEndpoint.equals(pEndpointDef->_endpointStr))
+            {
+                endpoint.runOnWorker = true;
+                break;
+            }
+        }
         return true;
     }
     return false;
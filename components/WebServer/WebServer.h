@@ -17,6 +17,7 @@ class WebServerResource;
 class CommsChannelMsg;
 
 #include "RaftWebServer.h"
+#include "RaftWebRespCache.h"
 
 class WebServer : public RaftSysMod
 {
@@ -41,10 +42,48 @@ public:
     // @param cacheControl (nullptr or cache control header value eg "no-cache, no-store, must-revalidate")
     void serveStaticFiles(const char* servePaths, const char* cacheControl = NULL);
     
+    // Add a streaming REST API endpoint - the response is produced by a generator as it is sent (chunked)
+    // so large responses don't need to be built in memory (call during setup)
+    // @param pEndpointName endpoint name (first element of the path after the API prefix)
+    // @param streamFn function called for each request to set the response generator
+    void addStreamingEndpoint(const char* pEndpointName, RaftWebAPIFnStream streamFn);
+
+    // Add a deferred REST API endpoint - the function starts the work and returns, the response is sent when
+    // the handle is completed (from any task) without blocking other connections (call during setup)
+    // @param pEndpointName endpoint name (first element of the path after the API prefix)
+    // @param deferredFn function called for each request with the completion handle
+    void addDeferredEndpoint(const char* pEndpointName, RaftWebAPIFnDeferred deferredFn);
+
+    // Invalidate cached REST API responses (e.g. when the data an endpoint returns has changed)
+    // @param pEndpointName endpoint name (or nullptr to invalidate all cached responses)
+    void invalidateRespCache(const char* pEndpointName = nullptr)
+    {
+        RaftWebRespCache::invalidate(pEndpointName);
+    }
+
     // Server-side event handler (one-way text to browser)
     void enableServerSideEvents(const String& eventsURL);
     void sendServerSideEvent(const char* eventContent, const char* eventGroup);
 
+    // Get link quality stats (ping/pong RTT) for a websocket channel
+    // @param channelID channel ID
+    // @param linkStats (out) link stats
+    // @return true if the channel is connected and supports link stats
+    bool getChannelLinkStats(uint32_t channelID, RaftWebLinkStats& linkStats)
+    {
+        return _raftWebServer.getChannelLinkStats(channelID, linkStats);
+    }
+
+    // Publish to a topic on websockets configured with "pubsub" enabled
+    // @param topic topic name
+    // @param pBuf message (for text websockets this should be a JSON value)
+    // @param bufLen message length
+    // @return number of subscribers the message was sent to
+    uint32_t publishToTopic(const char* topic, const uint8_t* pBuf, uint32_t bufLen)
+    {
+        return _raftWebServer.publishToTopic(topic, pBuf, bufLen);
+    }
+
 protected:
     // Setup
     virtual void setup() override final;
@@ -73,6 +112,7 @@ private:
                     RaftWebServerRestEndpoint& endpoint);
     void webSocketSetup();
     RaftRetCode apiWebCertificates(const String &reqStr, String &respStr, const APISourceInfo& sourceInfo);
+    RaftRetCode apiWebStats(const String &reqStr, String &respStr, const APISourceInfo& sourceInfo);
     RaftRetCode apiWebCertsBody(const String& reqStr, const uint8_t *pData, size_t len, 
                 size_t index, size_t total, const APISourceInfo& sourceInfo);
 
@@ -93,6 +133,36 @@ private:
     // Websockets
     std::vector<String> _webSocketConfigs;
 
+    // Endpoints handled directly by the web server (streaming and deferred responses)
+    struct WebEndpoint
+    {
+        String endpointName;
+        RaftWebAPIFnStream streamFn;
+        RaftWebAPIFnDeferred deferredFn;
+    };
+    std::vector<WebEndpoint> _webEndpoints;
+
+    // Endpoints run on the REST API worker pool
+    std::vector<String> _restWorkerEndpoints;
+
+    // Response compression level overrides for specific endpoints
+    struct RespCompressEndpointLevel
+    {
+        String endpointName;
+        int level;
+    };
+    std::vector<RespCompressEndpointLevel> _respCompressEndpointLevels;
+
+    // Response cache TTL for endpoints defined as cacheable and overrides for specific endpoints
+    static const uint32_t DEFAULT_RESP_CACHE_TTL_MS = 1000;
+    uint32_t _respCacheTtlMs = DEFAULT_RESP_CACHE_TTL_MS;
+    struct RespCacheEndpointTtl
+    {
+        String endpointName;
+        uint32_t ttlMs;
+    };
+    std::vector<RespCacheEndpointTtl> _respCacheEndpointTtls;
+
     // Certificates temporary storage
     std::vector<char, SpiramAwareAllocator<char>> _certsTempStorage;
 
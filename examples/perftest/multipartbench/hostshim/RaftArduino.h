@@ -0,0 +1,88 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Host shim - minimal Arduino String for building RaftWebMultipart on a host for benchmarking
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <string>
+
+class String
+{
+public:
+    String()
+    {
+    }
+    String(const char* pStr) : _str(pStr ? pStr : "")
+    {
+    }
+    String(const uint8_t* pBuf, uint32_t len) : _str((const char*)pBuf, len)
+    {
+    }
+    const char* c_str() const
+    {
+        return _str.c_str();
+    }
+    uint32_t length() const
+    {
+        return _str.length();
+    }
+    void clear()
+    {
+        _str.clear();
+    }
+    char charAt(uint32_t idx) const
+    {
+        return idx < _str.length() ? _str[idx] : 0;
+    }
+    char operator[](uint32_t idx) const
+    {
+        return charAt(idx);
+    }
+    bool equalsIgnoreCase(const String& other) const
+    {
+        return strcasecmp(_str.c_str(), other.c_str()) == 0;
+    }
+    int indexOf(const char* pStr, uint32_t fromIdx = 0) const
+    {
+        size_t pos = _str.find(pStr, fromIdx);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    String substring(uint32_t startIdx, uint32_t endIdx) const
+    {
+        String subStr;
+        if ((startIdx < endIdx) && (startIdx < _str.length()))
+            subStr._str = _str.substr(startIdx, endIdx - startIdx);
+        return subStr;
+    }
+    void trim()
+    {
+        size_t startPos = _str.find_first_not_of(" \t\r\n");
+        size_t endPos = _str.find_last_not_of(" \t\r\n");
+        _str = startPos == std::string::npos ? "" : _str.substr(startPos, endPos - startPos + 1);
+    }
+    void replace(const char* pFind, const char* pReplace)
+    {
+        size_t findLen = strlen(pFind);
+        if (findLen == 0)
+            return;
+        for (size_t pos = _str.find(pFind); pos != std::string::npos; pos = _str.find(pFind, pos + strlen(pReplace)))
+            _str.replace(pos, findLen, pReplace);
+    }
+    friend String operator+(const char* pStr, const String& str)
+    {
+        String result(pStr);
+        result._str += str._str;
+        return result;
+    }
+
+private:
+    std::string _str;
+};
@@ -0,0 +1,50 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Host shim - name/value extraction used by RaftWebMultipart for Content-Disposition
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include "RaftArduino.h"
+
+class RaftJson
+{
+public:
+    class NameValuePair
+    {
+    public:
+        String name;
+        String value;
+    };
+
+    // Extract name/value pairs (e.g. name="f"; filename="x.bin")
+    static void extractNameValues(const String& inStr, const char* pNameValueSep, const char* pPairSep,
+                const char* pPairSepAlt, std::vector<NameValuePair>& nameValuePairs)
+    {
+        nameValuePairs.clear();
+        std::string str = inStr.c_str();
+        size_t pos = 0;
+        while (pos < str.length())
+        {
+            size_t pairEnd = str.find(pPairSep, pos);
+            if (pairEnd == std::string::npos)
+                pairEnd = str.length();
+            std::string pairStr = str.substr(pos, pairEnd - pos);
+            size_t sepPos = pairStr.find(pNameValueSep);
+            if (sepPos != std::string::npos)
+            {
+                NameValuePair nvp;
+                nvp.name = pairStr.substr(0, sepPos).c_str();
+                nvp.value = pairStr.substr(sepPos + strlen(pNameValueSep)).c_str();
+                nvp.name.trim();
+                nvp.value.trim();
+                nameValuePairs.push_back(nvp);
+            }
+            pos = pairEnd + strlen(pPairSep);
+        }
+    }
+};
@@ -0,0 +1,17 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Host shim - return codes used by RaftWebMultipart
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+enum RaftRetCode
+{
+    RAFT_OK,
+    RAFT_BUSY,
+    RAFT_INVALID_OPERATION,
+    RAFT_OTHER_FAILURE
+};
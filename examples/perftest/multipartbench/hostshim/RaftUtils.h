@@ -0,0 +1,9 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Host shim - utilities (none needed by RaftWebMultipart)
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
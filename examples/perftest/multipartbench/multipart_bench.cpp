@@ -0,0 +1,96 @@
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Multipart parser benchmark
+//
+// Feeds a 1MB file upload through RaftWebMultipart in TCP-segment sized chunks using the char map
+// (original) and Horspool boundary searches and reports the throughput of each
+//
+// Rob Dobson 2020
+//
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "RaftWebMultipart.h"
+
+static const uint32_t PAYLOAD_LEN = 1024 * 1024;
+static const uint32_t CHUNK_LEN = 1436;
+static const uint32_t NUM_REPEATS = 20;
+static const char* BOUNDARY = "----WebKitFormBoundary7MA4YWxkTrZu0gW";
+
+// Build a multipart body containing a single file of pseudo-random binary data
+static std::vector<uint8_t> buildBody(std::vector<uint8_t>& payload)
+{
+    payload.resize(PAYLOAD_LEN);
+    uint32_t seed = 12345;
+    for (uint32_t i = 0; i < PAYLOAD_LEN; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        payload[i] = seed >> 16;
+    }
+
+    std::string head = std::string("--") + BOUNDARY + "\r\n"
+            "Content-Disposition: form-data; name=\"file\"; filename=\"fw.bin\"\r\n"
+            "Content-Type: application/octet-stream\r\n\r\n";
+    std::string tail = std::string("\r\n--") + BOUNDARY + "--\r\n";
+    std::vector<uint8_t> body(head.begin(), head.end());
+    body.insert(body.end(), payload.begin(), payload.end());
+    body.insert(body.end(), tail.begin(), tail.end());
+    return body;
+}
+
+// Parse the body in chunks - returns MB/s (payload bytes) or a negative value on failure
+static double runBench(const std::vector<uint8_t>& body, const std::vector<uint8_t>& payload,
+            RaftWebMultipart::BoundarySearch boundarySearch, const char* pName)
+{
+    double totalSecs = 0;
+    for (uint32_t rep = 0; rep < NUM_REPEATS; rep++)
+    {
+        RaftWebMultipart parser(BOUNDARY);
+        parser.setBoundarySearch(boundarySearch);
+        uint32_t rxLen = 0;
+        bool dataOk = true;
+        bool finalPartSeen = false;
+        parser.onData = [&](void* pCtx, const uint8_t* pBuf, uint32_t len, RaftMultipartForm& formInfo,
+                    uint32_t contentPos, bool isFinalPart)
+        {
+            if ((contentPos != rxLen) || (rxLen + len > payload.size()) || (memcmp(pBuf, payload.data() + rxLen, len) != 0))
+                dataOk = false;
+            rxLen += len;
+            finalPartSeen = finalPartSeen || isFinalPart;
+            return RAFT_OK;
+        };
+
+        auto startTime = std::chrono::steady_clock::now();
+        for (uint32_t pos = 0; pos < body.size(); pos += CHUNK_LEN)
+        {
+            uint32_t len = body.size() - pos < CHUNK_LEN ? body.size() - pos : CHUNK_LEN;
+            if (parser.handleData(body.data() + pos, len) != RAFT_OK)
+                break;
+        }
+        totalSecs += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        if (!dataOk || (rxLen != payload.size()) || !finalPartSeen)
+        {
+            printf("%-10s FAILED rxLen %u dataOk %d finalPart %d\n", pName, rxLen, dataOk, finalPartSeen);
+            return -1;
+        }
+    }
+    double mbPerSec = (double)PAYLOAD_LEN * NUM_REPEATS / (1024 * 1024) / totalSecs;
+    printf("%-10s %8.1f MB/s (%u x 1MB in %u byte chunks)\n", pName, mbPerSec, NUM_REPEATS, CHUNK_LEN);
+    return mbPerSec;
+}
+
+int main()
+{
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> body = buildBody(payload);
+    double charMapMBps = runBench(body, payload, RaftWebMultipart::BOUNDARY_SEARCH_CHAR_MAP, "char map");
+    double horspoolMBps = runBench(body, payload, RaftWebMultipart::BOUNDARY_SEARCH_HORSPOOL, "horspool");
+    if ((charMapMBps <= 0) || (horspoolMBps <= 0))
+        return 1;
+    printf("speedup    %8.2fx\n", horspoolMBps / charMapMBps);
+    return 0;
+}